@@ -239,8 +239,11 @@ class EfficientZeroGameBuffer(MuZeroGameBuffer):
                         roots.prepare(self._cfg.root_noise_weight, noises, value_prefix_pool, policy_logits_pool, to_play)
                     else:
                         roots.prepare_no_noise(value_prefix_pool, policy_logits_pool, to_play)
-                    # do MCTS for a new policy with the recent target model
-                    MCTSCtree(self._cfg).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
+                    # do MCTS for a new policy with the recent target model, running all the simulations whatever the
+                    # ``ctree_time_budget_us`` of the collection
+                    MCTSCtree(self._cfg).search(
+                        roots, model, latent_state_roots, reward_hidden_state_roots, to_play, time_budget_us=0
+                    )
                 else:
                     # python mcts_tree
                     roots = MCTSPtree.roots(transition_batch_size, legal_actions)
@@ -387,8 +390,11 @@ class EfficientZeroGameBuffer(MuZeroGameBuffer):
                     roots.prepare(self._cfg.root_noise_weight, noises, value_prefix_pool, policy_logits_pool, to_play)
                 else:
                     roots.prepare_no_noise(value_prefix_pool, policy_logits_pool, to_play)
-                # do MCTS for a new policy with the recent target model
-                MCTSCtree(self._cfg).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
+                # do MCTS for a new policy with the recent target model, running all the simulations whatever the
+                # ``ctree_time_budget_us`` of the collection
+                MCTSCtree(self._cfg).search(
+                    roots, model, latent_state_roots, reward_hidden_state_roots, to_play, time_budget_us=0
+                )
             else:
                 # python mcts_tree
                 roots = MCTSPtree.roots(transition_batch_size, legal_actions)
@@ -417,8 +417,11 @@ class MuZeroGameBuffer(GameBuffer):
                         roots.prepare(self._cfg.root_noise_weight, noises, reward_pool, policy_logits_pool, to_play)
                     else:
                         roots.prepare_no_noise(reward_pool, policy_logits_pool, to_play)
-                    # do MCTS for a new policy with the recent target model
-                    MCTSCtree(self._cfg).search(roots, model, latent_state_roots, to_play)
+                    # do MCTS for a new policy with the recent target model, running all the simulations of every root
+                    # whatever the ``ctree_time_budget_us`` and ``ctree_adaptive_budget`` of the collection
+                    MCTSCtree(self._cfg).search(
+                        roots, model, latent_state_roots, to_play, time_budget_us=0, adaptive_budget=False
+                    )
                 else:
                     # python mcts_tree
                     roots = MCTSPtree.roots(transition_batch_size, legal_actions)
@@ -562,8 +565,11 @@ class MuZeroGameBuffer(GameBuffer):
                     roots.prepare(self._cfg.root_noise_weight, noises, reward_pool, policy_logits_pool, to_play)
                 else:
                     roots.prepare_no_noise(reward_pool, policy_logits_pool, to_play)
-                # do MCTS for a new policy with the recent target model
-                MCTSCtree(self._cfg).search(roots, model, latent_state_roots, to_play)
+                # do MCTS for a new policy with the recent target model, running all the simulations of every root
+                # whatever the ``ctree_time_budget_us`` and ``ctree_adaptive_budget`` of the collection
+                MCTSCtree(self._cfg).search(
+                    roots, model, latent_state_roots, to_play, time_budget_us=0, adaptive_budget=False
+                )
             else:
                 # python mcts_tree
                 roots = MCTSPtree.roots(transition_batch_size, legal_actions)
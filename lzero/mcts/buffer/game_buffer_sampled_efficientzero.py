@@ -341,8 +341,7 @@ class SampledEfficientZeroGameBuffer(EfficientZeroGameBuffer):
                     else:
                         roots.prepare_no_noise(value_prefix_pool, policy_logits_pool, to_play)
                     # do MCTS for a new policy with the recent target model
-                    MCTSPtree.roots(self._cfg
-                                    ).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
+                    MCTSPtree(self._cfg).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
 
                 roots_values = roots.get_values()
                 value_list = np.array(roots_values)
@@ -518,21 +517,30 @@ class SampledEfficientZeroGameBuffer(EfficientZeroGameBuffer):
                 else:
                     roots.prepare_no_noise(value_prefix_pool, policy_logits_pool, to_play)
                 # do MCTS for a new policy with the recent target model
-                MCTSPtree.roots(self._cfg).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
+                MCTSPtree(self._cfg).search(roots, model, latent_state_roots, reward_hidden_state_roots, to_play)
 
             roots_legal_actions_list = legal_actions
-            roots_distributions = roots.get_distributions()
-            roots_values = roots.get_values()
+            if self._cfg.mcts_ctree:
+                # export the sampled actions, visit counts and values of all roots into numpy arrays in one call.
+                root_sampled_actions, roots_distributions, roots_values, roots_valid_masks = MCTSCtree.get_root_outputs(
+                    roots, self._cfg.model.num_of_sampled_actions,
+                    self._cfg.model.action_space_size if self._cfg.model.continuous_action_space else 1
+                )
+                roots_distributions = [
+                    distributions[valid_mask.astype(bool)]
+                    for distributions, valid_mask in zip(roots_distributions, roots_valid_masks)
+                ]
+            else:
+                roots_distributions = roots.get_distributions()
+                roots_values = roots.get_values()
+
+                # ==============================================================
+                # fix reanalyze in sez
+                # ==============================================================
+                # the ptree returns the sampled actions of each root as plain lists.
+                roots_sampled_actions = roots.get_sampled_actions()
+                root_sampled_actions = np.array(roots_sampled_actions)
 
-            # ==============================================================
-            # fix reanalyze in sez
-            # ==============================================================
-            roots_sampled_actions = roots.get_sampled_actions()
-            try:
-                root_sampled_actions = np.array([action.value for action in roots_sampled_actions])
-            except Exception:
-                root_sampled_actions = np.array([action for action in roots_sampled_actions])
-            
             policy_index = 0
             for state_index, child_visit, root_value in zip(pos_in_game_segment_list, child_visits, root_values):
                 target_policies = []
@@ -0,0 +1,49 @@
+# Included by the ``*_tree.pyx`` modules to build the legal actions of ``Roots`` from a numpy mask in C++.
+# ``get_legal_actions_from_mask`` is defined in ``common_lib/utils.cpp``, which is compiled into every ``lib/cnode.cpp``.
+import numpy as np
+
+cdef extern from *:
+    vector[vector[int]] get_legal_actions_from_mask(const unsigned char *legal_actions_mask, int root_num,
+                                                     int action_space_size, bint packed)
+
+
+cdef const unsigned char[:, ::1] to_legal_actions_mask(int root_num, object legal_actions,
+                                                        int bitmask_action_space_size) except *:
+    # The only normalization of the legal action masks of the roots: every nonzero entry of a bool, integer or float
+    # mask of shape (root_num, action_space_size) is legal, and the mask becomes a contiguous 0/1 uint8 array.
+    # If ``bitmask_action_space_size`` > 0, the mask is a (root_num, ceil(action_space_size / 8)) uint8 mask packed by
+    # ``np.packbits``, whose bytes are kept as they are.
+    legal_actions = np.asarray(legal_actions)
+    if legal_actions.ndim != 2 and legal_actions.size == 0:
+        legal_actions = legal_actions.reshape(root_num, 0)
+    if legal_actions.ndim != 2 or legal_actions.shape[0] != root_num:
+        raise ValueError("the legal action mask must be of shape (root_num, action_space_size)")
+    if bitmask_action_space_size > 0:
+        if legal_actions.dtype != np.uint8:
+            raise ValueError("the packed legal action mask must be a uint8 array")
+        if legal_actions.shape[1] != (bitmask_action_space_size + 7) // 8:
+            raise ValueError("the packed legal action mask must have ceil(action_space_size / 8) bytes per root")
+        return np.ascontiguousarray(legal_actions)
+    if legal_actions.dtype != np.bool_:
+        legal_actions = legal_actions != 0
+    return np.ascontiguousarray(legal_actions).view(np.uint8)
+
+
+cdef vector[vector[int]] to_legal_actions_list(int root_num, object legal_actions,
+                                               int bitmask_action_space_size) except *:
+    # ``legal_actions`` is either a list of the legal actions of each root, or a legal action mask of the roots,
+    # see ``to_legal_actions_mask``.
+    cdef const unsigned char[:, ::1] mask
+    cdef int action_space_size
+    if not isinstance(legal_actions, np.ndarray):
+        return legal_actions
+    mask = to_legal_actions_mask(root_num, legal_actions, bitmask_action_space_size)
+    action_space_size = bitmask_action_space_size if bitmask_action_space_size > 0 else mask.shape[1]
+    if root_num == 0 or mask.shape[1] == 0:
+        return get_legal_actions_from_mask(NULL, root_num, 0, bitmask_action_space_size > 0)
+    return get_legal_actions_from_mask(&mask[0, 0], root_num, action_space_size, bitmask_action_space_size > 0)
+
+
+def plegal_actions_list(int root_num, legal_actions, int bitmask_action_space_size=0):
+    # The legal actions of each root built by ``Roots`` from ``legal_actions``.
+    return to_legal_actions_list(root_num, legal_actions, bitmask_action_space_size)
@@ -0,0 +1,17 @@
+# Included by the ``*_tree.pyx`` modules to decode the categorical value/reward logits of the model in C++.
+# ``cinverse_scalar_transform`` is defined in ``common_lib/utils.cpp``, which is compiled into every ``lib/cnode.cpp``.
+
+cdef extern from *:
+    void cinverse_scalar_transform(const float *logits, int batch_size, int support_size, float epsilon,
+                                   float *output)
+
+
+cdef vector[float] decode_categorical(const float[:, ::1] logits, int support_size, float epsilon) except *:
+    # Decode the (batch_size, 2 * support_size + 1) logits to the (batch_size, ) scalars.
+    cdef vector[float] output
+    if logits.shape[1] != 2 * support_size + 1:
+        raise ValueError("the categorical logits must be of shape (batch_size, 2 * support_size + 1)")
+    output.resize(logits.shape[0])
+    if logits.shape[0] > 0:
+        cinverse_scalar_transform(&logits[0, 0], logits.shape[0], support_size, epsilon, output.data())
+    return output
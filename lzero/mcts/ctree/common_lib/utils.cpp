@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <vector>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -24,4 +26,76 @@ void get_time_and_set_rand_seed()
     gettimeofday(&tv, nullptr);
     srand(tv.tv_usec);
 #endif
-}
\ No newline at end of file
+}
+
+std::vector<std::vector<int> > get_legal_actions_from_mask(const unsigned char *legal_actions_mask, int root_num, int action_space_size, bool packed)
+{
+    /*
+    Overview:
+        Build the legal action lists of a batch of roots from a row-major legal action mask.
+    Arguments:
+        - legal_actions_mask: the mask of shape (root_num, action_space_size) with one byte per action, \
+            or of shape (root_num, ceil(action_space_size / 8)) packed by np.packbits if packed is true.
+        - root_num: the number of the roots.
+        - action_space_size: the size of action space of the current env.
+        - packed: whether each action occupies one bit (most significant bit first) instead of one byte.
+    Returns:
+        - legal_actions_list: the legal actions of each root in ascending order.
+    */
+    int row_size = packed ? (action_space_size + 7) / 8 : action_space_size;
+    std::vector<std::vector<int> > legal_actions_list(root_num);
+    for (int i = 0; i < root_num; ++i)
+    {
+        const unsigned char *row = legal_actions_mask + i * row_size;
+        std::vector<int> &legal_actions = legal_actions_list[i];
+        for (int a = 0; a < action_space_size; ++a)
+        {
+            bool is_legal = packed ? ((row[a >> 3] >> (7 - (a & 7))) & 1) : (row[a] != 0);
+            if (is_legal)
+            {
+                legal_actions.push_back(a);
+            }
+        }
+    }
+    return legal_actions_list;
+}
+
+void cinverse_scalar_transform(const float *logits, int batch_size, int support_size, float epsilon, float *output)
+{
+    /*
+    Overview:
+        Decode a batch of categorical logits over the support [-support_size, support_size] to scalars, \
+        i.e. the softmax, the expectation over the support and the inverse of the h(.) function in \
+        https://arxiv.org/pdf/1805.11593.pdf, the same as ``InverseScalarTransform`` in ``lzero.policy``.
+    Arguments:
+        - logits: the row-major logits of shape (batch_size, 2 * support_size + 1).
+        - batch_size: the number of the logit vectors.
+        - support_size: the half width of the support.
+        - epsilon: the epsilon of the h(.) function.
+        - output: the decoded scalars of shape (batch_size, ).
+    */
+    int set_size = 2 * support_size + 1;
+    for (int i = 0; i < batch_size; ++i)
+    {
+        const float *row = logits + i * set_size;
+        float max_logit = row[0];
+        for (int j = 1; j < set_size; ++j)
+        {
+            max_logit = std::max(max_logit, row[j]);
+        }
+
+        float prob_sum = 0.0;
+        float support_sum = 0.0;
+        for (int j = 0; j < set_size; ++j)
+        {
+            float prob = std::exp(row[j] - max_logit);
+            prob_sum += prob;
+            support_sum += prob * (float)(j - support_size);
+        }
+        float value = support_sum / prob_sum;
+
+        float tmp = (std::sqrt(1 + 4 * epsilon * (std::fabs(value) + 1 + epsilon)) - 1) / (2 * epsilon);
+        float sign = (float)((value > 0) - (value < 0));
+        output[i] = sign * (tmp * tmp - 1);
+    }
+}
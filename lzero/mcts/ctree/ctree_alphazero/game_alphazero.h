@@ -0,0 +1,693 @@
+#ifndef GAME_ALPHAZERO_H
+#define GAME_ALPHAZERO_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Native C++ implementations of the zoo board games used by the AlphaZero MCTS.
+// They follow the rules of ``zoo/board_games/{tictactoe,connect4,gomoku,go}/envs`` so that the search can simulate games
+// without calling back into the Python environment. Players are numbered 1 and 2, cells hold 0 (empty), 1 or 2,
+// and ``get_done_winner`` returns (done, winner) with winner = -1 for a draw or an unfinished game.
+class Game {
+public:
+    Game() : scale(true), channel_last(false) {}
+
+    virtual ~Game() {}
+
+    // Resets the game to ``board`` (row-major cell values, empty for the initial position) with the player
+    // ``start_player_index`` (0 for player 1, 1 for player 2) to move.
+    virtual void reset(int start_player_index, const std::vector<int>& board) = 0;
+
+    // Plays ``action`` for the current player and passes the turn to the other player.
+    virtual void step(int action) = 0;
+
+    // Takes back the last move played by ``step`` since the last ``reset``, so that a simulation can return to the
+    // root position in O(depth) instead of resetting the game.
+    virtual void undo() = 0;
+
+    // Returns the legal actions of the current position in increasing order.
+    virtual std::vector<int> legal_actions() const = 0;
+
+    // Returns (done, winner) of the current position.
+    virtual std::pair<bool, int> get_done_winner() const = 0;
+
+    // Returns the player to move, 1 or 2.
+    virtual int current_player() const = 0;
+
+    // Returns the Zobrist hash of the current position, including the player to move.
+    virtual uint64_t zobrist_hash() const = 0;
+
+    // Returns the current position as a compact binary string, which ``set_state`` restores without any Python object.
+    virtual std::string get_state() const = 0;
+
+    // Restores a position returned by ``get_state``, which becomes the position ``undo`` takes back moves to.
+    virtual void set_state(const std::string& state) = 0;
+
+    // Returns the number of actions of the game.
+    virtual int action_space_size() const = 0;
+
+    // Returns the shape of the state planes written by ``current_state``.
+    virtual std::vector<int> state_shape() const = 0;
+
+    // Writes the state planes from the view of the current player into ``output``: the stones of the current
+    // player, the stones of the other player and a plane filled with the current player, in (rows, cols, channels)
+    // order if ``channel_last``. The planes are divided by 2 if both ``scale`` and ``apply_scale`` are true.
+    virtual void current_state(float* output, bool apply_scale = true) const = 0;
+
+    // Returns a deep copy of the game.
+    virtual Game* clone() const = 0;
+
+public:
+    bool scale;  // Same as the ``scale`` option of the zoo environments
+    bool channel_last;  // Same as the ``channel_last`` option of the zoo environments
+};
+
+// Base class of the games played by placing one stone of the current player on a rows x cols board.
+class BoardGame : public Game {
+public:
+    // ``num_extra_keys`` Zobrist keys are drawn after the keys of the stones and of the player to move, for the
+    // derived games whose positions hold more than the stones.
+    BoardGame(int rows, int cols, int n_in_row, int num_extra_keys = 0)
+        : rows(rows), cols(cols), n_in_row(n_in_row), board(rows * cols, 0), player(1), num_empty(rows * cols),
+          winner(-1), zobrist_keys(make_zobrist_keys(2 * rows * cols + 1 + num_extra_keys)), hash(0) {}
+
+    void reset(int start_player_index, const std::vector<int>& init_board) override {
+        if (init_board.empty()) {
+            std::fill(board.begin(), board.end(), 0);
+        } else if (static_cast<int>(init_board.size()) == rows * cols) {
+            check_cells(init_board);
+            board = init_board;
+        } else {
+            throw std::invalid_argument("the board must have rows * cols cells");
+        }
+        player = start_player_index == 0 ? 1 : 2;
+        num_empty = static_cast<int>(std::count(board.begin(), board.end(), 0));
+        winner = find_winner();
+        history.clear();
+        hash = player == 2 ? side_key() : 0;
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (board[cell] != 0) {
+                hash ^= zobrist_key(cell, board[cell]);
+            }
+        }
+    }
+
+    void step(int action) override {
+        int cell = cell_of_action(action);
+        if (cell < 0) {
+            throw std::invalid_argument("illegal action " + std::to_string(action));
+        }
+        history.push_back(std::make_pair(cell, winner));
+        board[cell] = player;
+        --num_empty;
+        if (is_winning_cell(cell)) {
+            winner = player;
+        }
+        hash ^= zobrist_key(cell, player) ^ side_key();
+        player = 3 - player;
+    }
+
+    void undo() override {
+        if (history.empty()) {
+            throw std::logic_error("no move to undo");
+        }
+        player = 3 - player;
+        hash ^= zobrist_key(history.back().first, player) ^ side_key();
+        board[history.back().first] = 0;
+        winner = history.back().second;
+        history.pop_back();
+        ++num_empty;
+    }
+
+    std::pair<bool, int> get_done_winner() const override {
+        return std::make_pair(winner != -1 || num_empty == 0, winner);
+    }
+
+    int current_player() const override {
+        return player;
+    }
+
+    uint64_t zobrist_hash() const override {
+        return hash;
+    }
+
+    // The state is the player to move followed by the cells, one byte each.
+    std::string get_state() const override {
+        std::string state(1 + rows * cols, 0);
+        state[0] = static_cast<char>(player);
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            state[1 + cell] = static_cast<char>(board[cell]);
+        }
+        return state;
+    }
+
+    void set_state(const std::string& state) override {
+        if (static_cast<int>(state.size()) != 1 + rows * cols) {
+            throw std::invalid_argument("the state must have 1 + rows * cols bytes");
+        }
+        reset(state[0] == 1 ? 0 : 1, std::vector<int>(state.begin() + 1, state.end()));
+    }
+
+    std::vector<int> state_shape() const override {
+        return channel_last ? std::vector<int>{rows, cols, 3} : std::vector<int>{3, rows, cols};
+    }
+
+    void current_state(float* output, bool apply_scale = true) const override {
+        float factor = (scale && apply_scale) ? 0.5f : 1.0f;
+        int num_cells = rows * cols;
+        for (int cell = 0; cell < num_cells; ++cell) {
+            float planes[3] = {board[cell] == player ? factor : 0.0f,
+                               board[cell] == 3 - player ? factor : 0.0f,
+                               player * factor};
+            for (int c = 0; c < 3; ++c) {
+                output[channel_last ? cell * 3 + c : c * num_cells + cell] = planes[c];
+            }
+        }
+    }
+
+    const std::vector<int>& get_board() const {
+        return board;
+    }
+
+protected:
+    // Returns the cell filled by ``action`` in the current position, or -1 if ``action`` is illegal.
+    virtual int cell_of_action(int action) const = 0;
+
+    // Throws std::invalid_argument unless every cell of ``cells`` is empty (0) or a stone of player 1 or 2, the only
+    // values the Zobrist keys and the state planes are defined for.
+    static void check_cells(const std::vector<int>& cells) {
+        for (int cell : cells) {
+            if (cell < 0 || cell > 2) {
+                throw std::invalid_argument("the board cells must be 0, 1 or 2, not " + std::to_string(cell));
+            }
+        }
+    }
+
+    // Returns true if the stone on ``cell`` is part of a line of ``n_in_row`` stones of its owner.
+    bool is_winning_cell(int cell) const {
+        static const int directions[4][2] = {{0, 1}, {1, 0}, {1, 1}, {1, -1}};
+        int owner = board[cell];
+        int row = cell / cols, col = cell % cols;
+        for (const auto& d : directions) {
+            int count = 1;
+            for (int sign = -1; sign <= 1; sign += 2) {
+                int r = row + sign * d[0], c = col + sign * d[1];
+                while (r >= 0 && r < rows && c >= 0 && c < cols && board[r * cols + c] == owner) {
+                    ++count;
+                    r += sign * d[0];
+                    c += sign * d[1];
+                }
+            }
+            if (count >= n_in_row) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Scans the whole board for a winner, in the row-major order used by the zoo environments.
+    int find_winner() const {
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (board[cell] != 0 && is_winning_cell(cell)) {
+                return board[cell];
+            }
+        }
+        return -1;
+    }
+
+    // Returns the Zobrist key of a stone of ``owner`` (1 or 2) on ``cell``.
+    uint64_t zobrist_key(int cell, int owner) const {
+        return (*zobrist_keys)[2 * cell + owner - 1];
+    }
+
+    // Returns the Zobrist key of player 2 to move.
+    uint64_t side_key() const {
+        return (*zobrist_keys)[2 * rows * cols];
+    }
+
+    // Returns ``num_keys`` Zobrist keys: the keys of the two stones of every cell, the key of player 2 to move and the
+    // extra keys of the derived game. The keys are drawn from a fixed seed, so that equal positions have equal hashes
+    // in every game of the same size.
+    static std::shared_ptr<const std::vector<uint64_t>> make_zobrist_keys(int num_keys) {
+        std::vector<uint64_t> keys(num_keys);
+        uint64_t state = 0x9e3779b97f4a7c15ULL;
+        for (auto& key : keys) {
+            // splitmix64
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            key = z ^ (z >> 31);
+        }
+        return std::make_shared<const std::vector<uint64_t>>(std::move(keys));
+    }
+
+    int rows;
+    int cols;
+    int n_in_row;  // Number of aligned stones that wins the game
+    std::vector<int> board;
+    int player;
+    int num_empty;
+    int winner;
+    std::vector<std::pair<int, int>> history;  // (cell, winner before the move) of the moves played since reset
+    std::shared_ptr<const std::vector<uint64_t>> zobrist_keys;  // Shared by the clones of the game
+    uint64_t hash;  // Zobrist hash of the current position, updated incrementally by ``step`` and ``undo``
+};
+
+// Game where the current player places a stone on any empty cell, action = row * cols + col.
+class PlacementGame : public BoardGame {
+public:
+    PlacementGame(int rows, int cols, int n_in_row) : BoardGame(rows, cols, n_in_row) {}
+
+    std::vector<int> legal_actions() const override {
+        std::vector<int> actions;
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (board[cell] == 0) {
+                actions.push_back(cell);
+            }
+        }
+        return actions;
+    }
+
+    int action_space_size() const override {
+        return rows * cols;
+    }
+
+    Game* clone() const override {
+        return new PlacementGame(*this);
+    }
+
+protected:
+    int cell_of_action(int action) const override {
+        return (action >= 0 && action < rows * cols && board[action] == 0) ? action : -1;
+    }
+};
+
+// Tic-tac-toe: three in a row on a 3 x 3 board.
+class TicTacToeGame : public PlacementGame {
+public:
+    TicTacToeGame() : PlacementGame(3, 3, 3) {}
+};
+
+// Gomoku: five in a row on a board_size x board_size board.
+class GomokuGame : public PlacementGame {
+public:
+    explicit GomokuGame(int board_size) : PlacementGame(board_size, board_size, 5) {}
+};
+
+// Connect Four on a 6 x 7 board, action = column; the stone falls to the lowest empty row of the column.
+class Connect4Game : public BoardGame {
+public:
+    Connect4Game() : BoardGame(6, 7, 4) {}
+
+    std::vector<int> legal_actions() const override {
+        std::vector<int> actions;
+        for (int col = 0; col < cols; ++col) {
+            if (board[col] == 0) {
+                actions.push_back(col);
+            }
+        }
+        return actions;
+    }
+
+    int action_space_size() const override {
+        return cols;
+    }
+
+    Game* clone() const override {
+        return new Connect4Game(*this);
+    }
+
+protected:
+    int cell_of_action(int action) const override {
+        if (action < 0 || action >= cols) {
+            return -1;
+        }
+        for (int row = rows - 1; row >= 0; --row) {
+            if (board[row * cols + action] == 0) {
+                return row * cols + action;
+            }
+        }
+        return -1;
+    }
+};
+
+// Go on a board_size x board_size board with the rules of ``zoo/board_games/go/envs``: action = row * cols + col, and
+// action rows * cols passes. Suicide is illegal, a single stone capturing a single stone in an eye of the other player
+// creates a ko point that may not be retaken at once, and the game ends after two consecutive passes. The winner is
+// given by the area score, stones and the empty regions surrounded by one player only, with ``komi`` for player 2.
+class GoGame : public BoardGame {
+public:
+    GoGame(int board_size, float komi)
+        : BoardGame(board_size, board_size, 0, board_size * board_size + 1), komi(komi), ko(-1), passes(0),
+          marks(board_size * board_size, 0), mark(0) {}
+
+    void reset(int start_player_index, const std::vector<int>& init_board) override {
+        set_position(start_player_index == 0 ? 1 : 2, init_board, -1, 0);
+    }
+
+    void step(int action) override {
+        int num_cells = rows * cols;
+        if (action == num_cells) {
+            moves.push_back(GoMove{-1, ko, passes, std::vector<int>()});
+            set_ko(-1);
+            set_passes(passes + 1);
+            if (passes >= 2) {
+                winner = find_area_winner();
+            }
+        } else {
+            if (!is_legal_move(action)) {
+                throw std::invalid_argument("illegal action " + std::to_string(action));
+            }
+            int other = 3 - player;
+            bool in_eye = is_eye_of(action, other);
+            moves.push_back(GoMove{action, ko, passes, std::vector<int>()});
+            std::vector<int>& captured = moves.back().captured;
+            place(action, player);
+            for (int neighbor : neighbors(action)) {
+                if (neighbor >= 0 && board[neighbor] == other && count_liberties(neighbor, 1) == 0) {
+                    remove_group(neighbor, captured);
+                }
+            }
+            set_ko(in_eye && captured.size() == 1 ? captured[0] : -1);
+            set_passes(0);
+        }
+        hash ^= side_key();
+        player = 3 - player;
+    }
+
+    void undo() override {
+        if (moves.empty()) {
+            throw std::logic_error("no move to undo");
+        }
+        const GoMove& move = moves.back();
+        hash ^= side_key();
+        player = 3 - player;
+        if (move.cell >= 0) {
+            for (int cell : move.captured) {
+                place(cell, 3 - player);
+            }
+            remove(move.cell);
+        }
+        set_ko(move.ko);
+        set_passes(move.passes);
+        winner = -1;
+        moves.pop_back();
+    }
+
+    std::vector<int> legal_actions() const override {
+        std::vector<int> actions;
+        if (passes >= 2) {
+            return actions;
+        }
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (is_legal_move(cell)) {
+                actions.push_back(cell);
+            }
+        }
+        actions.push_back(rows * cols);
+        return actions;
+    }
+
+    std::pair<bool, int> get_done_winner() const override {
+        return std::make_pair(passes >= 2, winner);
+    }
+
+    int action_space_size() const override {
+        return rows * cols + 1;
+    }
+
+    // The state is the player to move, the number of consecutive passes, the ko point as two little-endian bytes
+    // (0xffff if none) and the cells, one byte each. The Zobrist hash, which covers the ko point and a pending pass,
+    // is rebuilt from them.
+    std::string get_state() const override {
+        std::string state(4 + rows * cols, 0);
+        state[0] = static_cast<char>(player);
+        state[1] = static_cast<char>(passes);
+        state[2] = static_cast<char>(ko & 0xff);
+        state[3] = static_cast<char>((ko >> 8) & 0xff);
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            state[4 + cell] = static_cast<char>(board[cell]);
+        }
+        return state;
+    }
+
+    void set_state(const std::string& state) override {
+        if (static_cast<int>(state.size()) != 4 + rows * cols) {
+            throw std::invalid_argument("the state must have 4 + rows * cols bytes");
+        }
+        int ko_point = static_cast<unsigned char>(state[2]) | (static_cast<unsigned char>(state[3]) << 8);
+        set_position(state[0] == 1 ? 1 : 2, std::vector<int>(state.begin() + 4, state.end()),
+                     ko_point == 0xffff ? -1 : ko_point, static_cast<unsigned char>(state[1]));
+    }
+
+    Game* clone() const override {
+        return new GoGame(*this);
+    }
+
+protected:
+    int cell_of_action(int action) const override {
+        return is_legal_move(action) ? action : -1;
+    }
+
+private:
+    // The changes of a move, which ``undo`` takes back: the cell played (-1 for a pass), the ko point and number of
+    // consecutive passes before the move, and the stones it captured.
+    struct GoMove {
+        int cell;
+        int ko;
+        int passes;
+        std::vector<int> captured;
+    };
+
+    void set_position(int to_move, const std::vector<int>& init_board, int ko_point, int num_passes) {
+        int num_cells = rows * cols;
+        if (ko_point < -1 || ko_point >= num_cells) {
+            throw std::invalid_argument("the ko point must be a cell or -1");
+        }
+        if (init_board.empty()) {
+            std::fill(board.begin(), board.end(), 0);
+        } else if (static_cast<int>(init_board.size()) == num_cells) {
+            check_cells(init_board);
+            board = init_board;
+        } else {
+            throw std::invalid_argument("the board must have rows * cols cells");
+        }
+        player = to_move;
+        num_empty = static_cast<int>(std::count(board.begin(), board.end(), 0));
+        moves.clear();
+        hash = player == 2 ? side_key() : 0;
+        for (int cell = 0; cell < num_cells; ++cell) {
+            if (board[cell] != 0) {
+                hash ^= zobrist_key(cell, board[cell]);
+            }
+        }
+        ko = -1;
+        passes = 0;
+        set_ko(ko_point);
+        set_passes(num_passes);
+        winner = passes >= 2 ? find_area_winner() : -1;
+    }
+
+    // The extra Zobrist keys are the keys of the ko point on every cell, followed by the key of a pending pass.
+    uint64_t ko_key(int cell) const {
+        return (*zobrist_keys)[2 * rows * cols + 1 + cell];
+    }
+
+    uint64_t pass_key() const {
+        return zobrist_keys->back();
+    }
+
+    void set_ko(int cell) {
+        if (ko >= 0) {
+            hash ^= ko_key(ko);
+        }
+        ko = cell;
+        if (ko >= 0) {
+            hash ^= ko_key(ko);
+        }
+    }
+
+    void set_passes(int num_passes) {
+        if ((passes > 0) != (num_passes > 0)) {
+            hash ^= pass_key();
+        }
+        passes = num_passes;
+    }
+
+    void place(int cell, int owner) {
+        board[cell] = owner;
+        hash ^= zobrist_key(cell, owner);
+        --num_empty;
+    }
+
+    void remove(int cell) {
+        hash ^= zobrist_key(cell, board[cell]);
+        board[cell] = 0;
+        ++num_empty;
+    }
+
+    // Returns the on-board orthogonal neighbors of ``cell``, padded with -1.
+    std::array<int, 4> neighbors(int cell) const {
+        int row = cell / cols, col = cell % cols;
+        return {row > 0 ? cell - cols : -1, row < rows - 1 ? cell + cols : -1,
+                col > 0 ? cell - 1 : -1, col < cols - 1 ? cell + 1 : -1};
+    }
+
+    // Returns true if every neighbor of the empty ``cell`` is a stone of ``owner``.
+    bool is_eye_of(int cell, int owner) const {
+        for (int neighbor : neighbors(cell)) {
+            if (neighbor >= 0 && board[neighbor] != owner) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns true if the current player may play on ``cell``: it is an empty cell other than the ko point, and the
+    // stone has a liberty, joins a group of the player with another liberty or captures a group of the other player.
+    bool is_legal_move(int cell) const {
+        if (cell < 0 || cell >= rows * cols || board[cell] != 0 || cell == ko) {
+            return false;
+        }
+        for (int neighbor : neighbors(cell)) {
+            if (neighbor < 0) {
+                continue;
+            }
+            if (board[neighbor] == 0) {
+                return true;
+            }
+            int liberties = count_liberties(neighbor, 2);
+            if (board[neighbor] == player ? liberties > 1 : liberties == 1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Returns the number of liberties of the group of the stone on ``cell``, counting up to ``limit``.
+    int count_liberties(int cell, int limit) const {
+        int owner = board[cell];
+        next_mark();
+        std::vector<int>& stack = scratch;
+        stack.assign(1, cell);
+        marks[cell] = mark;
+        int liberties = 0;
+        while (!stack.empty()) {
+            int current = stack.back();
+            stack.pop_back();
+            for (int neighbor : neighbors(current)) {
+                if (neighbor < 0 || marks[neighbor] == mark) {
+                    continue;
+                }
+                if (board[neighbor] == 0) {
+                    marks[neighbor] = mark;
+                    if (++liberties >= limit) {
+                        return liberties;
+                    }
+                } else if (board[neighbor] == owner) {
+                    marks[neighbor] = mark;
+                    stack.push_back(neighbor);
+                }
+            }
+        }
+        return liberties;
+    }
+
+    // Removes the group of the stone on ``cell`` from the board and appends its cells to ``captured``.
+    void remove_group(int cell, std::vector<int>& captured) {
+        int owner = board[cell];
+        size_t first = captured.size();
+        captured.push_back(cell);
+        remove(cell);
+        for (size_t i = first; i < captured.size(); ++i) {
+            for (int neighbor : neighbors(captured[i])) {
+                if (neighbor >= 0 && board[neighbor] == owner) {
+                    captured.push_back(neighbor);
+                    remove(neighbor);
+                }
+            }
+        }
+    }
+
+    // Returns the winner by area score: the stones of each player and the empty regions whose borders are all stones
+    // of that player, with ``komi`` added to player 2. Returns -1 for a draw.
+    int find_area_winner() const {
+        double score = -komi;
+        next_mark();
+        std::vector<int>& region = scratch;
+        for (int cell = 0; cell < rows * cols; ++cell) {
+            if (board[cell] != 0) {
+                score += board[cell] == 1 ? 1 : -1;
+                continue;
+            }
+            if (marks[cell] == mark) {
+                continue;
+            }
+            region.assign(1, cell);
+            marks[cell] = mark;
+            bool borders[3] = {false, false, false};
+            for (size_t i = 0; i < region.size(); ++i) {
+                for (int neighbor : neighbors(region[i])) {
+                    if (neighbor < 0) {
+                        continue;
+                    }
+                    if (board[neighbor] != 0) {
+                        borders[board[neighbor]] = true;
+                    } else if (marks[neighbor] != mark) {
+                        marks[neighbor] = mark;
+                        region.push_back(neighbor);
+                    }
+                }
+            }
+            if (borders[1] != borders[2]) {
+                score += borders[1] ? static_cast<double>(region.size()) : -static_cast<double>(region.size());
+            }
+        }
+        return score > 0 ? 1 : (score < 0 ? 2 : -1);
+    }
+
+    // Starts a new flood fill, whose visited cells are those of ``marks`` equal to ``mark``.
+    void next_mark() const {
+        if (++mark == 0) {
+            std::fill(marks.begin(), marks.end(), 0);
+            mark = 1;
+        }
+    }
+
+    float komi;  // Points added to the score of player 2
+    int ko;  // Cell that may not be played by the current player because of a ko, -1 if none
+    int passes;  // Number of consecutive passes ending the move sequence
+    std::vector<GoMove> moves;  // Moves played since the last reset or set_state
+    mutable std::vector<unsigned> marks;  // Visited marks of the flood fills
+    mutable unsigned mark;  // Current visited mark
+    mutable std::vector<int> scratch;  // Stack of the flood fills
+};
+
+// Creates the native game named ``game_name`` ("tictactoe", "connect4", "gomoku" or "go"); ``board_size`` is only used
+// by gomoku and go, and ``komi`` by go.
+inline std::unique_ptr<Game> make_game(const std::string& game_name, int board_size = 15, bool scale = true,
+                                       bool channel_last = false, float komi = 7.5) {
+    std::unique_ptr<Game> game;
+    if (game_name == "tictactoe") {
+        game.reset(new TicTacToeGame());
+    } else if (game_name == "connect4") {
+        game.reset(new Connect4Game());
+    } else if (game_name == "gomoku") {
+        game.reset(new GomokuGame(board_size));
+    } else if (game_name == "go") {
+        game.reset(new GoGame(board_size, komi));
+    } else {
+        throw std::invalid_argument("no native game named " + game_name);
+    }
+    game->scale = scale;
+    game->channel_last = channel_last;
+    return game;
+}
+
+#endif // GAME_ALPHAZERO_H
@@ -5,23 +5,90 @@
 
 // The following lines include the necessary headers to facilitate the implementation of the MCTS algorithm.
 #include "node_alphazero.h"
+#include "node_alphazero_binding.h"
+#include "game_alphazero.h"
+#include <atomic>
+#include <chrono>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
 #include <map>
+#include <mutex>
+#include <thread>
 #include <random>
 #include <vector>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include <numeric>
+#include <unordered_map>
 
 // This line creates an alias for the pybind11 namespace, making it easier to reference in the code.
 namespace py = pybind11;
 
+// A position of the native game in the search graph of ``graph_search``: the node expanded for it, whose children are
+// shared by the nodes reaching the position through other move orders, and the statistics of all the simulations through
+// the position, seen like the value of a node from the player who moved into it.
+struct GraphPosition {
+    Node* node;
+    int visit_count;
+    double value_sum;
+};
+
+// A node on the path of a descent of ``graph_search``, with its position, or nullptr for the root, a position that is
+// new or terminal, and a node whose descent stopped to catch up with the value of its position.
+struct GraphStep {
+    Node* node;
+    GraphPosition* position;
+};
+
+// A leaf reached by one simulation of a batch, waiting to be evaluated and backed up.
+struct PendingLeaf {
+    Node* node;
+    std::vector<int> legal_actions;
+    bool done;  // Whether the value of the leaf is known without evaluation: a terminal state or a cached evaluation
+    double leaf_value;  // The value of the leaf from the view of its player to move, backed up like in ``_simulate``
+    uint64_t hash;  // The Zobrist hash of the position of a leaf of the native game, under which its evaluation is recorded
+    std::vector<GraphStep> path;  // The path from the root to a leaf of ``graph_search``, empty otherwise
+};
+
+// The cached evaluation of a position of the native game, reused by the leaves that reach it through other move orders.
+// Only the output of the policy-value function is cached: the nodes of the position keep their own statistics.
+struct CachedEvaluation {
+    std::vector<int> legal_actions;
+    std::vector<std::pair<int, float>> action_priors;  // The priors of the legal actions, before any root noise
+    double value;  // The value returned by the policy-value function, from the view of the player to move
+};
+
+// A leaf evaluation requested by a worker thread of the tree-parallel search.
+struct EvaluationRequest {
+    Game* game;  // The game of the worker in the position of the leaf, left untouched until the request is ready
+    std::vector<float> action_probs;
+    double value;
+    bool ready;
+};
+
+// The queue through which the worker threads of the tree-parallel search hand their leaves to the thread holding the GIL,
+// which evaluates them in batches. All the fields are guarded by ``mutex``.
+struct EvaluationQueue {
+    std::mutex mutex;
+    std::condition_variable requests_cv;  // Notified when a request is added, or a worker blocks or exits
+    std::condition_variable results_cv;  // Notified when requests are ready or a claimed node is expanded
+    std::vector<EvaluationRequest*> requests;
+    int live_workers = 0;
+    int blocked_workers = 0;  // Workers waiting for a node claimed by another worker to be expanded
+    bool aborted = false;
+    std::exception_ptr error;  // The first exception thrown by a worker
+};
+
 // This part defines the MCTS class and its member variables.
 // The MCTS class implements the MCTS algorithm, and its member variables store configuration values used in the algorithm.
 class MCTS {
+    friend class BatchedMCTS;
+
     int max_moves;
     int num_simulations;
     double pb_c_base;
@@ -29,24 +96,209 @@ class MCTS {
     double root_dirichlet_alpha;
     double root_noise_weight;
     py::object simulate_env;
+    // The number of leaves gathered with virtual loss and evaluated together per round; 1 evaluates the leaves one by one.
+    int leaf_batch_size;
+    // The number of worker threads descending the tree of the native game concurrently; 0 searches in the calling thread.
+    int num_threads;
+    // The pools the worker threads allocate their expansions from, released with the tree.
+    std::vector<std::unique_ptr<NodePool>> worker_pools;
+    // The loss added to the value sum of every node on the path of a pending leaf, along with one visit.
+    double virtual_loss;
+    // The native game used instead of ``simulate_env`` once ``set_native_game`` has been called.
+    std::unique_ptr<Game> native_game;
+    std::string native_battle_mode;
+    // Whether the native search caches the evaluation of the positions reached by different move orders.
+    bool use_evaluation_cache;
+    // The evaluations of the positions of the native game in the current search by Zobrist hash, one table per root,
+    // so that the trees of the games searched together by ``BatchedMCTS`` never share an evaluation.
+    std::unordered_map<Node*, std::unordered_map<uint64_t, CachedEvaluation>> evaluation_caches;
+    // Whether the native search builds a graph of the positions, whose nodes share the children and statistics of the
+    // positions reached by different move orders, see ``_descend_graph``.
+    bool graph_search;
+    // The positions of the search graphs by Zobrist hash, one graph per root like ``evaluation_caches``.
+    std::unordered_map<Node*, std::unordered_map<uint64_t, GraphPosition>> graphs;
+    // The gap between the value of a node and the value of its position above which a descent of the graph stops to
+    // close it, the Q epsilon of Monte-Carlo Graph Search.
+    static constexpr double graph_value_tolerance = 0.01;
+    // The root of the search tree kept across moves: ``update_with_move`` promotes the child of the played action,
+    // which the next ``get_next_action`` searches further if it is called on the state of that child.
+    Node* tree_root;
+    // The nodes of the tree are allocated from ``node_pools[pool_index]``; the subtree kept by ``update_with_move`` is
+    // copied to the other pool, and the pool of the old tree is released at once.
+    NodePool node_pools[2];
+    int pool_index;
+    // Whether ``tree_root`` has been promoted by ``update_with_move`` since the last search, i.e. whether it may be reused.
+    bool root_promoted;
+    // The number of moves passed to ``update_with_move`` since the last search.
+    int moves_since_search;
+    // The raw state of ``tree_root``, compared with the state of the next search before reusing the tree:
+    // ``current_state()[0].tobytes()`` of ``simulate_env``, or ``current_state`` of the native game.
+    py::object root_state_key;
+    std::vector<float> native_root_state_key;
+    // Restores ``simulate_env`` to the state of the last search, to step the moves passed to ``update_with_move``.
+    std::function<void()> restore_search_root;
+    // The wall-clock budget of a search in microseconds, 0 for none: the search then stops after the first batch of
+    // simulations that ends past its deadline, even if it has run fewer than ``num_simulations`` simulations.
+    long long time_budget_us;
+    std::chrono::steady_clock::time_point search_deadline;
+    // The number of simulations run by the last search.
+    int num_simulations_done;
 
 // This part defines the constructor of the MCTS class.
 // The constructor initializes the member variables with the provided arguments or with their default values.
 public:
     MCTS(int max_moves=512, int num_simulations=800,
          double pb_c_base=19652, double pb_c_init=1.25,
-         double root_dirichlet_alpha=0.3, double root_noise_weight=0.25, py::object simulate_env=py::none())
+         double root_dirichlet_alpha=0.3, double root_noise_weight=0.25, py::object simulate_env=py::none(),
+         int leaf_batch_size=1, double virtual_loss=1.0)
         : max_moves(max_moves), num_simulations(num_simulations),
           pb_c_base(pb_c_base), pb_c_init(pb_c_init),
           root_dirichlet_alpha(root_dirichlet_alpha),
           root_noise_weight(root_noise_weight),
-          simulate_env(simulate_env) {}
+          simulate_env(simulate_env), leaf_batch_size(leaf_batch_size), num_threads(0), virtual_loss(virtual_loss),
+          native_battle_mode("self_play_mode"), use_evaluation_cache(false), graph_search(false), tree_root(nullptr), pool_index(0), root_promoted(false), moves_since_search(0),
+          root_state_key(py::none()), time_budget_us(0), num_simulations_done(0) {}
+
+    // This function frees the search tree, e.g. at the end of an episode.
+    void reset() {
+        evaluation_caches.clear();
+        graphs.clear();
+        tree_root = nullptr;
+        node_pools[0].clear();
+        node_pools[1].clear();
+        _clear_worker_pools();
+        root_promoted = false;
+        moves_since_search = 0;
+    }
+
+    // This function advances the search tree by the move ``action`` played from its root: the child of ``action``
+    // becomes the root and the subtrees of the other actions are freed. It must be called for every move played since
+    // the last ``get_next_action``, so that the next search starts with the visits already spent on its state.
+    // The tree is freed instead if ``action`` was not expanded by the search, and always with ``graph_search``, whose
+    // nodes share children that a copy of the subtree would split.
+    void update_with_move(int action) {
+        Node* child = tree_root ? tree_root->get_child(action) : nullptr;
+        if (child == nullptr || graph_search) {
+            reset();
+            return;
+        }
+        evaluation_caches.clear();
+        NodePool& next_pool = node_pools[1 - pool_index];
+        next_pool.clear();
+        tree_root = next_pool.copy_subtree(*child);
+        node_pools[pool_index].clear();
+        _clear_worker_pools();
+        pool_index = 1 - pool_index;
+
+        // Record the raw state of the new root, by playing ``action`` from the state of the old one.
+        if (native_game) {
+            native_game->step(action);
+            native_game->current_state(native_root_state_key.data(), false);
+        } else {
+            if (moves_since_search == 0) {
+                restore_search_root();
+            }
+            simulate_env.attr("step")(action);
+            root_state_key = simulate_env.attr("current_state")()[py::int_(0)].attr("tobytes")();
+        }
+        ++moves_since_search;
+        root_promoted = true;
+    }
+
+    // This function returns the root to search from: the promoted root if its state is the state of the search,
+    // otherwise a new node, the old tree being freed.
+    Node* _prepare_root(bool same_state) {
+        evaluation_caches.clear();
+        graphs.clear();
+        if (!(root_promoted && same_state)) {
+            node_pools[pool_index].clear();
+            _clear_worker_pools();
+            tree_root = node_pools[pool_index].allocate(1);
+        }
+        root_promoted = false;
+        moves_since_search = 0;
+        return tree_root;
+    }
+
+    // This function creates the children of ``node`` for the (action, prior probability) pairs of ``action_probs`` whose action is legal in ``node``.
+    void _expand_legal_children(Node* node, const std::map<int, double>& action_probs) {
+        std::vector<std::pair<int, float>> action_priors;
+        for (const auto& kv : action_probs) {
+            if (node->is_legal(kv.first)) {
+                action_priors.push_back(std::make_pair(kv.first, static_cast<float>(kv.second)));
+            }
+        }
+        node->expand(node_pools[pool_index], action_priors);
+    }
+
+    void _clear_worker_pools() {
+        for (auto& pool : worker_pools) {
+            pool->clear();
+        }
+    }
+
+    // This function sets the number of worker threads of the search of the native game, 0 to search in the calling thread.
+    // With worker threads, the workers descend the same tree concurrently, steered apart by virtual loss, and
+    // ``get_next_action`` expects the batched policy-value function of ``_evaluate_leaves``, which evaluates the leaves of
+    // the workers in batches.
+    void set_num_threads(int threads) {
+        if (threads < 0) {
+            throw std::invalid_argument("num_threads must not be negative");
+        }
+        num_threads = threads;
+    }
+
+    // This function sets the wall-clock budget of every search in microseconds, 0 to always run ``num_simulations``.
+    void set_time_budget(long long budget_us) {
+        if (budget_us < 0) {
+            throw std::invalid_argument("time_budget_us must not be negative");
+        }
+        time_budget_us = budget_us;
+    }
+
+    // This function returns the number of simulations run by the last search, at most ``num_simulations``.
+    int get_num_simulations_done() const {
+        return num_simulations_done;
+    }
+
+    // This function makes the search simulate the given game natively in C++ instead of stepping ``simulate_env``.
+    // Python is then only called to evaluate the leaves, with the native game passed to ``policy_value_func`` in place
+    // of the env (it exposes the same ``legal_actions`` and ``current_state()``).
+    // With ``evaluation_cache``, a leaf whose position has already been evaluated through another move order in the
+    // same tree is expanded with the priors and backs up the value of that evaluation instead of being evaluated again.
+    // The nodes of such a position still keep their own visits and values.
+    // With ``graph_search``, the search builds a graph instead of a tree: the nodes of a position share its children and
+    // its statistics, see ``_descend_graph``, so a position is evaluated once whatever the evaluation cache. It needs a
+    // game whose positions never repeat, which rules out go, and it does not run on worker threads.
+    // ``komi`` is only used by go.
+    void set_native_game(const std::string& game_name, int board_size, bool scale, bool channel_last,
+                         const std::string& battle_mode_in_simulation_env, bool evaluation_cache = false,
+                         float komi = 7.5, bool graph_search = false) {
+        if (battle_mode_in_simulation_env != "self_play_mode" && battle_mode_in_simulation_env != "play_with_bot_mode") {
+            throw std::invalid_argument("unknown battle_mode_in_simulation_env " + battle_mode_in_simulation_env);
+        }
+        if (graph_search && game_name == "go") {
+            throw std::invalid_argument("graph_search needs a game whose positions never repeat, which go does not guarantee");
+        }
+        native_game = make_game(game_name, board_size, scale, channel_last, komi);
+        native_battle_mode = battle_mode_in_simulation_env;
+        use_evaluation_cache = evaluation_cache;
+        this->graph_search = graph_search;
+        evaluation_caches.clear();
+        graphs.clear();
+    }
 
     // This function calculates the Upper Confidence Bound (UCB) score for a given node in the MCTS tree based on the parent node's visit count,
     // the child node's visit count, and the child node's prior probability.
     double _ucb_score(Node* parent, Node* child) {
-        double pb_c = std::log((parent->visit_count + pb_c_base + 1) / pb_c_base) + pb_c_init;
-        pb_c *= std::sqrt(parent->visit_count) / (child->visit_count + 1);
+        return _ucb_score(parent->get_visit_count(), child);
+    }
+
+    // This function calculates the UCB score of ``child`` for the visit count of its parent, which in a search graph is
+    // the visit count of the position of the parent rather than of the node it is reached through.
+    double _ucb_score(int parent_visit_count, Node* child) {
+        double pb_c = std::log((parent_visit_count + pb_c_base + 1) / pb_c_base) + pb_c_init;
+        pb_c *= std::sqrt(parent_visit_count) / (child->get_visit_count() + 1);
 
         double prior_score = pb_c * child->prior_p;
         double value_score = child->get_value();
@@ -56,8 +308,8 @@ public:
     // This function adds Dirichlet noise to the prior probabilities of the actions of a given node to encourage exploration.
     void _add_exploration_noise(Node* node) {
     std::vector<int> actions;
-    for (const auto& kv : node->children) {
-        actions.push_back(kv.first);
+    for (const Node& child : node->children()) {
+        actions.push_back(child.action);
     }
 
     std::default_random_engine generator;
@@ -78,34 +330,38 @@ public:
 
     double frac = root_noise_weight;
     for (size_t i = 0; i < actions.size(); ++i) {
-        node->children[actions[i]]->prior_p = node->children[actions[i]]->prior_p * (1 - frac) + noise[i] * frac;
+        node->get_child(actions[i])->prior_p = node->get_child(actions[i])->prior_p * (1 - frac) + noise[i] * frac;
     }
 }
     // This function selects the child of a given node that has the highest UCB score among the legal actions.
+    // The legal actions cached on the node at expansion are used; they are fetched from ``simulate_env`` only once for a node expanded without them.
     std::pair<int, Node*> _select_child(Node* node, py::object simulate_env) {
+        if (!node->has_legal_actions) {
+            node->set_legal_actions(simulate_env.attr("legal_actions").cast<std::vector<int>>());
+        }
+        return _select_legal_child(node);
+    }
+
+    // This function selects the child of a given node that has the highest UCB score among the legal actions cached on the node.
+    std::pair<int, Node*> _select_legal_child(Node* node) {
+        return _select_legal_child(node, node->get_visit_count());
+    }
+
+    // This function selects the child of ``node`` like ``_select_legal_child``, with ``parent_visit_count`` as the visit
+    // count of ``node``, the visit count of its position in a search graph.
+    std::pair<int, Node*> _select_legal_child(Node* node, int parent_visit_count) {
         int action = -1;
         Node* child = nullptr;
         double best_score = -9999999;
-        for (const auto& kv : node->children) {
-            int action_tmp = kv.first;
-            Node* child_tmp = kv.second;
-
-            py::list legal_actions_py = simulate_env.attr("legal_actions").cast<py::list>();
-
-            std::vector<int> legal_actions;
-            for (py::handle h : legal_actions_py) {
-                legal_actions.push_back(h.cast<int>());
-            }
-
-            if (std::find(legal_actions.begin(), legal_actions.end(), action_tmp) != legal_actions.end()) {
-                double score = _ucb_score(node, child_tmp);
+        for (Node& candidate : node->children()) {
+            if (node->is_legal(candidate.action)) {
+                double score = _ucb_score(parent_visit_count, &candidate);
                 if (score > best_score) {
                     best_score = score;
-                    action = action_tmp;
-                    child = child_tmp;
+                    action = candidate.action;
+                    child = &candidate;
                 }
             }
-
         }
         if (child == nullptr) {
             child = node;
@@ -124,32 +380,84 @@ public:
         leaf_value = result[1].cast<double>();
 
 
-        py::list legal_actions_list = simulate_env.attr("legal_actions").cast<py::list>();
-        std::vector<int> legal_actions = legal_actions_list.cast<std::vector<int>>();
+        node->set_legal_actions(simulate_env.attr("legal_actions").cast<std::vector<int>>());
+        _expand_legal_children(node, action_probs_dict);
 
+        return leaf_value;
+    }
 
-        for (const auto& kv : action_probs_dict) {
-            int action = kv.first;
-            double prior_p = kv.second;
-            if (std::find(legal_actions.begin(), legal_actions.end(), action) != legal_actions.end()) {
-                node->children[action] = new Node(node, prior_p);
-            }
+    // This function expands a leaf node of the native game, calling ``policy_value_func`` with the game in place of the env.
+    double _expand_leaf_node_native(Node* node, Game* game, py::object policy_value_func) {
+        if (const CachedEvaluation* evaluation = _find_cached_evaluation(node, game)) {
+            return _expand_from_cached_evaluation(node, *evaluation);
         }
+        py::tuple result = policy_value_func(py::cast(game, py::return_value_policy::reference));
+        std::map<int, double> action_probs_dict = result[0].cast<std::map<int, double>>();
+        double leaf_value = result[1].cast<double>();
 
+        node->set_legal_actions(game->legal_actions());
+        _expand_legal_children(node, action_probs_dict);
+        _cache_evaluation(node, game->zobrist_hash(), leaf_value);
         return leaf_value;
     }
 
+    // This function returns the evaluation of the current position of ``game`` recorded in the tree of ``node`` if the
+    // evaluation cache is used, otherwise nullptr.
+    const CachedEvaluation* _find_cached_evaluation(Node* node, Game* game) {
+        if (!use_evaluation_cache) {
+            return nullptr;
+        }
+        auto table = evaluation_caches.find(_root_of(node));
+        if (table == evaluation_caches.end()) {
+            return nullptr;
+        }
+        auto it = table->second.find(game->zobrist_hash());
+        return it != table->second.end() ? &it->second : nullptr;
+    }
+
+    // This function records the evaluation of ``node``, just expanded from the policy-value function, in the table of its
+    // tree if the evaluation cache is used. The priors are those of the children, before any root noise is added.
+    void _cache_evaluation(Node* node, uint64_t hash, double value) {
+        if (!use_evaluation_cache || graph_search) {
+            return;
+        }
+        CachedEvaluation evaluation{node->legal_actions, std::vector<std::pair<int, float>>(), value};
+        for (const Node& child : node->children()) {
+            evaluation.action_priors.push_back(std::make_pair(child.action, child.prior_p));
+        }
+        evaluation_caches[_root_of(node)].emplace(hash, std::move(evaluation));
+    }
+
+    // This function expands ``node`` with the legal actions and priors of ``evaluation``, the cached evaluation of the
+    // same position, and returns its value in place of an evaluation. The value is the one of the policy-value function,
+    // so it holds neither the visits nor the virtual loss of the other nodes of that position.
+    double _expand_from_cached_evaluation(Node* node, const CachedEvaluation& evaluation) {
+        node->set_legal_actions(evaluation.legal_actions);
+        node->expand(node_pools[pool_index], evaluation.action_priors);
+        return evaluation.value;
+    }
+
+    static Node* _root_of(Node* node) {
+        while (node->parent != nullptr) {
+            node = node->parent;
+        }
+        return node;
+    }
+
     // This function returns the next action to take and the probabilities of each action based on the current state and the policy-value function.
     std::pair<int, std::vector<double>> get_next_action(py::object state_config_for_env_reset, py::object policy_value_func, double temperature, bool sample) {
-        Node* root = new Node();
+        _start_search_clock();
+        if (native_game) {
+            return _get_next_action_native(state_config_for_env_reset, policy_value_func, temperature, sample);
+        }
 
         py::object init_state = state_config_for_env_reset["init_state"];
         if (!init_state.is_none()) {
             init_state = py::bytes(init_state.attr("tobytes")());
         }
         py::object katago_game_state = state_config_for_env_reset["katago_game_state"];
-        if (!katago_game_state.is_none()) {
-        // TODO(pu): polish efficiency
+        // A state already serialized by the env, e.g. the bytes of ``Game.get_state``, is passed to every reset as is.
+        if (!katago_game_state.is_none() && !py::isinstance<py::bytes>(katago_game_state)) {
             katago_game_state = py::module::import("pickle").attr("dumps")(katago_game_state);
         }
         simulate_env.attr("reset")(
@@ -158,26 +466,735 @@ public:
             state_config_for_env_reset["katago_policy_init"].cast<bool>(),
             katago_game_state
         );
+        // If the env supports snapshots, every simulation restores the root state instead of resetting the env again.
+        bool use_snapshot = py::hasattr(simulate_env, "clone_state") && py::hasattr(simulate_env, "restore_state");
+        py::object root_snapshot = use_snapshot ? simulate_env.attr("clone_state")() : py::none();
+
+        auto restore_root = [=]() {
+            if (use_snapshot) {
+                simulate_env.attr("restore_state")(root_snapshot);
+            } else {
+                simulate_env.attr("reset")(
+                    state_config_for_env_reset["start_player_index"].cast<int>(),
+                    init_state,
+                    state_config_for_env_reset["katago_policy_init"].cast<bool>(),
+                    katago_game_state
+                );
+            }
+            simulate_env.attr("battle_mode") = simulate_env.attr("battle_mode_in_simulation_env");
+        };
+        int action_space_size = simulate_env.attr("action_space").attr("n").cast<int>();
+
+        py::object state_key = simulate_env.attr("current_state")()[py::int_(0)].attr("tobytes")();
+        Node* root = _prepare_root(state_key.equal(root_state_key));
+        root_state_key = state_key;
+        restore_search_root = restore_root;
 
-        _expand_leaf_node(root, simulate_env, policy_value_func);
+        // A root kept from the previous move is already expanded.
+        if (root->is_leaf()) {
+            if (leaf_batch_size > 1) {
+                // ``policy_value_func`` is the batched policy-value function, see ``_evaluate_leaves``.
+                std::vector<PendingLeaf> root_leaf(1, PendingLeaf{root, simulate_env.attr("legal_actions").cast<std::vector<int>>(), false, 0.0, 0});
+                py::list root_observation;
+                root_observation.append(simulate_env.attr("current_state")()[py::int_(1)]);
+                _evaluate_leaves(root_leaf, py::module::import("numpy").attr("stack")(root_observation), policy_value_func, action_space_size);
+            } else {
+                _expand_leaf_node(root, simulate_env, policy_value_func);
+            }
+        }
         if (sample) {
             _add_exploration_noise(root);
         }
-        for (int n = 0; n < num_simulations; ++n) {
-            simulate_env.attr("reset")(
-            state_config_for_env_reset["start_player_index"].cast<int>(),
-            init_state,
-            state_config_for_env_reset["katago_policy_init"].cast<bool>(),
-            katago_game_state
-        );
-            simulate_env.attr("battle_mode") = simulate_env.attr("battle_mode_in_simulation_env");
-            _simulate(root, simulate_env, policy_value_func);
+        int n = 0;
+        while (n < num_simulations && !_out_of_time(n)) {
+            if (leaf_batch_size > 1) {
+                n += _simulate_batch(root, simulate_env, policy_value_func, std::min(leaf_batch_size, num_simulations - n), restore_root);
+            } else {
+                restore_root();
+                _simulate(root, simulate_env, policy_value_func);
+                ++n;
+            }
+        }
+        num_simulations_done = n;
+
+        return _select_root_action(root, action_space_size, temperature, sample);
+    }
+
+    // This function is the native-game counterpart of ``get_next_action``: the simulations step the C++ game.
+    std::pair<int, std::vector<double>> _get_next_action_native(py::object state_config_for_env_reset, py::object policy_value_func, double temperature, bool sample) {
+        if (graph_search && num_threads > 0) {
+            throw std::invalid_argument("graph_search does not run on worker threads, set num_threads to 0");
+        }
+        // The game is reset once: every simulation undoes its moves, so the next one starts from the root position again.
+        Game* game = native_game.get();
+        _reset_game(game, state_config_for_env_reset);
+
+        std::vector<int> shape = game->state_shape();
+        std::vector<float> state_key(std::accumulate(shape.begin(), shape.end(), 1, std::multiplies<int>()));
+        game->current_state(state_key.data(), false);
+        Node* root = _prepare_root(state_key == native_root_state_key);
+        native_root_state_key = state_key;
+
+        // A root kept from the previous move is already expanded.
+        if (root->is_leaf()) {
+            if (leaf_batch_size > 1 || num_threads > 0) {
+                // ``policy_value_func`` is the batched policy-value function, see ``_evaluate_leaves``.
+                std::vector<PendingLeaf> root_leaf(1, PendingLeaf{root, game->legal_actions(), false, 0.0, game->zobrist_hash()});
+                _evaluate_leaves(root_leaf, _stack_states(std::vector<Game*>(1, game)), policy_value_func, game->action_space_size());
+            } else {
+                _expand_leaf_node_native(root, game, policy_value_func);
+            }
+        }
+        if (sample) {
+            _add_exploration_noise(root);
+        }
+        int n = 0;
+        if (num_threads > 0) {
+            n = _search_parallel_native(root, game, policy_value_func);
+        }
+        while (num_threads == 0 && n < num_simulations && !_out_of_time(n)) {
+            if (leaf_batch_size > 1) {
+                n += _simulate_batch_native(root, game, policy_value_func, std::min(leaf_batch_size, num_simulations - n));
+            } else {
+                _simulate_native(root, game, policy_value_func);
+                ++n;
+            }
+        }
+        num_simulations_done = n;
+
+        return _select_root_action(root, game->action_space_size(), temperature, sample);
+    }
+
+    // This function runs the ``num_simulations`` simulations of the native game from ``root`` on ``num_threads`` worker
+    // threads, which share the tree. Selection and backup are lock-free: the statistics of the nodes are atomic, and a
+    // worker claims a leaf before expanding it, the others reaching that leaf waiting for its children. The calling thread
+    // keeps the GIL and evaluates the leaves of the workers in batches with ``policy_value_func_batch``. Returns the number
+    // of simulations run.
+    int _search_parallel_native(Node* root, Game* game, py::object policy_value_func_batch) {
+        while (static_cast<int>(worker_pools.size()) < num_threads) {
+            worker_pools.emplace_back(new NodePool());
+        }
+        EvaluationQueue queue;
+        queue.live_workers = num_threads;
+        std::atomic<int> next_simulation(0);
+        std::vector<std::unique_ptr<Game>> worker_games;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < num_threads; ++t) {
+            worker_games.emplace_back(game->clone());
+        }
+        for (int t = 0; t < num_threads; ++t) {
+            workers.emplace_back([this, root, &worker_games, &queue, &next_simulation, t]() {
+                try {
+                    _parallel_worker(root, worker_games[t].get(), worker_pools[t].get(), queue, next_simulation);
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    if (!queue.error) {
+                        queue.error = std::current_exception();
+                    }
+                    queue.aborted = true;
+                    queue.results_cv.notify_all();
+                }
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                --queue.live_workers;
+                queue.requests_cv.notify_all();
+            });
+        }
+
+        std::exception_ptr error;
+        try {
+            _evaluate_parallel_requests(queue, policy_value_func_batch, game->action_space_size());
+        } catch (...) {
+            error = std::current_exception();
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.aborted = true;
+            queue.results_cv.notify_all();
+        }
+        {
+            py::gil_scoped_release release;
+            for (auto& worker : workers) {
+                worker.join();
+            }
+        }
+        if (!error) {
+            error = queue.error;
+        }
+        if (error) {
+            // A worker may have failed in the middle of a simulation, so the tree is not kept for the next search.
+            reset();
+            std::rethrow_exception(error);
+        }
+        return next_simulation.load();
+    }
+
+    // This function is the loop of a worker thread of ``_search_parallel_native``, which plays the simulations in ``game``,
+    // a copy of the root position, and allocates its expansions from ``pool``. It does not touch any Python object.
+    // If the search is aborted, the simulation in progress is given up: its virtual loss and moves are undone, and the
+    // leaf it claimed is released, so that the tree only holds the simulations that were backed up.
+    void _parallel_worker(Node* root, Game* game, NodePool* pool, EvaluationQueue& queue, std::atomic<int>& next_simulation) {
+        bool self_play = native_battle_mode == "self_play_mode";
+        // The simulations are numbered as they start; past the deadline, no simulation starts after the first one.
+        while (true) {
+            int n = next_simulation.load();
+            if (n >= num_simulations || _out_of_time(n)) {
+                break;
+            }
+            if (!next_simulation.compare_exchange_weak(n, n + 1)) {
+                continue;
+            }
+            Node* node = root;
+            int depth = 0;
+            bool claimed = false;
+            double leaf_value = 0.0;
+            while (true) {
+                if (node->expand_state.load(std::memory_order_acquire) == Node::EXPANDED) {
+                    int action;
+                    Node* child;
+                    std::tie(action, child) = _select_legal_child(node);
+                    if (action != -1) {
+                        node = child;
+                        game->step(action);
+                        ++depth;
+                        continue;
+                    }
+                }
+                std::pair<bool, int> done_winner = game->get_done_winner();
+                if (done_winner.first) {
+                    leaf_value = _terminal_value(done_winner.second, game->current_player(), self_play);
+                    break;
+                }
+                int unexpanded = Node::UNEXPANDED;
+                if (node->expand_state.compare_exchange_strong(unexpanded, Node::CLAIMED)) {
+                    claimed = true;
+                    break;
+                }
+                // Another worker is expanding the node: wait for its children and go on descending.
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                ++queue.blocked_workers;
+                queue.requests_cv.notify_all();
+                queue.results_cv.wait(lock, [&]() {
+                    return queue.aborted || node->expand_state.load(std::memory_order_acquire) == Node::EXPANDED;
+                });
+                --queue.blocked_workers;
+                if (queue.aborted) {
+                    lock.unlock();
+                    for (; depth > 0; --depth) {
+                        game->undo();
+                    }
+                    return;
+                }
+            }
+
+            // The virtual loss steers the other workers away from this path while the leaf is evaluated.
+            _apply_virtual_loss(node, 1);
+            if (claimed) {
+                EvaluationRequest request{game, std::vector<float>(), 0.0, false};
+                {
+                    std::unique_lock<std::mutex> lock(queue.mutex);
+                    queue.requests.push_back(&request);
+                    queue.requests_cv.notify_all();
+                    queue.results_cv.wait(lock, [&]() { return request.ready || queue.aborted; });
+                    if (!request.ready) {
+                        queue.requests.erase(std::remove(queue.requests.begin(), queue.requests.end(), &request),
+                                             queue.requests.end());
+                        lock.unlock();
+                        node->expand_state.store(Node::UNEXPANDED, std::memory_order_release);
+                        _apply_virtual_loss(node, -1);
+                        for (; depth > 0; --depth) {
+                            game->undo();
+                        }
+                        return;
+                    }
+                }
+                node->set_legal_actions(game->legal_actions());
+                std::vector<std::pair<int, float>> action_priors;
+                for (int action : node->legal_actions) {
+                    action_priors.push_back(std::make_pair(action, request.action_probs[action]));
+                }
+                node->expand(*pool, action_priors);
+                {
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                }
+                queue.results_cv.notify_all();
+                leaf_value = request.value;
+            }
+            _apply_virtual_loss(node, -1);
+            node->update_recursive(self_play ? -leaf_value : leaf_value, native_battle_mode);
+            for (; depth > 0; --depth) {
+                game->undo();
+            }
+        }
+    }
+
+    // This function evaluates the requests of the workers of ``_search_parallel_native`` until they all exit. A batch is
+    // evaluated as soon as every live worker is either waiting for its request or for a node claimed by another worker.
+    void _evaluate_parallel_requests(EvaluationQueue& queue, py::object policy_value_func_batch, int action_space_size) {
+        while (true) {
+            std::vector<EvaluationRequest*> batch;
+            {
+                py::gil_scoped_release release;
+                std::unique_lock<std::mutex> lock(queue.mutex);
+                queue.requests_cv.wait(lock, [&]() {
+                    return queue.aborted || queue.live_workers == 0 ||
+                           (!queue.requests.empty() &&
+                            static_cast<int>(queue.requests.size()) + queue.blocked_workers >= queue.live_workers);
+                });
+                if (queue.aborted || queue.requests.empty()) {
+                    return;
+                }
+                batch.swap(queue.requests);
+            }
+
+            std::vector<Game*> states;
+            std::vector<std::vector<int>> legal_actions_batch;
+            for (EvaluationRequest* request : batch) {
+                states.push_back(request->game);
+                legal_actions_batch.push_back(request->game->legal_actions());
+            }
+            py::tuple result = policy_value_func_batch(_stack_states(states), legal_actions_batch);
+            auto action_probs = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[0]);
+            auto values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[1]);
+            if (!action_probs || !values || static_cast<size_t>(action_probs.size()) != batch.size() * action_space_size ||
+                static_cast<size_t>(values.size()) != batch.size()) {
+                throw std::invalid_argument("the batched policy-value function must return (N, action_space_size) probabilities and (N, ) values");
+            }
+
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                const float* probs = action_probs.data() + i * action_space_size;
+                batch[i]->action_probs.assign(probs, probs + action_space_size);
+                batch[i]->value = values.data()[i];
+                batch[i]->ready = true;
+            }
+            queue.results_cv.notify_all();
+        }
+    }
+
+    // This function starts the clock of a search, whose deadline is ``time_budget_us`` from now.
+    void _start_search_clock() {
+        search_deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(time_budget_us);
+    }
+
+    // This function returns true if the search has a time budget and its deadline has passed. A search always runs at
+    // least one simulation, so that the root has visits to choose the action from.
+    bool _out_of_time(int simulations_done) const {
+        return time_budget_us > 0 && simulations_done > 0 && std::chrono::steady_clock::now() >= search_deadline;
+    }
+
+    // This function resets the native game to the ``start_player_index`` and ``init_state`` of ``state_config_for_env_reset``,
+    // or, if it has a ``native_game_state``, to that position as returned by ``Game.get_state``. The binary state holds
+    // what the board does not, such as the ko point of go, and is restored without going through pickle.
+    static void _reset_game(Game* game, py::object state_config_for_env_reset) {
+        py::object native_game_state = state_config_for_env_reset.attr("get")("native_game_state");
+        if (!native_game_state.is_none()) {
+            game->set_state(native_game_state.cast<std::string>());
+            return;
+        }
+        int start_player_index = state_config_for_env_reset["start_player_index"].cast<int>();
+        std::vector<int> init_board;
+        py::object init_state = state_config_for_env_reset["init_state"];
+        if (!init_state.is_none()) {
+            auto board = py::array_t<int, py::array::c_style | py::array::forcecast>::ensure(init_state);
+            if (!board) {
+                throw std::invalid_argument("init_state must be convertible to an int array");
+            }
+            init_board.assign(board.data(), board.data() + board.size());
+        }
+        game->reset(start_player_index, init_board);
+    }
+
+    // This function performs a simulation of the native game from a given node until a leaf node or a terminal state is reached,
+    // then takes back the moves it played so that ``game`` is left in the position of the given node.
+    void _simulate_native(Node* node, Game* game, py::object policy_value_func) {
+        if (graph_search) {
+            _simulate_graph_native(node, game, policy_value_func);
+            return;
+        }
+        int depth = 0;
+        while (!node->is_leaf()) {
+            int action;
+            std::tie(action, node) = _select_legal_child(node);
+            if (action == -1) {
+                break;
+            }
+            game->step(action);
+            ++depth;
+        }
+
+        std::pair<bool, int> done_winner = game->get_done_winner();
+        bool self_play = native_battle_mode == "self_play_mode";
+        double leaf_value;
+        if (!done_winner.first) {
+            leaf_value = _expand_leaf_node_native(node, game, policy_value_func);
+        } else {
+            leaf_value = _terminal_value(done_winner.second, game->current_player(), self_play);
+        }
+        node->update_recursive(self_play ? -leaf_value : leaf_value, native_battle_mode);
+        for (; depth > 0; --depth) {
+            game->undo();
+        }
+    }
+
+    // This function runs up to ``batch_size`` simulations of the native game whose leaves are evaluated together.
+    // Every gathered leaf adds a virtual loss to its path, which steers the next descents of the batch to other leaves;
+    // the batch stops early if a descent reaches a leaf that is already pending. Returns the number of simulations run.
+    int _simulate_batch_native(Node* root, Game* game, py::object policy_value_func_batch, int batch_size) {
+        std::vector<PendingLeaf> leaves;
+        std::vector<Game*> states;
+        _gather_leaves_native(root, game, batch_size, leaves, states);
+        if (!states.empty()) {
+            py::object observations = _stack_states(states);
+            for (Game* state : states) {
+                delete state;
+            }
+            _evaluate_leaves(leaves, observations, policy_value_func_batch, game->action_space_size());
+        }
+        _backup_leaves(leaves, native_battle_mode);
+        return static_cast<int>(leaves.size());
+    }
+
+    // This function descends up to ``batch_size`` times from ``root`` of the native game and appends the reached leaves to
+    // ``leaves``, with virtual loss on their paths, and a copy of the state of each leaf to evaluate to ``states``.
+    // It does not touch any Python object, so that it can run without the GIL. Returns the number of leaves appended.
+    int _gather_leaves_native(Node* root, Game* game, int batch_size, std::vector<PendingLeaf>& leaves, std::vector<Game*>& states) {
+        if (graph_search) {
+            return _gather_graph_leaves(root, game, batch_size, leaves, states);
+        }
+        bool self_play = native_battle_mode == "self_play_mode";
+        size_t first_leaf = leaves.size();
+        for (int b = 0; b < batch_size; ++b) {
+            Node* node = root;
+            int depth = 0;
+            while (!node->is_leaf()) {
+                int action;
+                std::tie(action, node) = _select_legal_child(node);
+                if (action == -1) {
+                    break;
+                }
+                game->step(action);
+                ++depth;
+            }
+
+            bool pending = _is_pending(leaves, node, first_leaf);
+            if (!pending) {
+                PendingLeaf leaf{node, std::vector<int>(), false, 0.0, game->zobrist_hash()};
+                std::pair<bool, int> done_winner = game->get_done_winner();
+                if (done_winner.first) {
+                    leaf.done = true;
+                    leaf.leaf_value = _terminal_value(done_winner.second, game->current_player(), self_play);
+                } else if (const CachedEvaluation* evaluation = _find_cached_evaluation(node, game)) {
+                    leaf.done = true;
+                    leaf.leaf_value = _expand_from_cached_evaluation(node, *evaluation);
+                } else {
+                    leaf.legal_actions = game->legal_actions();
+                    states.push_back(game->clone());
+                }
+                _apply_virtual_loss(node, 1);
+                leaves.push_back(leaf);
+            }
+            for (; depth > 0; --depth) {
+                game->undo();
+            }
+            if (pending) {
+                break;
+            }
+        }
+        return static_cast<int>(leaves.size() - first_leaf);
+    }
+
+    // This function descends the search graph of ``graph_search`` from ``root``, playing the selected moves in ``game``,
+    // and appends the nodes it goes through, with their positions, to ``path``. A node reaching a position already
+    // expanded through another move order shares the children of that position, so the descent goes on below it. As in
+    // Monte-Carlo Graph Search, the descent stops at a node that has fewer visits than its position and whose value is off
+    // the value of the position by more than ``graph_value_tolerance``: the node then backs up the value bringing it to the
+    // value of its position. Returns true if the last node of ``path`` is a new position to evaluate; otherwise sets
+    // ``leaf_value`` to the value to back up, from the view of the player to move like the values of ``_simulate``.
+    bool _descend_graph(Node* root, Game* game, std::vector<GraphStep>& path, double& leaf_value) {
+        bool self_play = native_battle_mode == "self_play_mode";
+        std::unordered_map<uint64_t, GraphPosition>& graph = graphs[root];
+        path.push_back(GraphStep{root, nullptr});
+        while (!path.back().node->is_leaf()) {
+            Node* node = path.back().node;
+            GraphPosition* node_position = path.back().position;
+            int action;
+            Node* child;
+            std::tie(action, child) = _select_legal_child(node, node_position ? node_position->visit_count : node->get_visit_count());
+            if (action == -1) {
+                break;
+            }
+            game->step(action);
+            auto it = graph.find(game->zobrist_hash());
+            GraphPosition* position = it != graph.end() ? &it->second : nullptr;
+            path.push_back(GraphStep{child, position});
+            if (position == nullptr || position->node == child) {
+                continue;
+            }
+            if (child->is_leaf()) {
+                child->share_children(*position->node);
+            }
+            int visits = child->get_visit_count();
+            if (position->visit_count > visits) {
+                double position_value = position->value_sum / position->visit_count;
+                double value_gap = position_value - child->get_value();
+                if (std::abs(value_gap) > graph_value_tolerance) {
+                    double target = std::min(1.0, std::max(-1.0, visits * value_gap + position_value));
+                    path.back().position = nullptr;
+                    leaf_value = self_play ? -target : target;
+                    return false;
+                }
+            }
+        }
+        std::pair<bool, int> done_winner = game->get_done_winner();
+        if (done_winner.first) {
+            leaf_value = _terminal_value(done_winner.second, game->current_player(), self_play);
+            return false;
+        }
+        return true;
+    }
+
+    // This function is the ``graph_search`` counterpart of ``_simulate_native``.
+    void _simulate_graph_native(Node* root, Game* game, py::object policy_value_func) {
+        std::vector<GraphStep> path;
+        double leaf_value;
+        if (_descend_graph(root, game, path, leaf_value)) {
+            leaf_value = _expand_leaf_node_native(path.back().node, game, policy_value_func);
+            _add_graph_position(path, game->zobrist_hash());
+        }
+        _backup_graph(path, leaf_value);
+        for (size_t depth = 1; depth < path.size(); ++depth) {
+            game->undo();
+        }
+    }
+
+    // This function is the ``graph_search`` counterpart of ``_gather_leaves_native``. The batch also stops early at a
+    // leaf whose position is already pending through another move order, so that a position is expanded once.
+    int _gather_graph_leaves(Node* root, Game* game, int batch_size, std::vector<PendingLeaf>& leaves, std::vector<Game*>& states) {
+        size_t first_leaf = leaves.size();
+        for (int b = 0; b < batch_size; ++b) {
+            PendingLeaf leaf{nullptr, std::vector<int>(), false, 0.0, 0};
+            leaf.done = !_descend_graph(root, game, leaf.path, leaf.leaf_value);
+            leaf.node = leaf.path.back().node;
+            leaf.hash = game->zobrist_hash();
+            size_t depth = leaf.path.size() - 1;
+
+            bool pending = false;
+            for (size_t i = first_leaf; i < leaves.size(); ++i) {
+                pending = pending || leaves[i].node == leaf.node || (!leaf.done && leaves[i].hash == leaf.hash);
+            }
+            if (!pending) {
+                if (!leaf.done) {
+                    leaf.legal_actions = game->legal_actions();
+                    states.push_back(game->clone());
+                }
+                _apply_graph_virtual_loss(leaf.path, 1);
+                leaves.push_back(std::move(leaf));
+            }
+            for (; depth > 0; --depth) {
+                game->undo();
+            }
+            if (pending) {
+                break;
+            }
+        }
+        return static_cast<int>(leaves.size() - first_leaf);
+    }
+
+    // This function records the position of the last node of ``path``, just expanded, in the graph of its root. The root
+    // is not recorded: no other node reaches its position, whose statistics are those of the root.
+    void _add_graph_position(std::vector<GraphStep>& path, uint64_t hash) {
+        if (path.size() < 2 || path.back().position != nullptr) {
+            return;
+        }
+        std::unordered_map<uint64_t, GraphPosition>& graph = graphs[path.front().node];
+        path.back().position = &graph.emplace(hash, GraphPosition{path.back().node, 0, 0.0}).first->second;
+    }
+
+    // This function backs up ``leaf_value``, the value of the last node of ``path`` from the view of its player to move,
+    // to the nodes of ``path`` and their positions. It follows the path rather than the parents, which in a search graph
+    // lead to the first node of every position.
+    void _backup_graph(const std::vector<GraphStep>& path, double leaf_value) {
+        bool self_play = native_battle_mode == "self_play_mode";
+        double value = self_play ? -leaf_value : leaf_value;
+        for (auto step = path.rbegin(); step != path.rend(); ++step) {
+            step->node->update(value);
+            if (step->position != nullptr) {
+                ++step->position->visit_count;
+                step->position->value_sum += value;
+            }
+            if (self_play) {
+                value = -value;
+            }
+        }
+    }
+
+    // This function is the ``graph_search`` counterpart of ``_apply_virtual_loss``, which also adds the loss to the
+    // positions of the path.
+    void _apply_graph_virtual_loss(const std::vector<GraphStep>& path, int sign) {
+        for (const GraphStep& step : path) {
+            step.node->visit_count.fetch_add(sign, std::memory_order_relaxed);
+            step.node->add_value(-sign * virtual_loss);
+            if (step.position != nullptr) {
+                step.position->visit_count += sign;
+                step.position->value_sum -= sign * virtual_loss;
+            }
+        }
+    }
+
+    // This function is the batched counterpart of ``_simulate`` for a Python ``simulate_env``, which ``restore_root``
+    // brings back to the root state before every descent.
+    int _simulate_batch(Node* root, py::object simulate_env, py::object policy_value_func_batch, int batch_size,
+                        const std::function<void()>& restore_root) {
+        std::string battle_mode = simulate_env.attr("battle_mode_in_simulation_env").cast<std::string>();
+        std::vector<PendingLeaf> leaves;
+        py::list observations;
+        for (int b = 0; b < batch_size; ++b) {
+            restore_root();
+            Node* node = root;
+            while (!node->is_leaf()) {
+                int action;
+                std::tie(action, node) = _select_child(node, simulate_env);
+                if (action == -1) {
+                    break;
+                }
+                simulate_env.attr("step")(action);
+            }
+            if (_is_pending(leaves, node)) {
+                break;
+            }
+
+            PendingLeaf leaf{node, std::vector<int>(), false, 0.0, 0};
+            py::tuple result = simulate_env.attr("get_done_winner")();
+            if (result[0].cast<bool>()) {
+                leaf.done = true;
+                leaf.leaf_value = _terminal_value(result[1].cast<int>(), simulate_env.attr("current_player").cast<int>(),
+                                                  battle_mode == "self_play_mode");
+            } else {
+                leaf.legal_actions = simulate_env.attr("legal_actions").cast<std::vector<int>>();
+                observations.append(simulate_env.attr("current_state")()[py::int_(1)]);
+            }
+            _apply_virtual_loss(node, 1);
+            leaves.push_back(leaf);
+        }
+
+        if (py::len(observations) > 0) {
+            _evaluate_leaves(leaves, py::module::import("numpy").attr("stack")(observations), policy_value_func_batch,
+                             simulate_env.attr("action_space").attr("n").cast<int>());
+        }
+        _backup_leaves(leaves, battle_mode);
+        return static_cast<int>(leaves.size());
+    }
+
+    // This function evaluates the leaves that are not done with one call of the batched policy-value function and expands them.
+    // ``policy_value_func_batch(observations, legal_actions)`` receives the stacked (N, ...) observations of the N leaves and
+    // the list of their legal actions, and returns the (N, action_space_size) action probabilities and the (N, ) values.
+    void _evaluate_leaves(std::vector<PendingLeaf>& leaves, py::object observations, py::object policy_value_func_batch,
+                          int action_space_size) {
+        std::vector<std::vector<int>> legal_actions_batch;
+        for (const auto& leaf : leaves) {
+            if (!leaf.done) {
+                legal_actions_batch.push_back(leaf.legal_actions);
+            }
+        }
+        py::tuple result = policy_value_func_batch(observations, legal_actions_batch);
+        auto action_probs = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[0]);
+        auto values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[1]);
+        size_t num_leaves = legal_actions_batch.size();
+        if (!action_probs || !values || static_cast<size_t>(action_probs.size()) != num_leaves * action_space_size ||
+            static_cast<size_t>(values.size()) != num_leaves) {
+            throw std::invalid_argument("the batched policy-value function must return (N, action_space_size) probabilities and (N, ) values");
+        }
+
+        size_t i = 0;
+        for (auto& leaf : leaves) {
+            if (leaf.done) {
+                continue;
+            }
+            _expand_evaluated_leaf(leaf, action_probs.data() + i * action_space_size, values.data()[i]);
+            ++i;
         }
+    }
+
+    // This function expands the pending ``leaf`` with the priors ``probs`` of all the actions and sets its value.
+    void _expand_evaluated_leaf(PendingLeaf& leaf, const float* probs, double value) {
+        leaf.node->set_legal_actions(leaf.legal_actions);
+        std::vector<std::pair<int, float>> action_priors;
+        for (int action : leaf.node->legal_actions) {
+            action_priors.push_back(std::make_pair(action, probs[action]));
+        }
+        leaf.node->expand(node_pools[pool_index], action_priors);
+        leaf.leaf_value = value;
+        _cache_evaluation(leaf.node, leaf.hash, value);
+    }
 
+    // This function removes the virtual loss of the pending leaves and backs up their values. The position of a leaf of
+    // ``graph_search`` expanded by the batch is recorded once its virtual loss is removed, which it was not added to.
+    void _backup_leaves(std::vector<PendingLeaf>& leaves, const std::string& battle_mode) {
+        for (auto& leaf : leaves) {
+            if (!leaf.path.empty()) {
+                _apply_graph_virtual_loss(leaf.path, -1);
+                if (!leaf.done) {
+                    _add_graph_position(leaf.path, leaf.hash);
+                }
+                _backup_graph(leaf.path, leaf.leaf_value);
+                continue;
+            }
+            _apply_virtual_loss(leaf.node, -1);
+            leaf.node->update_recursive(battle_mode == "self_play_mode" ? -leaf.leaf_value : leaf.leaf_value, battle_mode);
+        }
+    }
+
+    // This function adds (sign = 1) or removes (sign = -1) one virtual visit and ``virtual_loss`` on the path from ``node`` to the root.
+    // Every node value is seen from the player who selects it, so the loss makes each node of the path less attractive to its selector.
+    void _apply_virtual_loss(Node* node, int sign) {
+        for (; node != nullptr; node = node->parent) {
+            node->visit_count.fetch_add(sign, std::memory_order_relaxed);
+            node->add_value(-sign * virtual_loss);
+        }
+    }
+
+    // This function stacks the state planes of the native games into one (N, ...) float32 array.
+    static py::array_t<float> _stack_states(const std::vector<Game*>& states) {
+        std::vector<int> state_shape = states[0]->state_shape();
+        std::vector<py::ssize_t> shape(1, static_cast<py::ssize_t>(states.size()));
+        size_t state_size = 1;
+        for (int dim : state_shape) {
+            shape.push_back(dim);
+            state_size *= dim;
+        }
+        py::array_t<float> observations(shape);
+        float* data = observations.mutable_data();
+        for (size_t i = 0; i < states.size(); ++i) {
+            states[i]->current_state(data + i * state_size);
+        }
+        return observations;
+    }
+
+    static bool _is_pending(const std::vector<PendingLeaf>& leaves, Node* node, size_t first_leaf = 0) {
+        for (size_t i = first_leaf; i < leaves.size(); ++i) {
+            if (leaves[i].node == node) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // This function returns the value of a terminal state from the view of its player to move, as in ``_simulate``.
+    static double _terminal_value(int winner, int current_player, bool self_play) {
+        if (winner == -1) {
+            return 0;
+        }
+        if (self_play) {
+            return (current_player == winner) ? 1 : -1;
+        }
+        return (winner == 1) ? 1 : -1;
+    }
+
+    // This function turns the visit counts of the root children into the action probabilities and picks the action to play.
+    std::pair<int, std::vector<double>> _select_root_action(Node* root, int action_space_size, double temperature, bool sample) {
         std::vector<std::pair<int, int>> action_visits;
-        for (int action = 0; action < simulate_env.attr("action_space").attr("n").cast<int>(); ++action) {
-            if (root->children.count(action)) {
-                action_visits.push_back(std::make_pair(action, root->children[action]->visit_count));
+        for (int action = 0; action < action_space_size; ++action) {
+            Node* child = root->get_child(action);
+            if (child != nullptr) {
+                action_visits.push_back(std::make_pair(action, child->get_visit_count()));
             } else {
                 action_visits.push_back(std::make_pair(action, 0));
             }
@@ -316,33 +1333,250 @@ private:
 
 };
 
-// This function uses pybind11 to expose the Node and MCTS classes to Python.
+// This part defines the BatchedMCTS class, which searches the states of several native games at once.
+// All the trees live in the node pool of one MCTS, and every round descends all of them before evaluating the leaves
+// of all the games with a single call of the batched policy-value function. The descents do not touch Python and run
+// with the GIL released.
+class BatchedMCTS {
+    MCTS searcher;  // Holds the search parameters, the native game prototype and the node pool shared by all the trees
+    std::vector<std::unique_ptr<Game>> games;  // One copy of the native game per searched state
+    std::vector<int> num_simulations_done;  // The number of simulations run for each state by the last search
+
+public:
+    BatchedMCTS(const std::string& game_name, int num_simulations=800,
+                double pb_c_base=19652, double pb_c_init=1.25,
+                double root_dirichlet_alpha=0.3, double root_noise_weight=0.25,
+                int board_size=15, bool scale=true, bool channel_last=false,
+                const std::string& battle_mode_in_simulation_env="self_play_mode",
+                int leaf_batch_size=1, double virtual_loss=1.0, bool evaluation_cache=false, float komi=7.5,
+                bool graph_search=false)
+        : searcher(512, num_simulations, pb_c_base, pb_c_init, root_dirichlet_alpha, root_noise_weight, py::none(),
+                   std::max(leaf_batch_size, 1), virtual_loss) {
+        searcher.set_native_game(game_name, board_size, scale, channel_last, battle_mode_in_simulation_env, evaluation_cache,
+                                 komi, graph_search);
+    }
+
+    // This function sets the default wall-clock budget of the search of every state in microseconds, 0 for none.
+    void set_time_budget(long long budget_us) {
+        searcher.set_time_budget(budget_us);
+    }
+
+    // This function returns the number of simulations run for each state by the last search.
+    std::vector<int> get_num_simulations_done() const {
+        return num_simulations_done;
+    }
+
+    // This function searches the states of ``state_configs_for_env_reset`` together and returns the action to take and
+    // the action probabilities of each of them, in the same order. A state config may carry its own ``time_budget_us``;
+    // a state whose budget has run out stops gathering leaves, checked between rounds, while the others go on.
+    // ``policy_value_func_batch`` is the batched policy-value function of ``MCTS::_evaluate_leaves``, called once per round
+    // with the leaves of all the games.
+    std::vector<std::pair<int, std::vector<double>>> get_next_actions(py::list state_configs_for_env_reset, py::object policy_value_func_batch,
+                                                                      double temperature, bool sample) {
+        auto start = std::chrono::steady_clock::now();
+        size_t num_games = py::len(state_configs_for_env_reset);
+        std::vector<long long> time_budgets_us(num_games, searcher.time_budget_us);
+        for (size_t i = 0; i < num_games; ++i) {
+            py::object budget = state_configs_for_env_reset[i].attr("get")("time_budget_us");
+            if (!budget.is_none()) {
+                time_budgets_us[i] = budget.cast<long long>();
+            }
+        }
+        while (games.size() < num_games) {
+            games.emplace_back(searcher.native_game->clone());
+        }
+        searcher.reset();
+        NodePool& pool = searcher.node_pools[searcher.pool_index];
+        int action_space_size = searcher.native_game->action_space_size();
+
+        // Expand all the roots with one evaluation.
+        std::vector<Node*> roots(num_games);
+        std::vector<PendingLeaf> root_leaves;
+        std::vector<Game*> root_states;
+        for (size_t i = 0; i < num_games; ++i) {
+            MCTS::_reset_game(games[i].get(), state_configs_for_env_reset[i]);
+            roots[i] = pool.allocate(1);
+            root_leaves.push_back(PendingLeaf{roots[i], games[i]->legal_actions(), false, 0.0, games[i]->zobrist_hash()});
+            root_states.push_back(games[i].get());
+        }
+        if (num_games > 0) {
+            searcher._evaluate_leaves(root_leaves, MCTS::_stack_states(root_states), policy_value_func_batch, action_space_size);
+        }
+        for (Node* root : roots) {
+            if (sample) {
+                searcher._add_exploration_noise(root);
+            }
+        }
+
+        // Every round gathers up to ``leaf_batch_size`` leaves per game that still has simulations to run and time left.
+        num_simulations_done.assign(num_games, 0);
+        std::vector<PendingLeaf> leaves;
+        std::vector<Game*> states;
+        while (true) {
+            leaves.clear();
+            states.clear();
+            {
+                py::gil_scoped_release release;
+                long long elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - start).count();
+                for (size_t i = 0; i < num_games; ++i) {
+                    int remaining = searcher.num_simulations - num_simulations_done[i];
+                    bool out_of_time = time_budgets_us[i] > 0 && num_simulations_done[i] > 0 && elapsed_us >= time_budgets_us[i];
+                    if (remaining > 0 && !out_of_time) {
+                        num_simulations_done[i] += searcher._gather_leaves_native(
+                            roots[i], games[i].get(), std::min(searcher.leaf_batch_size, remaining), leaves, states);
+                    }
+                }
+            }
+            if (leaves.empty()) {
+                break;
+            }
+            if (!states.empty()) {
+                py::object observations = MCTS::_stack_states(states);
+                for (Game* state : states) {
+                    delete state;
+                }
+                searcher._evaluate_leaves(leaves, observations, policy_value_func_batch, action_space_size);
+            }
+            searcher._backup_leaves(leaves, searcher.native_battle_mode);
+        }
+
+        std::vector<std::pair<int, std::vector<double>>> results;
+        for (Node* root : roots) {
+            results.push_back(searcher._select_root_action(root, action_space_size, temperature, sample));
+        }
+        return results;
+    }
+};
+
+// This function uses pybind11 to expose the Node, MCTS and BatchedMCTS classes to Python.
 // This allows Python code to create and manipulate instances of these classes.
 PYBIND11_MODULE(mcts_alphazero, m) {
-    py::class_<Node>(m, "Node")
-        .def(py::init([](Node* parent, float prior_p){
-        return new Node(parent ? parent : nullptr, prior_p);
-        }), py::arg("parent")=nullptr, py::arg("prior_p")=1.0)
-        .def_property_readonly("value", &Node::get_value)
-        .def("update", &Node::update)
-        .def("update_recursive", &Node::update_recursive)
-        .def("is_leaf", &Node::is_leaf)
-        .def("is_root", &Node::is_root)
-        .def("parent", &Node::get_parent)
-        .def_readwrite("prior_p", &Node::prior_p)
-        .def_readwrite("children", &Node::children)
-        .def("add_child", &Node::add_child)
-        .def_readwrite("visit_count", &Node::visit_count);
+    py::class_<Game>(m, "Game")
+        .def("reset", [](Game& game, int start_player_index, py::object init_state) {
+            std::vector<int> board;
+            if (!init_state.is_none()) {
+                auto array = py::array_t<int, py::array::c_style | py::array::forcecast>::ensure(init_state);
+                if (!array) {
+                    throw std::invalid_argument("init_state must be convertible to an int array");
+                }
+                board.assign(array.data(), array.data() + array.size());
+            }
+            game.reset(start_player_index, board);
+        }, py::arg("start_player_index")=0, py::arg("init_state")=py::none())
+        .def("step", &Game::step)
+        .def("undo", &Game::undo)
+        .def("get_done_winner", &Game::get_done_winner)
+        .def("clone", &Game::clone, py::return_value_policy::take_ownership)
+        .def("current_state", [](const Game& game) {
+            // Returns the (raw, scaled) state planes, like ``current_state()`` of the zoo environments.
+            std::vector<int> shape = game.state_shape();
+            py::array_t<float> raw_obs(shape), scale_obs(shape);
+            game.current_state(raw_obs.mutable_data(), false);
+            game.current_state(scale_obs.mutable_data(), true);
+            return py::make_tuple(raw_obs, scale_obs);
+        })
+        .def_property_readonly("legal_actions", &Game::legal_actions)
+        .def_property_readonly("current_player", &Game::current_player)
+        .def_property_readonly("zobrist_hash", &Game::zobrist_hash)
+        .def("get_state", [](const Game& game) {
+            return py::bytes(game.get_state());
+        })
+        .def("set_state", [](Game& game, py::bytes state) {
+            game.set_state(state);
+        }, py::arg("state"))
+        .def_property_readonly("action_space_size", &Game::action_space_size);
+
+    m.def("make_game", [](const std::string& game_name, int board_size, bool scale, bool channel_last, float komi) {
+        return make_game(game_name, board_size, scale, channel_last, komi).release();
+    }, py::arg("game_name"), py::arg("board_size")=15, py::arg("scale")=true, py::arg("channel_last")=false,
+       py::arg("komi")=7.5, py::return_value_policy::take_ownership);
+
+    py::class_<NodePool>(m, "NodePool")
+        .def(py::init<size_t>(), py::arg("block_size")=16384)
+        .def("clear", &NodePool::clear)
+        .def_property_readonly("capacity", &NodePool::capacity);
+
+    py::class_<Node>(m, "Node", py::dynamic_attr())
+        .def(py::init([](py::object parent, float prior_p) {
+            return new Node(parent.is_none() ? nullptr : &checked_node(parent), prior_p);
+        }), py::arg("parent")=py::none(), py::arg("prior_p")=1.0)
+        // Every binding reaches the node through ``checked_node``, which raises once the pool of the node is cleared.
+        .def_property_readonly("value", [](py::object self) { return checked_node(self).get_value(); })
+        .def("update", [](py::object self, float value) { checked_node(self).update(value); })
+        .def("update_recursive", [](py::object self, float leaf_value, std::string battle_mode_in_simulation_env) {
+            checked_node(self).update_recursive(leaf_value, battle_mode_in_simulation_env);
+        })
+        .def("is_leaf", [](py::object self) { return checked_node(self).is_leaf(); })
+        .def("is_root", [](py::object self) { return checked_node(self).is_root(); })
+        .def("parent", [](py::object self) { return node_handle(checked_node(self).get_parent()); })
+        .def_property("prior_p", [](py::object self) { return checked_node(self).prior_p; },
+                      [](py::object self, float prior_p) { checked_node(self).prior_p = prior_p; })
+        .def_property_readonly("children", [](py::object self) {
+            // A dict from action to the handle of the child, see ``node_handle``: the handles are references to the
+            // nodes of the tree, not copies, and they are released by the next clear() of the pool of the tree.
+            py::dict children;
+            for (Node& child : checked_node(self).children()) {
+                children[py::int_(child.action)] = node_handle(&child);
+            }
+            return children;
+        })
+        .def_property_readonly("action", [](py::object self) { return checked_node(self).action; })
+        // The child is allocated from ``pool``, which must outlive it; the previous children of the node are invalidated.
+        .def("add_child", [](py::object self, NodePool& pool, int action, float prior_p) {
+            return node_handle(checked_node(self).add_child(pool, action, prior_p));
+        }, py::arg("pool"), py::arg("action"), py::arg("prior_p")=1.0, py::keep_alive<0, 2>())
+        .def("is_released", [](py::object self) { return is_released_handle(self); })
+        .def_property("visit_count", [](py::object self) { return checked_node(self).get_visit_count(); },
+                      [](py::object self, int visit_count) { checked_node(self).visit_count.store(visit_count); })
+        .def_property_readonly("legal_actions", [](py::object self) { return checked_node(self).legal_actions; });
 
     py::class_<MCTS>(m, "MCTS")
-        .def(py::init<int, int, double, double, double, double, py::object>(),
+        .def(py::init<int, int, double, double, double, double, py::object, int, double>(),
              py::arg("max_moves")=512, py::arg("num_simulations")=800,
              py::arg("pb_c_base")=19652, py::arg("pb_c_init")=1.25,
-             py::arg("root_dirichlet_alpha")=0.3, py::arg("root_noise_weight")=0.25, py::arg("simulate_env"))
-        .def("_ucb_score", &MCTS::_ucb_score)
-        .def("_add_exploration_noise", &MCTS::_add_exploration_noise)
-        .def("_select_child", &MCTS::_select_child)
-        .def("_expand_leaf_node", &MCTS::_expand_leaf_node)
+             py::arg("root_dirichlet_alpha")=0.3, py::arg("root_noise_weight")=0.25, py::arg("simulate_env"),
+             py::arg("leaf_batch_size")=1, py::arg("virtual_loss")=1.0)
+        // The nodes are passed and returned as the handles of ``node_handle``.
+        .def("_ucb_score", [](MCTS& mcts, py::object parent, py::object child) {
+            return mcts._ucb_score(&checked_node(parent), &checked_node(child));
+        })
+        .def("_add_exploration_noise", [](MCTS& mcts, py::object node) {
+            mcts._add_exploration_noise(&checked_node(node));
+        })
+        .def("_select_child", [](MCTS& mcts, py::object node, py::object simulate_env) {
+            std::pair<int, Node*> selected = mcts._select_child(&checked_node(node), simulate_env);
+            return py::make_tuple(selected.first, node_handle(selected.second));
+        })
+        .def("_expand_leaf_node", [](MCTS& mcts, py::object node, py::object simulate_env, py::object policy_value_func) {
+            return mcts._expand_leaf_node(&checked_node(node), simulate_env, policy_value_func);
+        })
         .def("get_next_action", &MCTS::get_next_action)
-        .def("_simulate", &MCTS::_simulate);
+        .def("reset", &MCTS::reset)
+        .def("update_with_move", &MCTS::update_with_move, py::arg("action"))
+        .def("_simulate", [](MCTS& mcts, py::object node, py::object simulate_env, py::object policy_value_func) {
+            mcts._simulate(&checked_node(node), simulate_env, policy_value_func);
+        })
+        .def("set_num_threads", &MCTS::set_num_threads, py::arg("num_threads"))
+        .def("set_time_budget", &MCTS::set_time_budget, py::arg("time_budget_us"))
+        .def_property_readonly("num_simulations_done", &MCTS::get_num_simulations_done)
+        .def("set_native_game", &MCTS::set_native_game,
+             py::arg("game_name"), py::arg("board_size")=15, py::arg("scale")=true, py::arg("channel_last")=false,
+             py::arg("battle_mode_in_simulation_env")="self_play_mode", py::arg("evaluation_cache")=false,
+             py::arg("komi")=7.5, py::arg("graph_search")=false);
+
+    py::class_<BatchedMCTS>(m, "BatchedMCTS")
+        .def(py::init<const std::string&, int, double, double, double, double, int, bool, bool, const std::string&, int, double, bool, float, bool>(),
+             py::arg("game_name"), py::arg("num_simulations")=800,
+             py::arg("pb_c_base")=19652, py::arg("pb_c_init")=1.25,
+             py::arg("root_dirichlet_alpha")=0.3, py::arg("root_noise_weight")=0.25,
+             py::arg("board_size")=15, py::arg("scale")=true, py::arg("channel_last")=false,
+             py::arg("battle_mode_in_simulation_env")="self_play_mode",
+             py::arg("leaf_batch_size")=1, py::arg("virtual_loss")=1.0, py::arg("evaluation_cache")=false,
+             py::arg("komi")=7.5, py::arg("graph_search")=false)
+        .def("set_time_budget", &BatchedMCTS::set_time_budget, py::arg("time_budget_us"))
+        .def_property_readonly("num_simulations_done", &BatchedMCTS::get_num_simulations_done)
+        .def("get_next_actions", &BatchedMCTS::get_next_actions,
+             py::arg("state_configs_for_env_reset"), py::arg("policy_value_func_batch"),
+             py::arg("temperature"), py::arg("sample"));
 }
\ No newline at end of file
@@ -1,22 +1,42 @@
 #include "node_alphazero.h"
+#include "node_alphazero_binding.h"
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 
 namespace py = pybind11;
 
 PYBIND11_MODULE(node_alphazero, m) {
-    py::class_<Node>(m, "Node")
-        .def(py::init([](Node* parent, float prior_p){
-        return new Node(parent ? parent : nullptr, prior_p);
-        }), py::arg("parent")=nullptr, py::arg("prior_p")=1.0)
-        .def("value", &Node::get_value)
-        .def("update", &Node::update)
-        .def("update_recursive", &Node::update_recursive)
-        .def("is_leaf", &Node::is_leaf)
-        .def("is_root", &Node::is_root)
-        .def("parent", &Node::get_parent)
-        .def("children", &Node::get_children)
-        .def_readwrite("children", &Node::children)
-        .def("add_child", &Node::add_child)
-        .def("visit_count", &Node::get_visit_count);
+    py::class_<NodePool>(m, "NodePool")
+        .def(py::init<size_t>(), py::arg("block_size")=16384)
+        .def("clear", &NodePool::clear)
+        .def_property_readonly("capacity", &NodePool::capacity);
+
+    py::class_<Node>(m, "Node", py::dynamic_attr())
+        .def(py::init([](py::object parent, float prior_p) {
+            return new Node(parent.is_none() ? nullptr : &checked_node(parent), prior_p);
+        }), py::arg("parent")=py::none(), py::arg("prior_p")=1.0)
+        // Every binding reaches the node through ``checked_node``, which raises once the pool of the node is cleared.
+        .def("value", [](py::object self) { return checked_node(self).get_value(); })
+        .def("update", [](py::object self, float value) { checked_node(self).update(value); })
+        .def("update_recursive", [](py::object self, float leaf_value, std::string battle_mode_in_simulation_env) {
+            checked_node(self).update_recursive(leaf_value, battle_mode_in_simulation_env);
+        })
+        .def("is_leaf", [](py::object self) { return checked_node(self).is_leaf(); })
+        .def("is_root", [](py::object self) { return checked_node(self).is_root(); })
+        .def("parent", [](py::object self) { return node_handle(checked_node(self).get_parent()); })
+        .def_property_readonly("children", [](py::object self) {
+            // A dict from action to the handle of the child, see ``node_handle``: the handles are references to the
+            // nodes of the tree, not copies, and they are released by the next clear() of the pool of the tree.
+            py::dict children;
+            for (Node& child : checked_node(self).children()) {
+                children[py::int_(child.action)] = node_handle(&child);
+            }
+            return children;
+        })
+        .def("visit_count", [](py::object self) { return checked_node(self).get_visit_count(); })
+        // The child is allocated from ``pool``, which must outlive it; the previous children of the node are invalidated.
+        .def("add_child", [](py::object self, NodePool& pool, int action, float prior_p) {
+            return node_handle(checked_node(self).add_child(pool, action, prior_p));
+        }, py::arg("pool"), py::arg("action"), py::arg("prior_p")=1.0, py::keep_alive<0, 2>())
+        .def("is_released", [](py::object self) { return is_released_handle(self); });
 }
@@ -1,6 +1,7 @@
 # distutils:language=c++
 # cython:language_level=3
 from libcpp.vector cimport vector
+from libc.stdint cimport uint64_t
 
 
 DEF NUM_ACTION_HEADS = 4
@@ -42,23 +43,29 @@ cdef extern from "lib/cnode.h" namespace "tree":
     cdef int TOTAL_ACTIONS
    
     
+    cdef cppclass CNodePool:
+        CNodePool() except +
+
     cdef cppclass CNode:
         CNode() except +
         CNode(float prior, vector[int] & legal_actions) except +
         int visit_count, to_play, current_latent_state_index, batch_index
+        vector[int] legal_actions
         vector[int] best_action
         float value_prefix, prior, value_sum, parent_value_prefix
 
         void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefix,
-                    vector[float] policy_logits)
+                    vector[float] policy_logits, CNodePool *node_pool)
         void add_exploration_noise(float exploration_fraction, vector[float] noises)
-        float compute_mean_q(int isRoot, float parent_q, float discount_factor)
+        float compute_mean_q(int isRoot, float parent_q)
+        float compute_child_q(CNode *child, float discount_factor)
 
         int expanded()
         float value()
         vector[vector[int]] get_trajectory()
         vector[int] get_children_distribution()
         CNode * get_child(vector[int] actions)
+        CNode * get_child(uint64_t action)
 
     cdef cppclass CRoots:
         CRoots() except +
@@ -71,6 +78,7 @@ cdef extern from "lib/cnode.h" namespace "tree":
                      vector[int] to_play_batch)
         void prepare_no_noise(const vector[float] & value_prefixs, const vector[vector[float]] & policies,
                               vector[int] to_play_batch)
+        void reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size)
         void clear()
         vector[vector[vector[int]]] get_trajectories()
         vector[vector[int]] get_distributions()
@@ -87,6 +95,8 @@ cdef extern from "lib/cnode.h" namespace "tree":
         vector[int] virtual_to_play_batchs
         vector[CNode *] nodes
 
+        void reset()
+
     cdef void cbackpropagate(vector[CNode *] & search_path, CMinMaxStats & min_max_stats,
                               int to_play, float value, float discount_factor)
     void cbatch_backpropagate(int current_latent_state_index, float discount_factor, vector[float] value_prefixs,
@@ -109,3 +119,5 @@ cdef class Roots:
 
 cdef class Node:
     cdef CNode cnode
+    # the children of the node are taken from this pool.
+    cdef CNodePool node_pool
@@ -3,6 +3,9 @@
 import cython
 from libcpp.vector cimport vector
 
+include "../common_lib/legal_actions.pxi"
+include "../common_lib/scalar_transform.pxi"
+
 
 cdef class MinMaxStatsList:
     @cython.binding
@@ -25,14 +28,23 @@ cdef class ResultsWrapper:
     def get_search_len(self):
         return self.cresults.search_lens
 
+    @cython.binding
+    def reset(self):
+        # Clear the results of the last simulation, keeping the allocated buffers for the next one.
+        self.cresults.reset()
+
 cdef class Roots:
     @cython.binding
-    def __cinit__(self, int root_num, vector[vector[int]] legal_actions_list):
+    def __cinit__(self, int root_num, legal_actions_list, int bitmask_action_space_size=0):
+        # ``legal_actions_list`` is a list of the legal actions of each root, or a (root_num, action_space_size)
+        # numpy mask, or a mask packed by ``np.packbits`` if ``bitmask_action_space_size`` > 0, see ``to_legal_actions_mask``.
+        cdef vector[vector[int]] clegal_actions_list = to_legal_actions_list(root_num, legal_actions_list,
+                                                                              bitmask_action_space_size)
         print(f"Initializing Roots with root_num: {root_num}")
         try:
             self.root_num = root_num
             print(f"About to create CRoots for root_num: {root_num}")
-            self.roots = new CRoots(root_num, legal_actions_list)
+            self.roots = new CRoots(root_num, clegal_actions_list)
             print(f"CRoots created successfully for root_num: {root_num}")
         except Exception as e:
             print(f"Error in Roots.__cinit__: {e}")
@@ -63,6 +75,17 @@ cdef class Roots:
     #def get_root(self, int index):
     #    return self.roots[index]
 
+    @cython.binding
+    def reset(self, int root_num, legal_actions_mask):
+        # Reinitialize the roots in place from a (root_num, action_space_size) legal action mask, normalized by
+        # ``to_legal_actions_mask``.
+        cdef const unsigned char[:, ::1] mask = to_legal_actions_mask(root_num, legal_actions_mask, 0)
+        self.root_num = root_num
+        if root_num == 0 or mask.shape[1] == 0:
+            self.roots[0].reset(root_num, NULL, 0)
+        else:
+            self.roots[0].reset(root_num, &mask[0, 0], mask.shape[1])
+
     @cython.binding
     def clear(self):
         self.roots[0].clear()
@@ -85,15 +108,23 @@ cdef class Node:
     def expand(self, int to_play, int current_latent_state_index, int batch_index, float value_prefix,
                list policy_logits):
         cdef vector[float] cpolicy = policy_logits
-        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy)
+        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy, &self.node_pool)
 
 @cython.binding
-def batch_backpropagate(int current_latent_state_index, float discount_factor, list value_prefixs, list values, list policies,
+def batch_backpropagate(int current_latent_state_index, float discount_factor, value_prefixs, values, list policies,
                          MinMaxStatsList min_max_stats_lst, ResultsWrapper results, list is_reset_list,
-                         list to_play_batch):
+                         list to_play_batch, int support_size=0, float epsilon=0.001):
+    # If ``support_size`` > 0, ``value_prefixs`` and ``values`` are the raw categorical logits of shape
+    # (batch_size, 2 * support_size + 1), decoded to scalars in C++ instead of by ``InverseScalarTransform``.
     cdef int i
-    cdef vector[float] cvalue_prefixs = value_prefixs
-    cdef vector[float] cvalues = values
+    cdef vector[float] cvalue_prefixs
+    cdef vector[float] cvalues
+    if support_size > 0:
+        cvalue_prefixs = decode_categorical(value_prefixs, support_size, epsilon)
+        cvalues = decode_categorical(values, support_size, epsilon)
+    else:
+        cvalue_prefixs = value_prefixs
+        cvalues = values
     cdef vector[vector[float]] cpolicies = policies
     cdef vector[int] cis_reset_list = is_reset_list
     cdef vector[int] cto_play_batch = to_play_batch
@@ -111,4 +142,21 @@ def batch_traverse(Roots roots, int pb_c_base, float pb_c_init, float discount_f
     return (results.cresults.latent_state_index_in_search_path, 
             results.cresults.latent_state_index_in_batch, 
             results.cresults.last_actions, 
-            results.cresults.virtual_to_play_batchs)
\ No newline at end of file
+            results.cresults.virtual_to_play_batchs)
+
+def pcompute_mean_q(Roots roots, int index, float discount_factor):
+    # The mean q value of a root from the running statistics of its visited children, and from a scan of their q values.
+    cdef CNode *root
+    cdef CNode *child
+    cdef int a
+    cdef float q_sum = 0.0
+    cdef int num_visited_children = 0
+    if index < 0 or index >= roots.root_num:
+        raise IndexError("index out of range")
+    root = &(roots.roots[0].roots[index])
+    for a in root.legal_actions:
+        child = root.get_child(a)
+        if child.visit_count > 0:
+            q_sum += root.compute_child_q(child, discount_factor)
+            num_visited_children += 1
+    return root.compute_mean_q(1, 0.0), q_sum / num_visited_children if num_visited_children > 0 else 0.0
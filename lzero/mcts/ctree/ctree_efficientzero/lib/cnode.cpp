@@ -42,6 +42,7 @@ namespace tree
             Initialization of CSearchResults, the default result number is set to 0.
         */
         this->num = 0;
+        this->node_pool = nullptr;
     }
 
     CSearchResults::CSearchResults(int num)
@@ -51,6 +52,7 @@ namespace tree
             Initialization of CSearchResults with result number.
         */
         this->num = num;
+        this->node_pool = nullptr;
         for (int i = 0; i < num; ++i)
         {
             this->search_paths.push_back(std::vector<CNode *>());
@@ -59,6 +61,24 @@ namespace tree
 
     CSearchResults::~CSearchResults() {}
 
+    void CSearchResults::reset()
+    {
+        /*
+        Overview:
+            Clear the results of the last simulation in place, keeping the allocated capacity of all buffers.
+        */
+        this->latent_state_index_in_search_path.clear();
+        this->latent_state_index_in_batch.clear();
+        this->last_actions.clear();
+        this->search_lens.clear();
+        this->virtual_to_play_batchs.clear();
+        this->nodes.clear();
+        for (int i = 0; i < this->num; ++i)
+        {
+            this->search_paths[i].clear();
+        }
+    }
+
     //*********************************************************
 
     CNode::CNode()
@@ -69,10 +89,13 @@ namespace tree
         */
         this->prior = 0;
         this->legal_actions = legal_actions;
+        this->children.fill(nullptr);
 
         this->is_reset = 0;
         this->visit_count = 0;
         this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
         this->best_action = {-1, -1, -1, -1};
         this->to_play = 0;
         this->value_prefix = 0.0;
@@ -99,11 +122,14 @@ namespace tree
             this->prior = prior;
             std::cout << "Copying legal_actions" << std::endl;
             this->legal_actions = legal_actions;
+            this->children.fill(nullptr);
 
             std::cout << "Initializing other members" << std::endl;
             this->is_reset = 0;
             this->visit_count = 0;
             this->value_sum = 0;
+            this->num_visited_children = 0;
+            this->children_q_sum = 0.0;
             this->best_action = {-1, -1, -1, -1};
             this->to_play = 0;
             this->value_prefix = 0.0;
@@ -127,7 +153,32 @@ namespace tree
 
     CNode::~CNode() {}
 
-    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float value_prefix, const std::vector<float> &policy_logits)
+    void CNode::reset(float prior)
+    {
+        /*
+        Overview:
+            Reset the current node to an unexpanded node in place, the legal actions are kept. The children are not
+            freed, they are recycled with the node pool of the tree.
+        Arguments:
+            - prior: the prior value of this node.
+        */
+        this->prior = prior;
+        this->is_reset = 0;
+        this->visit_count = 0;
+        this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
+        this->best_action = {-1, -1, -1, -1};
+        this->to_play = 0;
+        this->value_prefix = 0.0;
+        this->parent_value_prefix = 0.0;
+        this->current_latent_state_index = -1;
+        this->batch_index = -1;
+        this->children.fill(nullptr);
+        this->children_index.clear();
+    }
+
+    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float value_prefix, const std::vector<float> &policy_logits, CNodePool *node_pool)
     {
         /*
         Overview:
@@ -138,6 +189,7 @@ namespace tree
             - batch_index: the y/second index of hidden state vector of the current node, i.e. the index of batch root node, its maximum is ``batch_size``/``env_num``.
             - value_prefix: the value prefix of the current node.
             - policy_logits: the policy logit of the child nodes.
+            - node_pool: the node pool of the tree, the children are taken from it.
         */
         this->to_play = to_play;
         this->current_latent_state_index = current_latent_state_index;
@@ -178,12 +230,14 @@ namespace tree
             policy[a] = temp_policy;
         }
 
-        float prior;
+        // the nodes of the pool may be recycled from a previous search, so the children are reset in place.
+        CNode *children = node_pool->allocate(this->legal_actions.size());
         for (auto a : this->legal_actions)
         {
-            prior = policy[a] / policy_sum;
-            std::vector<int> tmp_empty;
-            this->children[a] = new CNode(prior, tmp_empty);
+            children->reset(policy[a] / policy_sum);
+            children->legal_actions.clear();
+            this->children[a] = children;
+            children += 1;
         }
 #ifdef _WIN32
         // 释放数组内存
@@ -212,37 +266,18 @@ namespace tree
         }
     }
 
-    float CNode::compute_mean_q(int isRoot, float parent_q, float discount_factor)
+    float CNode::compute_mean_q(int isRoot, float parent_q)
     {
         /*
         Overview:
-            Compute the mean q value of the current node.
+            Compute the mean q value of the current node in O(1) from the running statistics of its visited children.
         Arguments:
             - isRoot: whether the current node is a root node.
             - parent_q: the q value of the parent node.
-            - discount_factor: the discount_factor of reward.
         */
-        float total_unsigned_q = 0.0;
-        int total_visits = 0;
-        float parent_value_prefix = this->value_prefix;
-        for (int i = 0; i < NUM_ACTION_HEADS; i++)
-        {
-            for (auto a : this->legal_actions)
-            {
-                CNode *child = this->get_child(a + i * ACTIONS_PER_PLAYER); // This is a simplification
-                if (child->visit_count > 0)
-                {
-                    float true_reward = child->value_prefix - parent_value_prefix;
-                    if (this->is_reset == 1)
-                    {
-                        true_reward = child->value_prefix;
-                    }
-                    float qsa = true_reward + discount_factor * child->value();
-                    total_unsigned_q += qsa;
-                    total_visits += 1;
-                }
-            }
-        }
+        // The q values of the visited children are accumulated incrementally in cbackpropagate.
+        float total_unsigned_q = (float)this->children_q_sum;
+        int total_visits = this->num_visited_children;
 
         float mean_q = 0.0;
         if (isRoot && total_visits > 0)
@@ -256,13 +291,52 @@ namespace tree
         return mean_q;
     }
 
+    float CNode::compute_child_q(CNode *child, float discount_factor)
+    {
+        /*
+        Overview:
+            Compute the q value of a child node from the perspective of the current node.
+        Arguments:
+            - child: the child node.
+            - discount_factor: the discount_factor of reward.
+        */
+        float true_reward = child->value_prefix - this->value_prefix;
+        if (this->is_reset == 1)
+        {
+            true_reward = child->value_prefix;
+        }
+        return true_reward + discount_factor * child->value();
+    }
+
+    void CNode::update_child_q(CNode *child, float old_qsa, float discount_factor)
+    {
+        /*
+        Overview:
+            Update the running sum and count of the visited children's q values after the statistics of a child changed.
+        Arguments:
+            - child: the child node whose value sum and visit count have just been updated.
+            - old_qsa: the q value of the child before the update, ignored if this is its first visit.
+            - discount_factor: the discount_factor of reward.
+        */
+        float new_qsa = this->compute_child_q(child, discount_factor);
+        if (child->visit_count == 1)
+        {
+            this->num_visited_children += 1;
+            this->children_q_sum += new_qsa;
+        }
+        else
+        {
+            this->children_q_sum += new_qsa - old_qsa;
+        }
+    }
+
     int CNode::expanded()
     {
         /*
         Overview:
-            Return whether the current node is expanded.
+            Return whether the current node is expanded, i.e. whether the children of its legal actions are created.
         */
-        return this->children.size() > 0;
+        return !this->legal_actions.empty() && this->children[this->legal_actions[0]] != nullptr;
     }
 
     float CNode::value()
@@ -354,6 +428,71 @@ namespace tree
 
     //*********************************************************
 
+    CNodePool::CNodePool()
+    {
+        /*
+        Overview:
+            The initialization of CNodePool.
+        */
+        this->block_size = 4096;
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    CNodePool::CNodePool(int block_size)
+    {
+        /*
+        Overview:
+            The initialization of CNodePool with the number of nodes in each block.
+        Arguments:
+            - block_size: the number of nodes in each block.
+        */
+        this->block_size = block_size;
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    CNodePool::~CNodePool() {}
+
+    CNode *CNodePool::allocate(int num)
+    {
+        /*
+        Overview:
+            Allocate contiguous nodes from the pool. The nodes are never moved, so the pointers stay valid until the
+            pool is reset. The blocks double in size up to block_size, so that a small tree does not construct a whole
+            block of nodes.
+        Arguments:
+            - num: the number of contiguous nodes to allocate.
+        Returns:
+            - nodes: the pointer to the first allocated node, which may hold the state of a previous search.
+        */
+        while (this->current_block < this->blocks.size() && this->num_used + num > this->blocks[this->current_block].size())
+        {
+            this->current_block += 1;
+            this->num_used = 0;
+        }
+        if (this->current_block == this->blocks.size())
+        {
+            int size = this->blocks.empty() ? 64 : 2 * int(this->blocks.back().size());
+            this->blocks.push_back(std::vector<CNode>(std::max(std::min(size, this->block_size), num)));
+        }
+        CNode *nodes = &(this->blocks[this->current_block][this->num_used]);
+        this->num_used += num;
+        return nodes;
+    }
+
+    void CNodePool::reset()
+    {
+        /*
+        Overview:
+            Release all the nodes of the pool for the next search, keeping the blocks.
+        */
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    //*********************************************************
+
     CRoots::CRoots()
     {
         /*
@@ -426,7 +565,7 @@ namespace tree
         */
         for (int i = 0; i < this->root_num; ++i)
         {
-            this->roots[i].expand(to_play_batch[i], 0, i, value_prefixs[i], policies[i]);
+            this->roots[i].expand(to_play_batch[i], 0, i, value_prefixs[i], policies[i], &(this->node_pool));
             this->roots[i].add_exploration_noise(root_noise_weight, noises[i]);
             this->roots[i].visit_count += 1;
         }
@@ -444,18 +583,52 @@ namespace tree
         */
         for (int i = 0; i < this->root_num; ++i)
         {
-            this->roots[i].expand(to_play_batch[i], 0, i, value_prefixs[i], policies[i]);
+            this->roots[i].expand(to_play_batch[i], 0, i, value_prefixs[i], policies[i], &(this->node_pool));
             this->roots[i].visit_count += 1;
         }
     }
 
+    void CRoots::reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size)
+    {
+        /*
+        Overview:
+            Reinitialize the roots in place for a new search, reusing the storage of the roots and their legal actions.
+        Arguments:
+            - root_num: the number of the roots in the new search.
+            - legal_actions_mask: the row-major legal action mask of shape (root_num, action_space_size).
+            - action_space_size: the size of action space of the current env.
+        */
+        this->root_num = root_num;
+        this->legal_actions_list.resize(root_num);
+        this->roots.resize(root_num);
+        // the nodes of the previous search are recycled by the next one.
+        this->node_pool.reset();
+
+        for (int i = 0; i < root_num; ++i)
+        {
+            const unsigned char *mask = legal_actions_mask + i * action_space_size;
+            std::vector<int> &legal_actions = this->legal_actions_list[i];
+            legal_actions.clear();
+            for (int a = 0; a < action_space_size; ++a)
+            {
+                if (mask[a])
+                {
+                    legal_actions.push_back(a);
+                }
+            }
+            this->roots[i].reset(0);
+            this->roots[i].legal_actions = legal_actions;
+        }
+    }
+
     void CRoots::clear()
     {
         /*
         Overview:
-            Clear the roots vector.
+            Clear the roots vector and release the nodes of the tree.
         */
         this->roots.clear();
+        this->node_pool.reset();
     }
 
     std::vector<std::vector<std::vector<int>>> CRoots::get_trajectories()
@@ -590,8 +763,14 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 node->value_sum += bootstrap_value;
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 float parent_value_prefix = 0.0;
                 int is_reset = 0;
@@ -622,6 +801,8 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 if (node->to_play == to_play)
                 {
                     node->value_sum += bootstrap_value;
@@ -631,6 +812,10 @@ namespace tree
                     node->value_sum += -bootstrap_value;
                 }
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 float parent_value_prefix = 0.0;
                 int is_reset = 0;
@@ -682,7 +867,7 @@ namespace tree
         */
         for (int i = 0; i < results.num; ++i)
         {
-            results.nodes[i]->expand(to_play_batch[i], current_latent_state_index, i, value_prefixs[i], policies[i]);
+            results.nodes[i]->expand(to_play_batch[i], current_latent_state_index, i, value_prefixs[i], policies[i], results.node_pool);
             // reset
             results.nodes[i]->is_reset = is_reset_list[i];
 
@@ -821,7 +1006,9 @@ namespace tree
 
         std::vector<int> last_action(4, -1);
         float parent_q = 0.0;
-        results.search_lens = std::vector<int>();
+        results.search_lens.clear();
+        // the leaves expanded in ``cbatch_backpropagate`` take their children from the node pool of the roots.
+        results.node_pool = &(roots->node_pool);
 
         int players = 0;
         int largest_element = *max_element(virtual_to_play_batch.begin(), virtual_to_play_batch.end()); // 0 or 2
@@ -843,7 +1030,7 @@ namespace tree
 
             while (node->expanded())
             {
-                float mean_q = node->compute_mean_q(is_root, parent_q, discount_factor);
+                float mean_q = node->compute_mean_q(is_root, parent_q);
                 is_root = 0;
                 parent_q = mean_q;
 
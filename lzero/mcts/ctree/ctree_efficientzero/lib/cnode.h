@@ -22,12 +22,17 @@ namespace tree {
     constexpr int NUM_ACTION_HEADS = 4;
     constexpr int TOTAL_ACTIONS = NUM_ACTION_HEADS * ACTIONS_PER_PLAYER;
 
+    class CNodePool;
+
     class CNode {
     public:
+        // the children are owned by the node pool of the tree, nullptr for the actions that are not expanded.
         std::array<CNode *, TOTAL_ACTIONS> children;
         int visit_count, to_play, current_latent_state_index, batch_index, is_reset;
         std::vector<int> best_action;
         float value_prefix, prior, value_sum;
+        int num_visited_children;
+        double children_q_sum;
         float parent_value_prefix;
         std::vector<int> children_index;
 
@@ -37,9 +42,13 @@ namespace tree {
         CNode(float prior, std::vector<int> &legal_actions);
         ~CNode();
 
-        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefix, const std::vector<float> &policy_logits);
+        void reset(float prior);
+
+        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefix, const std::vector<float> &policy_logits, CNodePool *node_pool);
         void add_exploration_noise(float exploration_fraction, const std::vector<float> &noises);
-        float compute_mean_q(int isRoot, float parent_q, float discount_factor);
+        float compute_mean_q(int isRoot, float parent_q);
+        float compute_child_q(CNode *child, float discount_factor);
+        void update_child_q(CNode *child, float old_qsa, float discount_factor);
         void print_out();
 
         int expanded();
@@ -55,12 +64,27 @@ namespace tree {
         static uint64_t encode_action(std::vector<int> actions);
     };
 
+    class CNodePool
+    {
+    public:
+        int block_size, current_block, num_used;
+        std::vector<std::vector<CNode>> blocks;
+
+        CNodePool();
+        CNodePool(int block_size);
+        ~CNodePool();
+
+        CNode *allocate(int num);
+        void reset();
+    };
+
     class CRoots
     {
     public:
         int root_num;
         std::vector<CNode> roots;
         std::vector<std::vector<int>> legal_actions_list;
+        CNodePool node_pool;
 
         CRoots();
         CRoots(int root_num, std::vector<std::vector<int>> &legal_actions_list);
@@ -68,6 +92,7 @@ namespace tree {
 
         void prepare(float root_noise_weight, const std::vector<std::vector<float>> &noises, const std::vector<float> &value_prefixs, const std::vector<std::vector<float>> &policies, std::vector<int> &to_play_batch);
         void prepare_no_noise(const std::vector<float> &value_prefixs, const std::vector<std::vector<float>> &policies, std::vector<int> &to_play_batch);
+        void reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size);
         void clear();
         std::vector<std::vector<std::vector<int>>> get_trajectories();
         std::vector<std::vector<int>> get_distributions();
@@ -83,11 +108,14 @@ namespace tree {
         std::vector<std::vector<int>> last_actions;
         std::vector<int> virtual_to_play_batchs;
         std::vector<CNode *> nodes;
+        CNodePool *node_pool;
         std::vector<std::vector<CNode *>> search_paths;
 
         CSearchResults();
         CSearchResults(int num);
         ~CSearchResults();
+
+        void reset();
     };
 
     //*********************************************************
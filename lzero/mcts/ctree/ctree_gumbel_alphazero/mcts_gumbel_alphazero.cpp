@@ -6,12 +6,14 @@
 // The following lines include the necessary headers to facilitate the implementation of the MCTS algorithm.
 
 #include "node_gumbel_alphazero.h"
+#include "node_gumbel_alphazero_binding.h"
 #include <cmath>
 #include <map>
 #include <random>
 #include <vector>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include <functional>
 #include <iostream>
 #include <memory>
@@ -20,6 +22,14 @@
 // This line creates an alias for the pybind11 namespace, making it easier to reference in the code.
 namespace py = pybind11;
 
+// A leaf reached by one simulation of a batch, waiting to be evaluated and backed up.
+struct PendingLeaf {
+    Node* node;
+    std::vector<int> legal_actions;
+    bool done;  // Whether the leaf is a terminal state, whose value is known without evaluation
+    double leaf_value;  // The value of the leaf from the view of its player to move, backed up like in ``_simulate``
+};
+
 // This part defines the MCTS class and its member variables.
 // The MCTS class implements the MCTS algorithm, and its member variables store configuration values used in the algorithm.
 class MCTS {
@@ -36,6 +46,16 @@ class MCTS {
     int max_num_considered_actions;
     std::vector<float> gumbel;
     py::object simulate_env;
+    // The number of leaves gathered with virtual loss and evaluated together per round; 1 evaluates the leaves one by one.
+    int leaf_batch_size;
+    // The loss added to the value sum of every node on the path of a pending leaf, along with one visit.
+    double virtual_loss;
+    // The nodes of the search tree, released at once when the next search starts.
+    NodePool node_pool;
+    // Whether each phase of the root sequential halving evaluates the visits of all its considered actions together.
+    bool batched_halving;
+    // The table of considered visits of ``get_table_of_considered_visits``, which only depends on the configuration.
+    std::vector<std::vector<int>> table_of_considered_visits;
 
 // This part defines the constructor of the MCTS class.
 // The constructor initializes the member variables with the provided arguments or with their default values.
@@ -46,7 +66,8 @@ public:
          int maxvisit_init=50, float value_scale=0.1,
          float gumbel_scale = 10.0, float gumbel_rng = 0.0,
          int max_num_considered_actions = 4, // parameters for gumbel alphazero
-         py::object simulate_env=py::none())
+         py::object simulate_env=py::none(),
+         int leaf_batch_size=1, double virtual_loss=1.0, bool batched_halving=false)
         : max_moves(max_moves), num_simulations(num_simulations),
           pb_c_base(pb_c_base), pb_c_init(pb_c_init),
           root_dirichlet_alpha(root_dirichlet_alpha),
@@ -55,7 +76,9 @@ public:
           gumbel_scale(gumbel_scale), gumbel_rng(gumbel_rng),
           max_num_considered_actions(max_num_considered_actions),  // parameters for gumbel alphazero
           gumbel(_generate_gumbel(gumbel_scale, gumbel_rng, 36)),  //simulate_env.attr("action_space").attr("n").cast<int>())),
-          simulate_env(simulate_env) {}
+          simulate_env(simulate_env), leaf_batch_size(leaf_batch_size), virtual_loss(virtual_loss),
+          batched_halving(batched_halving),
+          table_of_considered_visits(get_table_of_considered_visits(max_num_considered_actions, num_simulations)) {}
 
     // Methods: get_next_action，_simulate，_select_child，_expand_leaf_node，_ucb_score，_add_exploration_noise
     
@@ -73,8 +96,8 @@ public:
     // This function adds Dirichlet noise to the prior probabilities of the actions of a given node to encourage exploration.
     void _add_exploration_noise(Node* node) {
     std::vector<int> actions;
-    for (const auto& kv : node->children) {
-        actions.push_back(kv.first);
+    for (const Node& child : node->children()) {
+        actions.push_back(child.action);
     }
 
     std::default_random_engine generator;
@@ -95,7 +118,7 @@ public:
 
     double frac = root_noise_weight;
     for (size_t i = 0; i < actions.size(); ++i) {
-        node->children[actions[i]]->prior_p = node->children[actions[i]]->prior_p * (1 - frac) + noise[i] * frac;
+        node->get_child(actions[i])->prior_p = node->get_child(actions[i])->prior_p * (1 - frac) + noise[i] * frac;
     }
 }
     // This function generates Gumbel noise for the MCTS algorithm.
@@ -110,30 +133,23 @@ public:
     }
 
     // This function selects the child of a given node that has the highest UCB score among the legal actions.
+    // The legal actions cached on the node at expansion are used; they are fetched from ``simulate_env`` only once for a node expanded without them.
     std::pair<int, Node*> _select_child(Node* node, py::object simulate_env) {
+        if (!node->has_legal_actions) {
+            node->set_legal_actions(simulate_env.attr("legal_actions").cast<std::vector<int>>());
+        }
         int action = -1;
         Node* child = nullptr;
         double best_score = -9999999;
-        for (const auto& kv : node->children) {
-            int action_tmp = kv.first;
-            Node* child_tmp = kv.second;
-
-            py::list legal_actions_py = simulate_env.attr("legal_actions").cast<py::list>();
-
-            std::vector<int> legal_actions;
-            for (py::handle h : legal_actions_py) {
-                legal_actions.push_back(h.cast<int>());
-            }
-
-            if (std::find(legal_actions.begin(), legal_actions.end(), action_tmp) != legal_actions.end()) {
-                double score = _ucb_score(node, child_tmp);
+        for (Node& candidate : node->children()) {
+            if (node->is_legal(candidate.action)) {
+                double score = _ucb_score(node, &candidate);
                 if (score > best_score) {
                     best_score = score;
-                    action = action_tmp;
-                    child = child_tmp;
+                    action = candidate.action;
+                    child = &candidate;
                 }
             }
-
         }
         if (child == nullptr) {
             child = node;
@@ -148,18 +164,14 @@ public:
         std::vector<int> action_list;
         std::vector<int> visit_count_list;
 
-        for (const auto& kv : node->children) {
-            int action_tmp = kv.first;
-            Node* child_tmp = kv.second;
-            child_tmp_list.push_back(child_tmp);
-            action_list.push_back(action_tmp);
-            visit_count_list.push_back(child_tmp->visit_count);
+        for (Node& child_tmp : node->children()) {
+            child_tmp_list.push_back(&child_tmp);
+            action_list.push_back(child_tmp.action);
+            visit_count_list.push_back(child_tmp.visit_count);
         }
 
         // get mixed q value of child nodes
         std::vector<float> completed_qvalues = _qtransform_completed_by_mix_value(node, child_tmp_list);
-        // get table of considered_visits
-        std::vector<std::vector<int> > table_of_considered_visits = get_table_of_considered_visits(max_num_considered_actions, num_simulations);
 
         // get number of actions
         int num_actions = action_list.size();
@@ -178,7 +190,7 @@ public:
             }
         }
 
-        return std::make_pair(action, node->children[action]);
+        return std::make_pair(action, node->get_child(action));
     }
 
     // select interior child
@@ -187,10 +199,10 @@ public:
         std::vector<int> visit_counts;
         std::vector<float> priors;
         std::vector<Node*> children;
-        for (const auto& kv : node->children) {
-            visit_counts.push_back(kv.second->visit_count);
-            priors.push_back(kv.second->prior_p);
-            children.push_back(kv.second);
+        for (Node& child : node->children()) {
+            visit_counts.push_back(child.visit_count);
+            priors.push_back(child.prior_p);
+            children.push_back(&child);
         }
         // get completed value
         std::vector<float> completed_value = _qtransform_completed_by_mix_value(node, children);
@@ -210,7 +222,7 @@ public:
         }
 
         // Check if node->children is empty
-        if (node->children.empty()) {
+        if (node->children().empty()) {
             // Return default value or throw exception as needed
             std::cout << "node->children is empty" << std::endl;
             return std::make_pair(-1, nullptr);
@@ -219,9 +231,8 @@ public:
         // Find the action with the maximum score
         float argmax = -std::numeric_limits<float>::infinity();
         int action = -1;
-        for (const auto& kv : node->children) {
-            int action_tmp = kv.first;
-            Node* child_tmp = kv.second;
+        for (const Node& child_tmp : node->children()) {
+            int action_tmp = child_tmp.action;
             if (to_argmax[action_tmp] > argmax) {
                 argmax = to_argmax[action_tmp];
                 action = action_tmp;
@@ -234,17 +245,17 @@ public:
             std::cout << "action == -1, selecting a random valid action" << std::endl;
             std::random_device rd;
             std::mt19937 gen(rd());
-            std::uniform_int_distribution<> distrib(0, node->children.size() - 1);
+            std::uniform_int_distribution<> distrib(0, node->children().size() - 1);
 
-            auto it = std::next(std::begin(node->children), distrib(gen));
-            return std::make_pair(it->first, it->second);
+            Node& child = node->children()[distrib(gen)];
+            return std::make_pair(child.action, &child);
         }
 
         // Check if action is a valid key
-        auto it = node->children.find(action);
-        if (it != node->children.end()) {
+        Node* child = node->get_child(action);
+        if (child != nullptr) {
             // If the action is valid, return it and the corresponding node
-            return std::make_pair(action, it->second);
+            return std::make_pair(action, child);
         } else {
             // If not a valid action, return default value or throw exception as needed
             std::cout << "action is not a valid key" << std::endl;
@@ -444,8 +455,7 @@ public:
         leaf_value = result[1].cast<double>();
         // record raw value to node for gumbel alphazero
         node->raw_value = leaf_value;
-        py::list legal_actions_list = simulate_env.attr("legal_actions").cast<py::list>();
-        std::vector<int> legal_actions = legal_actions_list.cast<std::vector<int>>();
+        node->set_legal_actions(simulate_env.attr("legal_actions").cast<std::vector<int>>());
 
         // only for debug
         // std::cout << "position18 " << std::endl;
@@ -464,26 +474,29 @@ public:
         //     }
         // }
 
+        std::vector<std::pair<int, float>> action_priors;
         for (const auto& kv : action_probs_dict) {
             int action = kv.first;
             double prior_p = kv.second;
-            if (std::find(legal_actions.begin(), legal_actions.end(), action) != legal_actions.end()) {
-                node->children[action] = new Node(node, prior_p);
+            if (node->is_legal(action)) {
+                action_priors.push_back(std::make_pair(action, static_cast<float>(prior_p)));
             }
         }
+        node->expand(node_pool, action_priors);
         return leaf_value;
     }
     
     // This function returns the next action to take and the probabilities of each action based on the current state and the policy-value function.
     std::tuple<int, std::vector<double>, std::vector<double>> get_next_action(py::object state_config_for_env_reset, py::object policy_forward_fn, double temperature, bool sample) {
-        Node* root = new Node();
+        node_pool.clear();
+        Node* root = node_pool.allocate(1);
         py::object init_state = state_config_for_env_reset["init_state"];
         if (!init_state.is_none()) {
             init_state = py::bytes(init_state.attr("tobytes")());
         }
         py::object katago_game_state = state_config_for_env_reset["katago_game_state"];
-        if (!katago_game_state.is_none()) {
-        // TODO(pu): polish efficiency
+        // A state already serialized by the env is passed to every reset as is.
+        if (!katago_game_state.is_none() && !py::isinstance<py::bytes>(katago_game_state)) {
             katago_game_state = py::module::import("pickle").attr("dumps")(katago_game_state);
         }
         simulate_env.attr("reset")(
@@ -492,27 +505,57 @@ public:
             state_config_for_env_reset["katago_policy_init"].cast<bool>(),
             katago_game_state
         );
+        // If the env supports snapshots, every simulation restores the root state instead of resetting the env again.
+        bool use_snapshot = py::hasattr(simulate_env, "clone_state") && py::hasattr(simulate_env, "restore_state");
+        py::object root_snapshot = use_snapshot ? simulate_env.attr("clone_state")() : py::none();
 
-        _expand_leaf_node(root, simulate_env, policy_forward_fn);
+        auto restore_root = [&]() {
+            if (use_snapshot) {
+                simulate_env.attr("restore_state")(root_snapshot);
+            } else {
+                simulate_env.attr("reset")(
+                    state_config_for_env_reset["start_player_index"].cast<int>(),
+                    init_state,
+                    state_config_for_env_reset["katago_policy_init"].cast<bool>(),
+                    katago_game_state
+                );
+            }
+            simulate_env.attr("battle_mode") = simulate_env.attr("battle_mode_in_simulation_env");
+        };
+
+        if (leaf_batch_size > 1 || batched_halving) {
+            // ``policy_forward_fn`` is the batched policy-value function, see ``_evaluate_leaves``.
+            std::vector<PendingLeaf> root_leaf(1, PendingLeaf{root, simulate_env.attr("legal_actions").cast<std::vector<int>>(), false, 0.0});
+            py::list root_observation;
+            root_observation.append(simulate_env.attr("current_state")()[py::int_(1)]);
+            _evaluate_leaves(root_leaf, py::module::import("numpy").attr("stack")(root_observation), policy_forward_fn);
+        } else {
+            _expand_leaf_node(root, simulate_env, policy_forward_fn);
+        }
         if (sample) {
             _add_exploration_noise(root);
         }
 
-        for (int n = 0; n < num_simulations; ++n) {
-            simulate_env.attr("reset")(
-                state_config_for_env_reset["start_player_index"].cast<int>(),
-                init_state,
-                state_config_for_env_reset["katago_policy_init"].cast<bool>(),
-                katago_game_state
-            );
-            simulate_env.attr("battle_mode") = simulate_env.attr("battle_mode_in_simulation_env");
-            _simulate(root, simulate_env, policy_forward_fn);
+        if (batched_halving) {
+            for (const auto& phase : _get_halving_schedule(root)) {
+                _simulate_halving_phase(root, simulate_env, policy_forward_fn, phase.first, phase.second, restore_root);
+            }
+        }
+        for (int n = batched_halving ? num_simulations : 0; n < num_simulations;) {
+            if (leaf_batch_size > 1) {
+                n += _simulate_batch(root, simulate_env, policy_forward_fn, std::min(leaf_batch_size, num_simulations - n), restore_root);
+            } else {
+                restore_root();
+                _simulate(root, simulate_env, policy_forward_fn);
+                ++n;
+            }
         }
 
         std::vector<std::pair<int, int>> action_visits;
         for (int action = 0; action < simulate_env.attr("action_space").attr("n").cast<int>(); ++action) {
-            if (root->children.count(action)) {
-                action_visits.push_back(std::make_pair(action, root->children[action]->visit_count));
+            Node* child = root->get_child(action);
+            if (child != nullptr) {
+                action_visits.push_back(std::make_pair(action, child->visit_count));
             } else {
                 action_visits.push_back(std::make_pair(action, 0));
             }
@@ -548,11 +591,11 @@ public:
         std::vector<double> priors;
         std::vector<Node*> children;
         std::vector<int> actions;
-        for (const auto& kv : root->children) {
-            visit_counts.push_back(kv.second->visit_count);
-            priors.push_back((double)kv.second->prior_p);
-            children.push_back(kv.second);
-            actions.push_back(kv.first);
+        for (Node& child : root->children()) {
+            visit_counts.push_back(child.visit_count);
+            priors.push_back((double)child.prior_p);
+            children.push_back(&child);
+            actions.push_back(child.action);
         }
 
         // get qtransform completed value
@@ -632,6 +675,206 @@ public:
     }
 
 
+    // This function runs up to ``batch_size`` simulations whose leaves are evaluated together, with ``restore_root``
+    // bringing ``simulate_env`` back to the root state before every descent. Every gathered leaf adds a virtual loss to
+    // its path, which steers the next descents of the batch to other leaves; the batch stops early if a descent reaches
+    // a leaf that is already pending. Returns the number of simulations run.
+    int _simulate_batch(Node* root, py::object simulate_env, py::object policy_forward_fn_batch, int batch_size,
+                        const std::function<void()>& restore_root) {
+        std::string battle_mode = simulate_env.attr("battle_mode_in_simulation_env").cast<std::string>();
+        std::vector<PendingLeaf> leaves;
+        py::list observations;
+        for (int b = 0; b < batch_size; ++b) {
+            restore_root();
+            Node* node = root;
+            while (!node->is_leaf()) {
+                int action;
+                if (node->is_root()) {
+                    std::tie(action, node) = _select_root_child(node, simulate_env);
+                } else {
+                    std::tie(action, node) = _select_interior_child(node, simulate_env);
+                }
+                if (node == nullptr) {
+                    throw std::runtime_error("Encountered null node in _simulate_batch");
+                }
+                if (action == -1) {
+                    break;
+                }
+                simulate_env.attr("step")(action);
+            }
+            bool pending = false;
+            for (const auto& leaf : leaves) {
+                pending = pending || leaf.node == node;
+            }
+            if (pending) {
+                break;
+            }
+
+            PendingLeaf leaf{node, std::vector<int>(), false, 0.0};
+            py::tuple result = simulate_env.attr("get_done_winner")();
+            if (result[0].cast<bool>()) {
+                int winner = result[1].cast<int>();
+                leaf.done = true;
+                if (winner != -1) {
+                    if (battle_mode == "self_play_mode") {
+                        leaf.leaf_value = (simulate_env.attr("current_player").cast<int>() == winner) ? 1 : -1;
+                    } else {
+                        leaf.leaf_value = (winner == 1) ? 1 : -1;
+                    }
+                }
+            } else {
+                leaf.legal_actions = simulate_env.attr("legal_actions").cast<std::vector<int>>();
+                observations.append(simulate_env.attr("current_state")()[py::int_(1)]);
+            }
+            _apply_virtual_loss(node, 1);
+            leaves.push_back(leaf);
+        }
+
+        if (py::len(observations) > 0) {
+            _evaluate_leaves(leaves, py::module::import("numpy").attr("stack")(observations), policy_forward_fn_batch);
+        }
+        for (const auto& leaf : leaves) {
+            _apply_virtual_loss(leaf.node, -1);
+            leaf.node->update_recursive(battle_mode == "self_play_mode" ? -leaf.leaf_value : leaf.leaf_value, battle_mode);
+        }
+        return static_cast<int>(leaves.size());
+    }
+
+    // This function returns the phases of the root sequential halving of a search from the expanded ``root``, as
+    // (considered visit, number of considered actions) pairs: every phase visits once each of the considered actions
+    // that have been visited ``considered visit`` times. The schedule is read from the row of the table of considered
+    // visits for the number of actions considered at the root, which is capped by the number of its children.
+    std::vector<std::pair<int, int>> _get_halving_schedule(Node* root) {
+        int num_considered = std::min(max_num_considered_actions, static_cast<int>(root->children().size()));
+        std::vector<std::pair<int, int>> schedule;
+        if (num_considered == 0) {
+            return schedule;
+        }
+        for (int considered_visit : table_of_considered_visits[num_considered]) {
+            if (schedule.empty() || schedule.back().first != considered_visit) {
+                schedule.push_back(std::make_pair(considered_visit, 0));
+            }
+            ++schedule.back().second;
+        }
+        return schedule;
+    }
+
+    // This function runs one phase of the root sequential halving: it scores the root children once, descends below the
+    // ``num_considered`` best children that have been visited ``considered_visit`` times, and evaluates the leaves reached
+    // with one call of the batched policy-value function. The leaves lie in the subtrees of distinct root children, so
+    // the descents need no virtual loss.
+    void _simulate_halving_phase(Node* root, py::object simulate_env, py::object policy_forward_fn_batch,
+                                 int considered_visit, int num_considered, const std::function<void()>& restore_root) {
+        std::vector<Node*> children;
+        for (Node& child : root->children()) {
+            children.push_back(&child);
+        }
+        std::vector<float> completed_qvalues = _qtransform_completed_by_mix_value(root, children);
+        std::vector<float> score_considered = _score_considered(considered_visit, children, completed_qvalues);
+        std::vector<int> order;
+        for (int i = 0; i < static_cast<int>(children.size()); ++i) {
+            if (children[i]->visit_count == considered_visit) {
+                order.push_back(i);
+            }
+        }
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return score_considered[a] > score_considered[b]; });
+        order.resize(std::min(static_cast<int>(order.size()), num_considered));
+
+        std::string battle_mode = simulate_env.attr("battle_mode_in_simulation_env").cast<std::string>();
+        std::vector<PendingLeaf> leaves;
+        py::list observations;
+        for (int i : order) {
+            restore_root();
+            Node* node = children[i];
+            simulate_env.attr("step")(node->action);
+            while (!node->is_leaf()) {
+                int action;
+                std::tie(action, node) = _select_interior_child(node, simulate_env);
+                if (node == nullptr) {
+                    throw std::runtime_error("Encountered null node in _simulate_halving_phase");
+                }
+                if (action == -1) {
+                    break;
+                }
+                simulate_env.attr("step")(action);
+            }
+
+            PendingLeaf leaf{node, std::vector<int>(), false, 0.0};
+            py::tuple result = simulate_env.attr("get_done_winner")();
+            if (result[0].cast<bool>()) {
+                int winner = result[1].cast<int>();
+                leaf.done = true;
+                if (winner != -1) {
+                    if (battle_mode == "self_play_mode") {
+                        leaf.leaf_value = (simulate_env.attr("current_player").cast<int>() == winner) ? 1 : -1;
+                    } else {
+                        leaf.leaf_value = (winner == 1) ? 1 : -1;
+                    }
+                }
+            } else {
+                leaf.legal_actions = simulate_env.attr("legal_actions").cast<std::vector<int>>();
+                observations.append(simulate_env.attr("current_state")()[py::int_(1)]);
+            }
+            leaves.push_back(leaf);
+        }
+
+        if (py::len(observations) > 0) {
+            _evaluate_leaves(leaves, py::module::import("numpy").attr("stack")(observations), policy_forward_fn_batch);
+        }
+        for (const auto& leaf : leaves) {
+            leaf.node->update_recursive(battle_mode == "self_play_mode" ? -leaf.leaf_value : leaf.leaf_value, battle_mode);
+        }
+    }
+
+    // This function evaluates the leaves that are not done with one call of the batched policy-value function and expands them.
+    // ``policy_forward_fn_batch(observations, legal_actions)`` receives the stacked (N, ...) observations of the N leaves and
+    // the list of their legal actions, and returns the (N, action_space_size) action probabilities and the (N, ) values.
+    void _evaluate_leaves(std::vector<PendingLeaf>& leaves, py::object observations, py::object policy_forward_fn_batch) {
+        std::vector<std::vector<int>> legal_actions_batch;
+        for (const auto& leaf : leaves) {
+            if (!leaf.done) {
+                legal_actions_batch.push_back(leaf.legal_actions);
+            }
+        }
+        int action_space_size = simulate_env.attr("action_space").attr("n").cast<int>();
+        py::tuple result = policy_forward_fn_batch(observations, legal_actions_batch);
+        auto action_probs = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[0]);
+        auto values = py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(result[1]);
+        size_t num_leaves = legal_actions_batch.size();
+        if (!action_probs || !values || static_cast<size_t>(action_probs.size()) != num_leaves * action_space_size ||
+            static_cast<size_t>(values.size()) != num_leaves) {
+            throw std::invalid_argument("the batched policy-value function must return (N, action_space_size) probabilities and (N, ) values");
+        }
+
+        size_t i = 0;
+        for (auto& leaf : leaves) {
+            if (leaf.done) {
+                continue;
+            }
+            const float* probs = action_probs.data() + i * action_space_size;
+            leaf.node->set_legal_actions(leaf.legal_actions);
+            std::vector<std::pair<int, float>> action_priors;
+            for (int action : leaf.node->legal_actions) {
+                action_priors.push_back(std::make_pair(action, probs[action]));
+            }
+            leaf.node->expand(node_pool, action_priors);
+            leaf.leaf_value = values.data()[i];
+            // record raw value to node for gumbel alphazero
+            leaf.node->raw_value = leaf.leaf_value;
+            ++i;
+        }
+    }
+
+    // This function adds (sign = 1) or removes (sign = -1) one virtual visit and ``virtual_loss`` on the path from ``node`` to the root.
+    // Every node value is seen from the player who selects it, so the loss makes each node of the path less attractive to its selector.
+    void _apply_virtual_loss(Node* node, int sign) {
+        for (; node != nullptr; node = node->parent) {
+            node->visit_count += sign;
+            node->value_sum -= sign * virtual_loss;
+        }
+    }
+
+
 private:
     static std::vector<double> visit_count_to_action_distribution(const std::vector<double>& visits, double temperature) {
         // Check if temperature is 0
@@ -714,47 +957,116 @@ static std::vector<double> softmax(const std::vector<double>& values, double tem
 // This function uses pybind11 to expose the Node and MCTS classes to Python.
 // This allows Python code to create and manipulate instances of these classes.
 PYBIND11_MODULE(mcts_gumbel_alphazero, m) {
-    py::class_<Node>(m, "Node")
-        .def(py::init([](Node* parent, float prior_p){
-        return new Node(parent ? parent : nullptr, prior_p);
-        }), py::arg("parent")=nullptr, py::arg("prior_p")=1.0)
-        .def_property_readonly("value", &Node::get_value)
-        .def("update", &Node::update)
-        .def("update_recursive", &Node::update_recursive)
-        .def("is_leaf", &Node::is_leaf)
-        .def("is_root", &Node::is_root)
-        .def("parent", &Node::get_parent)
-        .def_readwrite("prior_p", &Node::prior_p)
-        .def_readwrite("children", &Node::children)
-        .def("add_child", &Node::add_child)
-        .def_readwrite("visit_count", &Node::visit_count)
-        .def_readwrite("raw_value", &Node::raw_value);
+    py::class_<NodePool>(m, "NodePool")
+        .def(py::init<size_t>(), py::arg("block_size")=16384)
+        .def("clear", &NodePool::clear)
+        .def_property_readonly("capacity", &NodePool::capacity);
+
+    py::class_<Node>(m, "Node", py::dynamic_attr())
+        .def(py::init([](py::object parent, float prior_p) {
+            return new Node(parent.is_none() ? nullptr : &checked_node(parent), prior_p);
+        }), py::arg("parent")=py::none(), py::arg("prior_p")=1.0)
+        // Every binding reaches the node through ``checked_node``, which raises once the pool of the node is cleared.
+        .def_property_readonly("value", [](py::object self) { return checked_node(self).get_value(); })
+        .def("update", [](py::object self, float value) { checked_node(self).update(value); })
+        .def("update_recursive", [](py::object self, float leaf_value, std::string battle_mode_in_simulation_env) {
+            checked_node(self).update_recursive(leaf_value, battle_mode_in_simulation_env);
+        })
+        .def("is_leaf", [](py::object self) { return checked_node(self).is_leaf(); })
+        .def("is_root", [](py::object self) { return checked_node(self).is_root(); })
+        .def("parent", [](py::object self) { return node_handle(checked_node(self).get_parent()); })
+        .def_property("prior_p", [](py::object self) { return checked_node(self).prior_p; },
+                      [](py::object self, float prior_p) { checked_node(self).prior_p = prior_p; })
+        .def_property("children", [](py::object self) {
+            // A dict from action to the handle of the child, see ``node_handle``: the handles are references to the
+            // nodes of the tree, not copies, and they are released by the next clear() of the pool of the tree.
+            py::dict children;
+            for (Node& child : checked_node(self).children()) {
+                children[py::int_(child.action)] = node_handle(&child);
+            }
+            return children;
+        }, [](py::object self, const py::dict& children) {
+            // The children are copies of the given nodes, allocated from the pool of the node, or for a node built in
+            // Python, from the pool of its first child; the previous children of the node are invalidated.
+            Node& node = checked_node(self);
+            std::map<int, const Node*> sorted_children;
+            for (auto item : children) {
+                sorted_children[item.first.cast<int>()] = &checked_node(item.second);
+            }
+            if (sorted_children.empty()) {
+                node.first_child = nullptr;
+                node.num_children = 0;
+                return;
+            }
+            NodePool* pool = node.pool ? node.pool : (node.num_children > 0 ? node.first_child->pool : nullptr);
+            if (pool == nullptr) {
+                throw std::invalid_argument("the node has no pool to allocate its children from, use add_child");
+            }
+            node.set_children(*pool, std::vector<std::pair<int, const Node*>>(sorted_children.begin(), sorted_children.end()));
+        })
+        // The child is allocated from ``pool``, which must outlive it; the previous children of the node are invalidated.
+        .def("add_child", [](py::object self, NodePool& pool, int action, float prior_p) {
+            return node_handle(checked_node(self).add_child(pool, action, prior_p));
+        }, py::arg("pool"), py::arg("action"), py::arg("prior_p")=1.0, py::keep_alive<0, 2>())
+        .def("is_released", [](py::object self) { return is_released_handle(self); })
+        .def_property_readonly("action", [](py::object self) { return checked_node(self).action; })
+        .def_property("visit_count", [](py::object self) { return checked_node(self).visit_count; },
+                      [](py::object self, int visit_count) { checked_node(self).visit_count = visit_count; })
+        .def_property("raw_value", [](py::object self) { return checked_node(self).raw_value; },
+                      [](py::object self, float raw_value) { checked_node(self).raw_value = raw_value; })
+        .def_property_readonly("legal_actions", [](py::object self) { return checked_node(self).legal_actions; });
 
 
 
     py::class_<MCTS>(m, "MCTS")
-        .def(py::init<int, int, double, double, double, double, int, float, float, float, int, py::object>(),
+        .def(py::init<int, int, double, double, double, double, int, float, float, float, int, py::object, int, double, bool>(),
              py::arg("max_moves")=512, py::arg("num_simulations")=800,
              py::arg("pb_c_base")=19652, py::arg("pb_c_init")=1.25,
              py::arg("root_dirichlet_alpha")=0.3, py::arg("root_noise_weight")=0.25,
              py::arg("maxvisit_init")=50, py::arg("value_scale")=0.1,
              py::arg("gumbel_scale")=10.0, py::arg("gumbel_rng")=0.0,
              py::arg("max_num_considered_actions")=4,
-             py::arg("simulate_env"))
-        .def("_ucb_score", &MCTS::_ucb_score)
-        .def("_add_exploration_noise", &MCTS::_add_exploration_noise)
+             py::arg("simulate_env"), py::arg("leaf_batch_size")=1, py::arg("virtual_loss")=1.0,
+             py::arg("batched_halving")=false)
+        // The nodes are passed and returned as the handles of ``node_handle``.
+        .def("_ucb_score", [](MCTS& mcts, py::object parent, py::object child) {
+            return mcts._ucb_score(&checked_node(parent), &checked_node(child));
+        })
+        .def("_add_exploration_noise", [](MCTS& mcts, py::object node) {
+            mcts._add_exploration_noise(&checked_node(node));
+        })
         .def("_generate_gumbel", &MCTS::_generate_gumbel)
-        .def("_select_child", &MCTS::_select_child)
-        .def("_select_root_child", &MCTS::_select_root_child)
-        .def("_select_interior_child", &MCTS::_select_interior_child)
-        .def("_qtransform_completed_by_mix_value", &MCTS::_qtransform_completed_by_mix_value)
+        .def("_select_child", [](MCTS& mcts, py::object node, py::object simulate_env) {
+            std::pair<int, Node*> selected = mcts._select_child(&checked_node(node), simulate_env);
+            return py::make_tuple(selected.first, node_handle(selected.second));
+        })
+        .def("_select_root_child", [](MCTS& mcts, py::object node, py::object simulate_env) {
+            std::pair<int, Node*> selected = mcts._select_root_child(&checked_node(node), simulate_env);
+            return py::make_tuple(selected.first, node_handle(selected.second));
+        })
+        .def("_select_interior_child", [](MCTS& mcts, py::object node, py::object simulate_env) {
+            std::pair<int, Node*> selected = mcts._select_interior_child(&checked_node(node), simulate_env);
+            return py::make_tuple(selected.first, node_handle(selected.second));
+        })
+        .def("_qtransform_completed_by_mix_value", [](MCTS& mcts, py::object node, const py::list& child_list) {
+            return mcts._qtransform_completed_by_mix_value(&checked_node(node), checked_nodes(child_list));
+        })
         .def("_compute_mixed_value", &MCTS::_compute_mixed_value)
         .def("_rescale_qvalue", &MCTS::_rescale_qvalue)
         .def("get_sequence_of_considered_visits", &MCTS::get_sequence_of_considered_visits)
         .def("get_table_of_considered_visits", &MCTS::get_table_of_considered_visits)
-        .def("_score_considered", &MCTS::_score_considered)
-        .def("_expand_leaf_node", &MCTS::_expand_leaf_node)
+        .def("_score_considered", [](MCTS& mcts, int considered_visit, const py::list& child_list,
+                                     std::vector<float> completed_qvalues) {
+            return mcts._score_considered(considered_visit, checked_nodes(child_list), completed_qvalues);
+        })
+        .def("_expand_leaf_node", [](MCTS& mcts, py::object node, py::object simulate_env, py::object policy_forward_fn) {
+            return mcts._expand_leaf_node(&checked_node(node), simulate_env, policy_forward_fn);
+        })
         .def("get_next_action", &MCTS::get_next_action)
-        .def("_get_improved_policy", &MCTS::_get_improved_policy)
-        .def("_simulate", &MCTS::_simulate);
+        .def("_get_improved_policy", [](MCTS& mcts, py::object root) {
+            return mcts._get_improved_policy(&checked_node(root));
+        })
+        .def("_simulate", [](MCTS& mcts, py::object node, py::object simulate_env, py::object policy_forward_fn) {
+            mcts._simulate(&checked_node(node), simulate_env, policy_forward_fn);
+        });
 }
\ No newline at end of file
@@ -1,22 +1,57 @@
+#ifndef NODE_GUMBEL_ALPHAZERO_H
+#define NODE_GUMBEL_ALPHAZERO_H
+
+#include <algorithm>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <utility>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <stdexcept>
+#include <vector>
+
+class NodePool;
 
 class Node {
 public:
     // Constructor, initializes a Node with a parent pointer and a prior probability
     Node(Node* parent = nullptr, float prior_p = 1.0)
-        : parent(parent), prior_p(prior_p), visit_count(0), value_sum(0.0), raw_value(0.0) {}
+        : parent(parent), action(-1), prior_p(prior_p), visit_count(0), value_sum(0.0), raw_value(0.0), first_child(nullptr),
+          num_children(0), has_legal_actions(false), pool(nullptr), generation(0) {}
 
-    // Destructor, deletes all child nodes when a node is deleted to prevent memory leaks
-    ~Node() {
-        for (auto& pair : children) {
-            delete pair.second;
-        }
+    // Copy constructor and assignment, which copy the statistics and the children of a node but not the pool slot it
+    // lives in, so that a node copied into a pool stays owned by that pool
+    Node(const Node& other) : Node() {
+        *this = other;
+    }
+
+    Node& operator=(const Node& other) {
+        parent = other.parent;
+        action = other.action;
+        prior_p = other.prior_p;
+        visit_count = other.visit_count;
+        value_sum = other.value_sum;
+        raw_value = other.raw_value;
+        first_child = other.first_child;
+        num_children = other.num_children;
+        legal_actions = other.legal_actions;
+        has_legal_actions = other.has_legal_actions;
+        return *this;
     }
 
+    // The range of the contiguous children of a node, in increasing order of action
+    struct ChildRange {
+        Node* first;
+        Node* last;
+        Node* begin() const { return first; }
+        Node* end() const { return last; }
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+        Node& operator[](size_t i) const { return first[i]; }
+    };
+
     // Returns the average value of the node
     float get_value() {
         return visit_count == 0 ? 0.0 : value_sum / visit_count;
@@ -48,7 +83,7 @@ public:
 
     // Returns true if the node has no children
     bool is_leaf() {
-        return children.empty();
+        return num_children == 0;
     }
 
     // Returns true if the node has no parent
@@ -61,9 +96,17 @@ public:
         return parent;
     }
 
-    // Returns a map of the node's children
-    std::map<int, Node*> get_children() {
-        return children;
+    // Returns the node's children, without copying them
+    ChildRange children() const {
+        return ChildRange{first_child, first_child + num_children};
+    }
+
+    // Returns the child reached by ``action``, or nullptr if the node has no such child
+    Node* get_child(int action) const {
+        Node* last = first_child + num_children;
+        Node* child = std::lower_bound(first_child, last, action,
+                                       [](const Node& node, int a) { return node.action < a; });
+        return (child != last && child->action == action) ? child : nullptr;
     }
 
     // Returns the node's visit count
@@ -71,16 +114,244 @@ public:
         return visit_count;
     }
 
-    // Adds a child to the node
-    void add_child(int action, Node* node) {
-        children[action] = node;
+    // Creates the children of the node from ``pool``, one per (action, prior probability) of ``action_priors``, which must be sorted by action
+    void expand(NodePool& pool, const std::vector<std::pair<int, float>>& action_priors);
+
+    // Adds a child reached by ``action`` with the prior probability ``prior_p``, for trees built one child at a time.
+    // The children are moved to new contiguous nodes of ``pool``, so the pointers to the previous children are invalidated.
+    Node* add_child(NodePool& pool, int action, float prior_p);
+
+    // Replaces the children of the node with copies of the (action, node) pairs of ``children``, allocated as new
+    // contiguous nodes of ``pool``; the copies keep the statistics and the children of the nodes they copy.
+    void set_children(NodePool& pool, std::vector<std::pair<int, const Node*>> children);
+
+    // Caches the legal actions of the node's state, captured once at expansion, so that the selection does not query them again
+    void set_legal_actions(std::vector<int> actions) {
+        std::sort(actions.begin(), actions.end());
+        legal_actions = std::move(actions);
+        has_legal_actions = true;
+    }
+
+    // Returns true if ``action`` is legal in the node's state; every action is legal if the node has no cached legal actions
+    bool is_legal(int action) const {
+        return !has_legal_actions || std::binary_search(legal_actions.begin(), legal_actions.end(), action);
     }
 
 public:
     Node* parent;  // Pointer to the parent node
+    int action;  // Action leading from the parent to the node, -1 for a root
     float prior_p;  // Prior probability of the node
     int visit_count;  // Count of visits to the node
     float value_sum;  // Sum of values of the node
     float raw_value;  // Raw value of the node
-    std::map<int, Node*> children;  // Map of child nodes
-};
\ No newline at end of file
+    Node* first_child;  // First of the ``num_children`` contiguous children, allocated from a NodePool
+    int num_children;  // Number of children of the node
+    std::vector<int> legal_actions;  // Sorted legal actions of the node's state, cached at expansion
+    bool has_legal_actions;  // Whether ``legal_actions`` has been set
+    NodePool* pool;  // Pool the node was allocated from, nullptr for a node built outside of a pool
+    uint32_t generation;  // Generation of ``pool`` when the node was allocated
+};
+
+// The part of a NodePool shared with the Python handles to its nodes, so that a handle outlives neither the generation
+// of its node nor the memory it points to.
+struct NodePoolState {
+    uint32_t generation = 0;  // Number of times the pool has been cleared
+    bool alive = true;  // Whether the pool still exists
+    size_t num_handles = 0;  // Number of Python handles to the nodes of the pool
+    std::vector<std::pair<std::unique_ptr<Node[]>, size_t>> retired_blocks;  // Blocks released while handles were alive
+};
+
+// The record kept by a Python handle to a node of a pool: the state of the pool and the generation of the node. The
+// handle is released once the pool has been cleared or destroyed since the node was allocated.
+class NodeLease {
+public:
+    NodeLease(const std::shared_ptr<NodePoolState>& state, uint32_t generation) : state(state), generation(generation) {
+        ++state->num_handles;
+    }
+
+    NodeLease(const NodeLease&) = delete;
+    NodeLease& operator=(const NodeLease&) = delete;
+
+    // The blocks retired while the handles were alive are freed with the last handle
+    ~NodeLease() {
+        if (--state->num_handles == 0) {
+            state->retired_blocks.clear();
+        }
+    }
+
+    bool is_released() const {
+        return !state->alive || generation != state->generation;
+    }
+
+private:
+    std::shared_ptr<NodePoolState> state;
+    uint32_t generation;
+};
+
+// Allocates the nodes of a search tree in large blocks, so that expanding a node costs no allocation in the steady state
+// and its children are contiguous. The nodes are released all at once by ``clear``, which keeps the blocks for the next search.
+class NodePool {
+public:
+    explicit NodePool(size_t block_size = 16384)
+        : block_size(block_size), block_index(0), block_used(0), state(std::make_shared<NodePoolState>()) {}
+
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    // The blocks the Python handles may still point into are kept until the last of them is gone
+    ~NodePool() {
+        state->alive = false;
+        retire_blocks();
+    }
+
+    // Returns ``n`` contiguous new nodes
+    Node* allocate(size_t n) {
+        while (block_index < blocks.size() && block_used + n > blocks[block_index].second) {
+            ++block_index;
+            block_used = 0;
+        }
+        if (block_index == blocks.size()) {
+            size_t size = std::max(block_size, n);
+            blocks.push_back(std::make_pair(std::unique_ptr<Node[]>(new Node[size]), size));
+            block_used = 0;
+        }
+        Node* nodes = blocks[block_index].first.get() + block_used;
+        block_used += n;
+        for (size_t i = 0; i < n; ++i) {
+            nodes[i] = Node();
+            nodes[i].pool = this;
+            nodes[i].generation = state->generation;
+        }
+        return nodes;
+    }
+
+    // Copies the subtree of ``node`` into the pool and returns its root, which has no parent
+    Node* copy_subtree(const Node& node) {
+        Node* root = allocate(1);
+        *root = node;
+        root->parent = nullptr;
+        root->action = -1;
+        copy_children(root);
+        return root;
+    }
+
+    // Returns the number of nodes of the blocks of the pool, allocated or not
+    size_t capacity() const {
+        size_t nodes = 0;
+        for (const auto& block : blocks) {
+            nodes += block.second;
+        }
+        return nodes;
+    }
+
+    // Returns the number of times the pool has been cleared
+    uint32_t get_generation() const {
+        return state->generation;
+    }
+
+    // Returns the state shared with the Python handles to the nodes of the pool
+    const std::shared_ptr<NodePoolState>& get_state() const {
+        return state;
+    }
+
+    // Releases all the nodes of the pool, and the Python handles to them. While such handles are alive, the blocks are
+    // retired instead of reused, so that no handle ever points to a node allocated after the clear.
+    void clear() {
+        retire_blocks();
+        block_index = 0;
+        block_used = 0;
+        ++state->generation;
+    }
+
+private:
+    // Hands the blocks over to the shared state if Python handles may point into them, so that they are not reused
+    void retire_blocks() {
+        if (state->num_handles == 0) {
+            return;
+        }
+        for (auto& block : blocks) {
+            state->retired_blocks.push_back(std::move(block));
+        }
+        blocks.clear();
+    }
+
+    // Replaces the children of ``node``, which still live in another pool, with copies allocated from this pool
+    void copy_children(Node* node) {
+        if (node->num_children == 0) {
+            return;
+        }
+        const Node* children = node->first_child;
+        node->first_child = allocate(node->num_children);
+        for (int i = 0; i < node->num_children; ++i) {
+            node->first_child[i] = children[i];
+            node->first_child[i].parent = node;
+            copy_children(&node->first_child[i]);
+        }
+    }
+
+    size_t block_size;  // Number of nodes of a block
+    std::vector<std::pair<std::unique_ptr<Node[]>, size_t>> blocks;  // Blocks of nodes and their sizes
+    size_t block_index;  // Index of the block nodes are allocated from
+    size_t block_used;  // Number of nodes allocated from the current block
+    std::shared_ptr<NodePoolState> state;  // Generation and Python handles of the pool
+};
+
+inline void Node::expand(NodePool& pool, const std::vector<std::pair<int, float>>& action_priors) {
+    num_children = static_cast<int>(action_priors.size());
+    first_child = num_children > 0 ? pool.allocate(action_priors.size()) : nullptr;
+    for (int i = 0; i < num_children; ++i) {
+        first_child[i].parent = this;
+        first_child[i].action = action_priors[i].first;
+        first_child[i].prior_p = action_priors[i].second;
+    }
+}
+
+inline Node* Node::add_child(NodePool& pool, int action, float prior_p) {
+    if (get_child(action) != nullptr) {
+        throw std::invalid_argument("the node already has a child for action " + std::to_string(action));
+    }
+    int index = 0;
+    while (index < num_children && first_child[index].action < action) {
+        ++index;
+    }
+    Node* nodes = pool.allocate(num_children + 1);
+    for (int i = 0, j = 0; i <= num_children; ++i) {
+        if (i == index) {
+            nodes[i].parent = this;
+            nodes[i].action = action;
+            nodes[i].prior_p = prior_p;
+            continue;
+        }
+        nodes[i] = first_child[j++];
+        for (Node& grandchild : nodes[i].children()) {
+            grandchild.parent = &nodes[i];
+        }
+    }
+    first_child = nodes;
+    ++num_children;
+    return &nodes[index];
+}
+
+inline void Node::set_children(NodePool& pool, std::vector<std::pair<int, const Node*>> children) {
+    std::sort(children.begin(), children.end(),
+              [](const std::pair<int, const Node*>& a, const std::pair<int, const Node*>& b) { return a.first < b.first; });
+    for (size_t i = 1; i < children.size(); ++i) {
+        if (children[i].first == children[i - 1].first) {
+            throw std::invalid_argument("the node has two children for action " + std::to_string(children[i].first));
+        }
+    }
+    // The copies are made before the previous children are dropped, since ``children`` may contain some of them.
+    Node* nodes = children.empty() ? nullptr : pool.allocate(children.size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        nodes[i] = *children[i].second;
+        nodes[i].parent = this;
+        nodes[i].action = children[i].first;
+        for (Node& grandchild : nodes[i].children()) {
+            grandchild.parent = &nodes[i];
+        }
+    }
+    first_child = nodes;
+    num_children = static_cast<int>(children.size());
+}
+
+#endif  // NODE_GUMBEL_ALPHAZERO_H
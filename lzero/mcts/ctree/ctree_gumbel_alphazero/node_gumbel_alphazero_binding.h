@@ -0,0 +1,54 @@
+#ifndef NODE_GUMBEL_ALPHAZERO_BINDING_H
+#define NODE_GUMBEL_ALPHAZERO_BINDING_H
+
+#include "node_gumbel_alphazero.h"
+#include <stdexcept>
+#include <vector>
+#include <pybind11/pybind11.h>
+
+namespace py = pybind11;
+
+// The Python handles to the nodes of a NodePool. A handle is created by ``node_handle``, which attaches a NodeLease
+// recording the generation of the node, and the bindings only reach the node through ``checked_node``, so that a
+// handle kept across a clear() of its pool raises instead of reading or changing another node. The pool does not
+// reuse its blocks while such handles are alive. A node built in Python, outside of any pool, has no lease.
+
+// Returns the Python handle to ``node``, or None for nullptr
+inline py::object node_handle(Node* node) {
+    if (node == nullptr) {
+        return py::none();
+    }
+    py::object handle = py::cast(node, py::return_value_policy::reference);
+    if (node->pool != nullptr && !py::hasattr(handle, "_lease")) {
+        handle.attr("_lease") = py::capsule(new NodeLease(node->pool->get_state(), node->generation),
+                                            [](void* lease) { delete static_cast<NodeLease*>(lease); });
+    }
+    return handle;
+}
+
+// Returns true if the pool of the node of ``handle`` has been cleared or destroyed since the handle was created
+inline bool is_released_handle(py::handle handle) {
+    if (!py::hasattr(handle, "_lease")) {
+        return false;
+    }
+    return static_cast<const NodeLease*>(handle.attr("_lease").cast<py::capsule>().get_pointer())->is_released();
+}
+
+// Returns the node of ``handle``, or throws std::runtime_error if the handle is released
+inline Node& checked_node(py::handle handle) {
+    if (is_released_handle(handle)) {
+        throw std::runtime_error("the node was released by the clear() of its NodePool");
+    }
+    return handle.cast<Node&>();
+}
+
+// Returns the nodes of the handles of ``handles``, checked by ``checked_node``
+inline std::vector<Node*> checked_nodes(const py::list& handles) {
+    std::vector<Node*> nodes;
+    for (py::handle handle : handles) {
+        nodes.push_back(&checked_node(handle));
+    }
+    return nodes;
+}
+
+#endif  // NODE_GUMBEL_ALPHAZERO_BINDING_H
@@ -59,11 +59,15 @@ cdef extern from "lib/cnode.h" namespace "tree":
         void prepare(float root_noise_weight, const vector[vector[float]] &noises, const vector[float] &value_prefixs, const vector[float] &values, const vector[vector[float]] &policies, vector[int] to_play_batch)
         void prepare_no_noise(const vector[float] &value_prefixs, const vector[float] &values, const vector[vector[float]] &policies, vector[int] to_play_batch)
         void clear()
+        void set_gumbel_seeds(const vector[unsigned int] &gumbel_seeds)
+        void generate_gumbels()
+        vector[vector[float]] get_gumbels()
         vector[vector[int]] get_trajectories()
         vector[vector[int]] get_distributions()
         vector[vector[float]] get_children_values(float discount, int action_space_size)
         vector[vector[float]] get_policies(float discount, int action_space_size)
         vector[float] get_values()
+        void get_root_outputs(float *policies, float *children_values, int *distributions, float *values, float discount, int action_space_size)
 
     cdef cppclass CSearchResults:
         CSearchResults() except +
@@ -2,6 +2,8 @@
 # cython:language_level=3
 from libcpp.vector cimport vector
 
+include "../common_lib/legal_actions.pxi"
+
 cdef class MinMaxStatsList:
     cdef CMinMaxStatsList *cmin_max_stats_lst
 
@@ -29,9 +31,13 @@ cdef class Roots:
     cdef int root_num
     cdef CRoots *roots
 
-    def __cinit__(self, int root_num, vector[vector[int]] legal_actions_list):
+    def __cinit__(self, int root_num, legal_actions_list, int bitmask_action_space_size=0):
+        # ``legal_actions_list`` is a list of the legal actions of each root, or a (root_num, action_space_size)
+        # numpy mask, or a mask packed by ``np.packbits`` if ``bitmask_action_space_size`` > 0, see ``to_legal_actions_mask``.
+        cdef vector[vector[int]] clegal_actions_list = to_legal_actions_list(root_num, legal_actions_list,
+                                                                              bitmask_action_space_size)
         self.root_num = root_num
-        self.roots = new CRoots(root_num, legal_actions_list)
+        self.roots = new CRoots(root_num, clegal_actions_list)
 
     def prepare(self, float root_noise_weight, list noises, list value_prefix_pool, list value_pool, list policy_logits_pool, vector[int] &to_play_batch):
         self.roots[0].prepare(root_noise_weight, noises, value_prefix_pool, value_pool, policy_logits_pool, to_play_batch)
@@ -39,6 +45,14 @@ cdef class Roots:
     def prepare_no_noise(self, list value_prefix_pool, list value_pool, list policy_logits_pool, vector[int] &to_play_batch):
         self.roots[0].prepare_no_noise(value_prefix_pool, value_pool, policy_logits_pool, to_play_batch)
 
+    def set_gumbel_seeds(self, vector[unsigned int] gumbel_seeds):
+        if gumbel_seeds.size() != self.root_num:
+            raise ValueError("the length of gumbel_seeds must be equal to root_num")
+        self.roots[0].set_gumbel_seeds(gumbel_seeds)
+
+    def get_gumbels(self):
+        return self.roots[0].get_gumbels()
+
     def get_trajectories(self):
         return self.roots[0].get_trajectories()
 
@@ -54,6 +68,20 @@ cdef class Roots:
     def get_values(self):
         return self.roots[0].get_values()
 
+    def get_root_outputs(self, float discount, float[:, ::1] policies, float[:, ::1] children_values,
+                         int[:, ::1] distributions, float[::1] values):
+        # Fill the caller-owned arrays of shape (B, A), (B, A), (B, A) and (B, ) in place.
+        cdef int action_space_size = policies.shape[1]
+        if policies.shape[0] != self.root_num or children_values.shape[0] != self.root_num or \
+                distributions.shape[0] != self.root_num or values.shape[0] != self.root_num:
+            raise ValueError("the first dimension of the output arrays must be equal to root_num")
+        if children_values.shape[1] != action_space_size or distributions.shape[1] != action_space_size:
+            raise ValueError("policies, children_values and distributions must have the same action space size")
+        if self.root_num == 0 or action_space_size == 0:
+            return
+        self.roots[0].get_root_outputs(&policies[0, 0], &children_values[0, 0], &distributions[0, 0], &values[0],
+                                       discount, action_space_size)
+
     def clear(self):
         self.roots[0].clear()
 
@@ -102,6 +130,12 @@ def select_interior_child(Node roots, float discount):
 
     return cselect_interior_child(&roots.cnode, discount)
 
+def pselect_interior_child(Roots roots, int index, float discount):
+    # Select a child of the given root with the selection rule of the interior nodes.
+    if index < 0 or index >= roots.root_num:
+        raise IndexError("index out of range")
+    return cselect_interior_child(&(roots.roots[0].roots[index]), discount)
+
 def softmax(list py_num_list):
     cdef vector[float] cnum_list = py_num_list;
     cdef int clength = len(py_num_list)
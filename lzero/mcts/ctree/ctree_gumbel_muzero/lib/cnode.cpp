@@ -86,7 +86,7 @@ namespace tree{
         // gumbel muzero related code
         this->gumbel_scale = 10.0;
         this->gumbel_rng=0.0;
-        this->gumbel = generate_gumbel(this->gumbel_scale, this->gumbel_rng, legal_actions.size());
+        // the gumbel noise is only used by the roots, it is generated lazily by ``CRoots::generate_gumbels``.
     }
 
     CNode::~CNode(){}
@@ -384,6 +384,101 @@ namespace tree{
         return probs;
     }
 
+    //*********************************************************
+    // Gumbel Muzero related code
+    //*********************************************************
+
+    CSequentialHalving::CSequentialHalving()
+    {
+        /*
+        Overview:
+            Initialization of CSequentialHalving with an empty schedule.
+        */
+        this->max_num_considered_actions = 0;
+        this->num_simulations = 0;
+    }
+
+    CSequentialHalving::CSequentialHalving(int max_num_considered_actions, int num_simulations)
+    {
+        /*
+        Overview:
+            Build the sequential halving schedule once per search, i.e. the row of the table of considered visits \
+            that is used at the root node.
+        Arguments:
+            - max_num_considered_actions: the maximum number of considered actions.
+            - num_simulations: the upper limit number of simulations.
+        */
+        this->max_num_considered_actions = max_num_considered_actions;
+        this->num_simulations = num_simulations;
+        int num_considered = std::min(max_num_considered_actions, num_simulations);
+        this->considered_visit_sequence = get_sequence_of_considered_visits(num_considered, num_simulations);
+    }
+
+    CSequentialHalving::~CSequentialHalving(){}
+
+    int CSequentialHalving::get_considered_visit(int simulation_index)
+    {
+        /*
+        Overview:
+            Get the visit count of the actions to be considered at the given simulation.
+        Arguments:
+            - simulation_index: the number of simulations that have been finished at the root.
+        */
+        if (this->considered_visit_sequence.size() == 0)
+        {
+            return 0;
+        }
+        simulation_index = std::max(0, std::min(simulation_index, (int)this->considered_visit_sequence.size() - 1));
+        return this->considered_visit_sequence[simulation_index];
+    }
+
+    CConsideredSet::CConsideredSet()
+    {
+        /*
+        Overview:
+            Initialization of CConsideredSet.
+        */
+        this->considered_visit = 0;
+        this->num_visited = 0;
+        this->max_logit = 0.0;
+        this->max_prior = 0.0;
+        this->prior_exp_sum = 1.0;
+    }
+
+    CConsideredSet::~CConsideredSet(){}
+
+    void CConsideredSet::reset(CNode *root)
+    {
+        /*
+        Overview:
+            Reset the considered set of an expanded root, all legal actions are candidates at the beginning of the search. \
+            The statistics of the priors, which are fixed during the search, are cached here.
+        Arguments:
+            - root: the expanded root node.
+        */
+        int num_actions = root->legal_actions.size();
+        this->considered_visit = 0;
+        this->num_visited = 0;
+        this->candidates.resize(num_actions);
+        this->visited.clear();
+        this->visited.reserve(num_actions);
+        this->is_visited.assign(num_actions, 0);
+
+        this->max_logit = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < num_actions; ++i)
+        {
+            this->candidates[i] = i;
+            this->max_logit = std::max(this->max_logit, root->get_child(root->legal_actions[i])->prior);
+        }
+        // the priors are softmax-ed again in ``qtransform_completed_by_mix_value``.
+        this->max_prior = this->max_logit;
+        this->prior_exp_sum = 0.0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            this->prior_exp_sum += expf(root->get_child(root->legal_actions[i])->prior - this->max_prior);
+        }
+    }
+
     //*********************************************************
 
     CRoots::CRoots()
@@ -411,6 +506,8 @@ namespace tree{
         {
             this->roots.push_back(CNode(0, this->legal_actions_list[i]));
         }
+        this->considered_sets.resize(root_num);
+        this->gumbel_seeds = std::vector<unsigned int>(root_num, 0);
     }
 
     CRoots::~CRoots() {}
@@ -431,6 +528,7 @@ namespace tree{
         for(int i = 0; i < this->root_num; ++i){
             this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], values[i], policies[i]);
             this->roots[i].add_exploration_noise(root_noise_weight, noises[i]);
+            this->considered_sets[i].reset(&(this->roots[i]));
 
             this->roots[i].visit_count += 1;
         }
@@ -449,6 +547,7 @@ namespace tree{
         */
         for(int i = 0; i < this->root_num; ++i){
             this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], values[i], policies[i]);
+            this->considered_sets[i].reset(&(this->roots[i]));
 
             this->roots[i].visit_count += 1;
         }
@@ -461,6 +560,68 @@ namespace tree{
             Clear the roots vector.
         */
         this->roots.clear();
+        this->considered_sets.clear();
+        this->gumbel_seeds.clear();
+    }
+
+    void CRoots::set_gumbel_seeds(const std::vector<unsigned int> &gumbel_seeds)
+    {
+        /*
+        Overview:
+            Set the seed of the gumbel noise of each root. The gumbel noise already generated is dropped and \
+            will be generated again with the new seeds before the next traversal.
+        Arguments:
+            - gumbel_seeds: the vector of the gumbel seed of each root.
+        */
+        for(int i = 0; i < this->root_num; ++i){
+            this->gumbel_seeds[i] = gumbel_seeds[i];
+            this->roots[i].gumbel.clear();
+        }
+    }
+
+    void CRoots::generate_gumbels()
+    {
+        /*
+        Overview:
+            Generate the gumbel noise of the roots whose noise is missing in one pass, \
+            one random engine and distribution are reseeded for each root instead of being constructed per node.
+        */
+        std::mt19937 gen;
+        std::extreme_value_distribution<float> d(0, 1);
+        for(int i = 0; i < this->root_num; ++i){
+            CNode *root = &(this->roots[i]);
+            int num_actions = root->legal_actions.size();
+            if (root->gumbel.size() == num_actions)
+            {
+                continue;
+            }
+            gen.seed(this->gumbel_seeds[i]);
+            d.reset();
+            root->gumbel.resize(num_actions);
+            for (int j = 0; j < num_actions; ++j)
+            {
+                root->gumbel[j] = root->gumbel_scale * d(gen);
+            }
+        }
+    }
+
+    std::vector<std::vector<float> > CRoots::get_gumbels()
+    {
+        /*
+        Overview:
+            Return the gumbel noise of each root, the missing noise is generated first.
+        Returns:
+            - gumbels: a vector of the gumbel noise of each root, in the order of its legal actions.
+        */
+        this->generate_gumbels();
+        std::vector<std::vector<float> > gumbels;
+        gumbels.reserve(this->root_num);
+
+        for (int i = 0; i < this->root_num; ++i)
+        {
+            gumbels.push_back(this->roots[i].gumbel);
+        }
+        return gumbels;
     }
 
     std::vector<std::vector<int> > CRoots::get_trajectories()
@@ -540,6 +701,68 @@ namespace tree{
         return probs;
     }
 
+    void CRoots::get_root_outputs(float *policies, float *children_values, int *distributions, float *values, float discount_factor, int action_space_size)
+    {
+        /*
+        Overview:
+            Write the improved policy, the completed value and the visit count of the children of each root, \
+            together with the value of each root, into the caller-owned dense buffers in one pass over the roots. \
+            The policies and children values are equal to ``get_policies`` and ``get_children_values``, \
+            the visit counts of the illegal actions are 0.
+        Arguments:
+            - policies: the buffer of shape (root_num, action_space_size) to write the improved policies.
+            - children_values: the buffer of shape (root_num, action_space_size) to write the completed values.
+            - distributions: the buffer of shape (root_num, action_space_size) to write the visit counts.
+            - values: the buffer of shape (root_num, ) to write the values of the roots.
+            - discount_factor: the discount_factor of reward.
+            - action_space_size: the action space size of environment.
+        */
+        float infymin = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < this->root_num; ++i)
+        {
+            CNode *root = &(this->roots[i]);
+            float *policy = policies + (size_t)i * action_space_size;
+            float *children_value = children_values + (size_t)i * action_space_size;
+            int *distribution = distributions + (size_t)i * action_space_size;
+            values[i] = root->value();
+            std::fill(distribution, distribution + action_space_size, 0);
+            std::fill(children_value, children_value + action_space_size, infymin);
+            std::fill(policy, policy + action_space_size, infymin);
+            if (!root->expanded())
+            {
+                continue;
+            }
+
+            int num_actions = root->legal_actions.size();
+            CSelectionScratch &scratch = get_selection_scratch(num_actions);
+            ccompleted_qvalues(root, discount_factor, scratch);
+            for (int j = 0; j < num_actions; ++j)
+            {
+                int a = root->legal_actions[j];
+                distribution[a] = scratch.child_visit[j];
+                children_value[a] = scratch.child_qvalue[j];
+                policy[a] = scratch.child_prior[j] + scratch.child_qvalue[j];
+            }
+
+            // softmax over the whole action space, the illegal actions get the probability 0.
+            float max_policy = policy[0];
+            for (int a = 1; a < action_space_size; ++a)
+            {
+                max_policy = std::max(max_policy, policy[a]);
+            }
+            float policy_exp_sum = 0.0;
+            for (int a = 0; a < action_space_size; ++a)
+            {
+                policy_exp_sum += expf(policy[a] - max_policy);
+            }
+            double log_policy_exp_sum = log(policy_exp_sum);
+            for (int a = 0; a < action_space_size; ++a)
+            {
+                policy[a] = expf(policy[a] - max_policy - log_policy_exp_sum);
+            }
+        }
+    }
+
     std::vector<float> CRoots::get_values()
     {
         /*
@@ -711,82 +934,284 @@ namespace tree{
         Returns:
             - action: the action to select.
         */
-        std::vector<int> child_visit_count;
-        std::vector<float> child_prior;
-        for(auto a: root->legal_actions){
-            CNode* child = root->get_child(a);
-            child_visit_count.push_back(child->visit_count);
-            child_prior.push_back(child->prior);
+        if (root->gumbel.size() != root->legal_actions.size())
+        {
+            root->gumbel = generate_gumbel(root->gumbel_scale, root->gumbel_rng, root->legal_actions.size());
         }
-        assert(child_visit_count.size()==child_prior.size());
+        CSequentialHalving sequential_halving(max_num_considered_actions, num_simulations);
+        CConsideredSet considered_set;
+        considered_set.reset(root);
+        for (int i = 0; i < root->legal_actions.size(); ++i)
+        {
+            if (root->get_child(root->legal_actions[i])->visit_count > 0)
+            {
+                considered_set.is_visited[i] = 1;
+                considered_set.visited.push_back(i);
+            }
+        }
+        return cselect_root_child(root, discount_factor, sequential_halving, considered_set);
+    }
 
-        std::vector<float> completed_qvalues = qtransform_completed_by_mix_value(root, child_visit_count, child_prior, discount_factor);
-        std::vector<std::vector<int> > visit_table = get_table_of_considered_visits(max_num_considered_actions, num_simulations);
-        
-        int num_valid_actions = root->legal_actions.size();
-        int num_considered = std::min(max_num_considered_actions, num_simulations);
-        int simulation_index = std::accumulate(child_visit_count.begin(), child_visit_count.end(), 0);
-        int considered_visit = visit_table[num_considered][simulation_index];
+    int cselect_root_child(CNode* root, float discount_factor, CSequentialHalving &sequential_halving, CConsideredSet &considered_set)
+    {
+        /*
+        Overview:
+            Select the child node of the roots in gumbel muzero with a precomputed sequential halving schedule. \
+            Only the actions whose visit count equals the considered visit can be selected, and the actions that fall \
+            behind the considered visit can never catch up again, so they are dropped from the candidates once per phase. \
+            The completed Q values only depend on the visited children, so one selection costs O(considered) without allocation.
+        Arguments:
+            - root: the roots to select the child node.
+            - disount_factor: the discount factor of reward.
+            - sequential_halving: the sequential halving schedule of the current search.
+            - considered_set: the incremental considered set of the root.
+        Returns:
+            - action: the action to select.
+        */
+        const float maxvisit_init = 50.0, value_scale = 0.1, epsilon = 1e-8, low_logit = -1e9;
+        int num_actions = root->legal_actions.size();
+        if (considered_set.is_visited.size() != num_actions)
+        {
+            considered_set.reset(root);
+        }
 
-        std::vector<float> score = score_considered(considered_visit, root->gumbel, child_prior, completed_qvalues, child_visit_count);
+        // statistics of the visited children, see ``compute_mixed_value`` and ``qtransform_completed_by_mix_value``.
+        int simulation_index = 0, max_visit = 0, num_visited_children = 0;
+        float probs_sum = 0.0, weighted_q_sum = 0.0;
+        float min_q = std::numeric_limits<float>::infinity(), max_q = -std::numeric_limits<float>::infinity();
+        for (auto index : considered_set.visited)
+        {
+            CNode* child = root->get_child(root->legal_actions[index]);
+            if (child->visit_count > 0)
+            {
+                float prob = std::max(expf(child->prior - considered_set.max_prior) / considered_set.prior_exp_sum, -10e7f);
+                float qsa = child->reward + discount_factor * child->value();
+                simulation_index += child->visit_count;
+                max_visit = std::max(max_visit, child->visit_count);
+                probs_sum += prob;
+                weighted_q_sum += prob * qsa;
+                min_q = std::min(min_q, qsa);
+                max_q = std::max(max_q, qsa);
+                num_visited_children += 1;
+            }
+        }
+        float mixed_value = root->raw_value;
+        if (num_visited_children > 0)
+        {
+            mixed_value = (root->raw_value + simulation_index * (weighted_q_sum / probs_sum)) / (simulation_index + 1);
+        }
+        if (num_visited_children < num_actions)
+        {
+            // the unvisited children are completed by the mixed value.
+            min_q = std::min(min_q, mixed_value);
+            max_q = std::max(max_q, mixed_value);
+        }
+        float gap = std::max(max_q - min_q, epsilon);
+        float visit_scale = (maxvisit_init + max_visit) * value_scale;
+
+        // drop the candidates that can not be considered any more when a new phase begins.
+        int considered_visit = sequential_halving.get_considered_visit(simulation_index);
+        if (considered_visit < considered_set.considered_visit)
+        {
+            considered_set.candidates.resize(num_actions);
+            for (int i = 0; i < num_actions; ++i)
+            {
+                considered_set.candidates[i] = i;
+            }
+        }
+        else if (considered_visit > considered_set.considered_visit)
+        {
+            int num_candidates = 0;
+            for (auto index : considered_set.candidates)
+            {
+                if (root->get_child(root->legal_actions[index])->visit_count >= considered_visit)
+                {
+                    considered_set.candidates[num_candidates++] = index;
+                }
+            }
+            considered_set.candidates.resize(num_candidates);
+        }
+        considered_set.considered_visit = considered_visit;
 
+        // rescore only the candidates.
         float argmax = -std::numeric_limits<float>::infinity();
-        int max_action = root->legal_actions[0];
-        int index = 0;
-        for(auto a: root->legal_actions){
-            if(score[index] > argmax){
-                argmax = score[index];
-                max_action = a;
+        int max_index = -1;
+        for (auto index : considered_set.candidates)
+        {
+            CNode* child = root->get_child(root->legal_actions[index]);
+            if (child->visit_count != considered_visit)
+            {
+                continue;
+            }
+            float completed_qvalue = mixed_value;
+            if (child->visit_count > 0)
+            {
+                completed_qvalue = child->reward + discount_factor * child->value();
+            }
+            completed_qvalue = (completed_qvalue - min_q) / gap * visit_scale;
+            float score = std::max(low_logit, root->gumbel[index] + child->prior - considered_set.max_logit + completed_qvalue);
+            if (score > argmax)
+            {
+                argmax = score;
+                max_index = index;
             }
-            index += 1;
         }
 
-        return max_action;    
+        if (max_index < 0)
+        {
+            return root->legal_actions[0];
+        }
+        if (!considered_set.is_visited[max_index])
+        {
+            considered_set.is_visited[max_index] = 1;
+            considered_set.visited.push_back(max_index);
+        }
+        return root->legal_actions[max_index];
     }
 
     int cselect_interior_child(CNode* root, float discount_factor)
     {
         /*
         Overview:
-            Select the child node of the interior node in gumbel muzero.
+            Select the child node of the interior node in gumbel muzero. \
+            The completed Q values are computed in the thread-local scratch arrays by ``ccompleted_qvalues``, \
+            then the softmax and the argmax are computed in place, which is equal to \
+            ``qtransform_completed_by_mix_value`` + ``csoftmax`` without any allocation.
         Arguments:
             - root: the roots to select the child node.
             - disount_factor: the discount factor of reward.
         Returns:
             - action: the action to select.
         */
-        std::vector<int> child_visit_count;
-        std::vector<float> child_prior;
-        for(auto a: root->legal_actions){
-            CNode* child = root->get_child(a);
-            child_visit_count.push_back(child->visit_count);
-            child_prior.push_back(child->prior);
-        }
-        assert(child_visit_count.size()==child_prior.size());
-        std::vector<float> completed_qvalues = qtransform_completed_by_mix_value(root, child_visit_count, child_prior, discount_factor);
-        std::vector<float> probs;
-        for (int i=0;i<child_prior.size();i++){
-            probs.push_back(child_prior[i] + completed_qvalues[i]);
+        int num_actions = root->legal_actions.size();
+        CSelectionScratch &scratch = get_selection_scratch(num_actions);
+        int visit_count_sum = ccompleted_qvalues(root, discount_factor, scratch);
+        int *child_visit = scratch.child_visit.data();
+        float *child_prior = scratch.child_prior.data();
+        float *child_qvalue = scratch.child_qvalue.data();
+        float *child_score = scratch.child_score.data();
+
+        float max_score = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < num_actions; ++i)
+        {
+            child_score[i] = child_prior[i] + child_qvalue[i];
+            max_score = std::max(max_score, child_score[i]);
         }
-        csoftmax(probs, probs.size());
-        int visit_count_sum = std::accumulate(child_visit_count.begin(), child_visit_count.end(), 0);
-        std::vector<float> to_argmax;
-        for (int i=0;i<probs.size();i++){
-            to_argmax.push_back(probs[i] - (float)child_visit_count[i]/(float)(1+visit_count_sum));
+
+        // softmax of the improved policy and argmax of the visit-penalized probabilities.
+        float score_exp_sum = 0.0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            score_exp_sum += expf(child_score[i] - max_score);
         }
-        
+        double log_score_exp_sum = log(score_exp_sum);
         float argmax = -std::numeric_limits<float>::infinity();
-        int max_action = root->legal_actions[0];
-        int index = 0;
-        for(auto a: root->legal_actions){
-            if(to_argmax[index] > argmax){
-                argmax = to_argmax[index];
-                max_action = a;
+        int max_index = 0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            float to_argmax = expf(child_score[i] - max_score - log_score_exp_sum) - (float)child_visit[i] / (float)(1 + visit_count_sum);
+            if (to_argmax > argmax)
+            {
+                argmax = to_argmax;
+                max_index = i;
             }
-            index += 1;
         }
-        
-        return max_action;
+
+        return root->legal_actions[max_index];
+    }
+
+    int ccompleted_qvalues(CNode* root, float discount_factor, CSelectionScratch &scratch)
+    {
+        /*
+        Overview:
+            Compute the completed Q values of the children in place. The statistics of the children are gathered once \
+            into the scratch arrays, then the mixed value and the rescaled completed Q values are computed over the \
+            contiguous arrays, which is equal to ``qtransform_completed_by_mix_value`` without any allocation.
+        Arguments:
+            - root: the node whose children are completed.
+            - disount_factor: the discount factor of reward.
+            - scratch: the scratch arrays holding at least the number of legal actions of the node, \
+                ``child_visit``, ``child_prior`` and ``child_qvalue`` are filled in the order of the legal actions.
+        Returns:
+            - visit_count_sum: the sum of the visit counts of the children.
+        */
+        const float maxvisit_init = 50.0, value_scale = 0.1, epsilon = 1e-8, min_num = -10e7;
+        int num_actions = root->legal_actions.size();
+        int *child_visit = scratch.child_visit.data();
+        float *child_prior = scratch.child_prior.data();
+        float *child_qvalue = scratch.child_qvalue.data();
+        float *child_score = scratch.child_score.data();
+
+        // gather the statistics of the children.
+        int visit_count_sum = 0, max_visit = 0;
+        float max_prior = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < num_actions; ++i)
+        {
+            CNode* child = root->get_child(root->legal_actions[i]);
+            child_visit[i] = child->visit_count;
+            child_prior[i] = child->prior;
+            child_qvalue[i] = child->reward + discount_factor * child->value();
+            visit_count_sum += child->visit_count;
+            max_visit = std::max(max_visit, child->visit_count);
+            max_prior = std::max(max_prior, child->prior);
+        }
+
+        // softmax of the priors and the mixed value, see ``compute_mixed_value``.
+        float prior_exp_sum = 0.0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            prior_exp_sum += expf(child_prior[i] - max_prior);
+        }
+        double log_prior_exp_sum = log(prior_exp_sum);
+        float probs_sum = 0.0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            child_score[i] = std::max(expf(child_prior[i] - max_prior - log_prior_exp_sum), min_num);
+            probs_sum += child_visit[i] > 0 ? child_score[i] : 0.0f;
+        }
+        float weighted_q_sum = 0.0;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            weighted_q_sum += child_visit[i] > 0 ? child_score[i] * child_qvalue[i] / probs_sum : 0.0f;
+        }
+        float mixed_value = (root->raw_value + (float)visit_count_sum * weighted_q_sum) / ((float)visit_count_sum + 1);
+
+        // completed Q values with max-min normalization, see ``qtransform_completed_by_mix_value``.
+        float min_q = std::numeric_limits<float>::infinity(), max_q = -std::numeric_limits<float>::infinity();
+        for (int i = 0; i < num_actions; ++i)
+        {
+            child_qvalue[i] = child_visit[i] > 0 ? child_qvalue[i] : mixed_value;
+            min_q = std::min(min_q, child_qvalue[i]);
+            max_q = std::max(max_q, child_qvalue[i]);
+        }
+        float gap = std::max(max_q - min_q, epsilon);
+        float visit_scale = maxvisit_init + (float)max_visit;
+        for (int i = 0; i < num_actions; ++i)
+        {
+            child_qvalue[i] = (child_qvalue[i] - min_q) / gap * visit_scale * value_scale;
+        }
+        return visit_count_sum;
+    }
+
+    CSelectionScratch &get_selection_scratch(int num_actions)
+    {
+        /*
+        Overview:
+            Return the scratch arrays of the current thread, which only grow and are reused by every selection.
+        Arguments:
+            - num_actions: the least number of children the scratch arrays have to hold.
+        Returns:
+            - scratch: the thread-local scratch arrays.
+        */
+        static thread_local CSelectionScratch scratch;
+        if (scratch.child_visit.size() < num_actions)
+        {
+            scratch.child_visit.resize(num_actions);
+            scratch.child_prior.resize(num_actions);
+            scratch.child_qvalue.resize(num_actions);
+            scratch.child_score.resize(num_actions);
+        }
+        return scratch;
     }
 
     float cucb_score(CNode *child, tools::CMinMaxStats &min_max_stats, float parent_mean_q, float total_children_visit_counts, float pb_c_base, float pb_c_init, float discount_factor, int players)
@@ -860,6 +1285,14 @@ namespace tree{
         else
             players = 2;
 
+        // the sequential halving schedule is only built once per search.
+        if (roots->sequential_halving.num_simulations != num_simulations || roots->sequential_halving.max_num_considered_actions != max_num_considered_actions)
+        {
+            roots->sequential_halving = CSequentialHalving(max_num_considered_actions, num_simulations);
+        }
+        // the gumbel noise of the roots is generated at the first traversal of the search.
+        roots->generate_gumbels();
+
         for(int i = 0; i < results.num; ++i){
             CNode *node = &(roots->roots[i]);
             int is_root = 1;
@@ -869,7 +1302,7 @@ namespace tree{
 
             while(node->expanded()){
                 if(is_root){
-                    action = cselect_root_child(node, discount_factor, num_simulations, max_num_considered_actions);
+                    action = cselect_root_child(node, discount_factor, roots->sequential_halving, roots->considered_sets[i]);
                 }
                 else{
                     action = cselect_interior_child(node, discount_factor);
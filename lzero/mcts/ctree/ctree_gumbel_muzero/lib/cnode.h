@@ -49,11 +49,47 @@ namespace tree {
             CNode* get_child(int action);
     };
 
+    class CSequentialHalving{
+        public:
+            int max_num_considered_actions, num_simulations;
+            std::vector<int> considered_visit_sequence;
+
+            CSequentialHalving();
+            CSequentialHalving(int max_num_considered_actions, int num_simulations);
+            ~CSequentialHalving();
+
+            int get_considered_visit(int simulation_index);
+    };
+
+    class CConsideredSet{
+        public:
+            int considered_visit, num_visited;
+            float max_logit, max_prior, prior_exp_sum;
+            std::vector<int> candidates;
+            std::vector<int> visited;
+            std::vector<char> is_visited;
+
+            CConsideredSet();
+            ~CConsideredSet();
+
+            void reset(CNode *root);
+    };
+
+    class CSelectionScratch{
+        public:
+            std::vector<int> child_visit;
+            std::vector<float> child_prior, child_qvalue, child_score;
+    };
+
     class CRoots{
         public:
             int root_num;
             std::vector<CNode> roots;
             std::vector<std::vector<int> > legal_actions_list;
+            // gumbel muzero related code
+            CSequentialHalving sequential_halving;
+            std::vector<CConsideredSet> considered_sets;
+            std::vector<unsigned int> gumbel_seeds;
 
             CRoots();
             CRoots(int root_num, std::vector<std::vector<int> > &legal_actions_list);
@@ -62,11 +98,15 @@ namespace tree {
             void prepare(float root_noise_weight, const std::vector<std::vector<float> > &noises, const std::vector<float> &rewards, const std::vector<float> &values, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
             void prepare_no_noise(const std::vector<float> &rewards, const std::vector<float> &values, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
             void clear();
+            void set_gumbel_seeds(const std::vector<unsigned int> &gumbel_seeds);
+            void generate_gumbels();
+            std::vector<std::vector<float> > get_gumbels();
             std::vector<std::vector<int> > get_trajectories();
             std::vector<std::vector<int> > get_distributions();
             std::vector<std::vector<float> > get_children_values(float discount, int action_space_size);
             std::vector<std::vector<float> > get_policies(float discount, int action_space_size);
             std::vector<float> get_values();
+            void get_root_outputs(float *policies, float *children_values, int *distributions, float *values, float discount, int action_space_size);
 
     };
 
@@ -90,7 +130,10 @@ namespace tree {
     void cback_propagate(std::vector<CNode*> &search_path, tools::CMinMaxStats &min_max_stats, int to_play, float value, float discount);
     void cbatch_back_propagate(int current_latent_state_index, float discount, const std::vector<float> &rewards, const std::vector<float> &values, const std::vector<std::vector<float> > &policies, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &to_play_batch);
     int cselect_root_child(CNode* root, float discount, int num_simulations, int max_num_considered_actions);
+    int cselect_root_child(CNode* root, float discount, CSequentialHalving &sequential_halving, CConsideredSet &considered_set);
     int cselect_interior_child(CNode* root, float discount);
+    int ccompleted_qvalues(CNode* root, float discount, CSelectionScratch &scratch);
+    CSelectionScratch &get_selection_scratch(int num_actions);
     int cselect_child(CNode* root, tools::CMinMaxStats &min_max_stats, int pb_c_base, float pb_c_init, float discount, float mean_q, int players);
     float cucb_score(CNode *child, tools::CMinMaxStats &min_max_stats, float parent_mean_q, float total_children_visit_counts, float pb_c_base, float pb_c_init, float discount, int players);
     void cbatch_traverse(CRoots *roots, int num_simulations, int max_num_considered_actions, float discount, CSearchResults &results, std::vector<int> &virtual_to_play_batch);
@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <map>
 #include <cassert>
+#include <climits>
 
 #ifdef _WIN32
 #include "..\..\common_lib\utils.cpp"
@@ -23,6 +24,7 @@ namespace tree
             Initialization of CSearchResults, the default result number is set to 0.
         */
         this->num = 0;
+        this->node_pool = NULL;
     }
 
     CSearchResults::CSearchResults(int num)
@@ -32,6 +34,7 @@ namespace tree
             Initialization of CSearchResults with result number.
         */
         this->num = num;
+        this->node_pool = NULL;
         for (int i = 0; i < num; ++i)
         {
             this->search_paths.push_back(std::vector<CNode *>());
@@ -40,6 +43,25 @@ namespace tree
 
     CSearchResults::~CSearchResults() {}
 
+    void CSearchResults::reset()
+    {
+        /*
+        Overview:
+            Clear the results of the last simulation in place, keeping the allocated capacity of all buffers.
+        */
+        this->latent_state_index_in_search_path.clear();
+        this->latent_state_index_in_batch.clear();
+        this->last_actions.clear();
+        this->search_lens.clear();
+        this->virtual_to_play_batchs.clear();
+        this->root_indices.clear();
+        this->nodes.clear();
+        for (int i = 0; i < this->num; ++i)
+        {
+            this->search_paths[i].clear();
+        }
+    }
+
     //*********************************************************
 
     CNode::CNode()
@@ -50,9 +72,12 @@ namespace tree
         */
         this->prior = 0;
         this->legal_actions = legal_actions;
+        this->children = NULL;
 
         this->visit_count = 0;
         this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
         this->best_action = -1;
         this->to_play = 0;
         this->reward = 0.0;
@@ -69,9 +94,12 @@ namespace tree
         */
         this->prior = prior;
         this->legal_actions = legal_actions;
+        this->children = NULL;
 
         this->visit_count = 0;
         this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
         this->best_action = -1;
         this->to_play = 0;
         this->current_latent_state_index = -1;
@@ -80,7 +108,30 @@ namespace tree
 
     CNode::~CNode() {}
 
-    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits)
+    void CNode::reset(float prior)
+    {
+        /*
+        Overview:
+            Reset the current node to an unexpanded node in place, the legal actions are kept. \
+            The children are not freed, they are recycled with the node pool of the tree.
+        Arguments:
+            - prior: the prior value of this node.
+        */
+        this->prior = prior;
+        this->visit_count = 0;
+        this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
+        this->best_action = -1;
+        this->to_play = 0;
+        this->reward = 0.0;
+        this->current_latent_state_index = -1;
+        this->batch_index = -1;
+        this->children_index.clear();
+        this->children = NULL;
+    }
+
+    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, CNodePool *node_pool)
     {
         /*
         Overview:
@@ -91,6 +142,7 @@ namespace tree
             - batch_index: The index of latent state of the leaf node in the search path of the current node.
             - reward: the reward of the current node.
             - policy_logits: the logit of the child nodes.
+            - node_pool: the node pool of the tree, the children are taken from it.
         */
         this->to_play = to_play;
         this->current_latent_state_index = current_latent_state_index;
@@ -131,12 +183,12 @@ namespace tree
             policy[a] = temp_policy;
         }
 
-        float prior;
+        // the nodes of the pool may be recycled from a previous search, so the children are reset in place.
+        this->children = node_pool->allocate(action_num);
         for (auto a : this->legal_actions)
         {
-            prior = policy[a] / policy_sum;
-            std::vector<int> tmp_empty;
-            this->children[a] = CNode(prior, tmp_empty); // only for muzero/efficient zero, not support alphazero
+            this->children[a].reset(policy[a] / policy_sum);
+            this->children[a].legal_actions.clear();
         }
         
         #ifdef _WIN32
@@ -166,29 +218,18 @@ namespace tree
         }
     }
 
-    float CNode::compute_mean_q(int isRoot, float parent_q, float discount_factor)
+    float CNode::compute_mean_q(int isRoot, float parent_q)
     {
         /*
         Overview:
-            Compute the mean q value of the current node.
+            Compute the mean q value of the current node in O(1) from the running statistics of its visited children.
         Arguments:
             - isRoot: whether the current node is a root node.
             - parent_q: the q value of the parent node.
-            - discount_factor: the discount_factor of reward.
         */
-        float total_unsigned_q = 0.0;
-        int total_visits = 0;
-        for (auto a : this->legal_actions)
-        {
-            CNode *child = this->get_child(a);
-            if (child->visit_count > 0)
-            {
-                float true_reward = child->reward;
-                float qsa = true_reward + discount_factor * child->value();
-                total_unsigned_q += qsa;
-                total_visits += 1;
-            }
-        }
+        // The q values of the visited children are accumulated incrementally in cbackpropagate.
+        float total_unsigned_q = (float)this->children_q_sum;
+        int total_visits = this->num_visited_children;
 
         float mean_q = 0.0;
         if (isRoot && total_visits > 0)
@@ -202,6 +243,41 @@ namespace tree
         return mean_q;
     }
 
+    float CNode::compute_child_q(CNode *child, float discount_factor)
+    {
+        /*
+        Overview:
+            Compute the q value of a child node from the perspective of the current node.
+        Arguments:
+            - child: the child node.
+            - discount_factor: the discount_factor of reward.
+        */
+        float true_reward = child->reward;
+        return true_reward + discount_factor * child->value();
+    }
+
+    void CNode::update_child_q(CNode *child, float old_qsa, float discount_factor)
+    {
+        /*
+        Overview:
+            Update the running sum and count of the visited children's q values after the statistics of a child changed.
+        Arguments:
+            - child: the child node whose value sum and visit count have just been updated.
+            - old_qsa: the q value of the child before the update, ignored if this is its first visit.
+            - discount_factor: the discount_factor of reward.
+        */
+        float new_qsa = this->compute_child_q(child, discount_factor);
+        if (child->visit_count == 1)
+        {
+            this->num_visited_children += 1;
+            this->children_q_sum += new_qsa;
+        }
+        else
+        {
+            this->children_q_sum += new_qsa - old_qsa;
+        }
+    }
+
     void CNode::print_out()
     {
         return;
@@ -213,7 +289,7 @@ namespace tree
         Overview:
             Return whether the current node is expanded.
         */
-        return this->children.size() > 0;
+        return this->children != NULL;
     }
 
     float CNode::value()
@@ -289,6 +365,71 @@ namespace tree
 
     //*********************************************************
 
+    CNodePool::CNodePool()
+    {
+        /*
+        Overview:
+            The initialization of CNodePool.
+        */
+        this->block_size = 4096;
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    CNodePool::CNodePool(int block_size)
+    {
+        /*
+        Overview:
+            The initialization of CNodePool with the number of nodes in each block.
+        Arguments:
+            - block_size: the number of nodes in each block.
+        */
+        this->block_size = block_size;
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    CNodePool::~CNodePool() {}
+
+    CNode* CNodePool::allocate(int num)
+    {
+        /*
+        Overview:
+            Allocate contiguous nodes from the pool. The nodes are never moved, \
+            so the pointers stay valid until the pool is reset. The blocks double in size up to block_size, \
+            so that a small tree does not construct a whole block of nodes.
+        Arguments:
+            - num: the number of contiguous nodes to allocate.
+        Returns:
+            - nodes: the pointer to the first allocated node, which may hold the state of a previous search.
+        */
+        while (this->current_block < this->blocks.size() && this->num_used + num > this->blocks[this->current_block].size())
+        {
+            this->current_block += 1;
+            this->num_used = 0;
+        }
+        if (this->current_block == this->blocks.size())
+        {
+            int size = this->blocks.empty() ? 64 : 2 * int(this->blocks.back().size());
+            this->blocks.push_back(std::vector<CNode>(std::max(std::min(size, this->block_size), num)));
+        }
+        CNode *nodes = &(this->blocks[this->current_block][this->num_used]);
+        this->num_used += num;
+        return nodes;
+    }
+
+    void CNodePool::reset()
+    {
+        /*
+        Overview:
+            Release all the nodes of the pool for the next search, keeping the blocks.
+        */
+        this->current_block = 0;
+        this->num_used = 0;
+    }
+
+    //*********************************************************
+
     CRoots::CRoots()
     {
         /*
@@ -296,6 +437,7 @@ namespace tree
             The initialization of CRoots.
         */
         this->root_num = 0;
+        this->num_active = 0;
     }
 
     CRoots::CRoots(int root_num, std::vector<std::vector<int> > &legal_actions_list)
@@ -308,7 +450,10 @@ namespace tree
             - legal_action_list: the vector of the legal action of this root.
         */
         this->root_num = root_num;
+        this->num_active = root_num;
         this->legal_actions_list = legal_actions_list;
+        this->budgets.assign(root_num, INT_MAX);
+        this->active.assign(root_num, 1);
 
         for (int i = 0; i < root_num; ++i)
         {
@@ -332,7 +477,7 @@ namespace tree
         */
         for (int i = 0; i < this->root_num; ++i)
         {
-            this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], policies[i]);
+            this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], policies[i], &(this->node_pool));
             this->roots[i].add_exploration_noise(root_noise_weight, noises[i]);
 
             this->roots[i].visit_count += 1;
@@ -351,19 +496,137 @@ namespace tree
         */
         for (int i = 0; i < this->root_num; ++i)
         {
-            this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], policies[i]);
+            this->roots[i].expand(to_play_batch[i], 0, i, rewards[i], policies[i], &(this->node_pool));
 
             this->roots[i].visit_count += 1;
         }
     }
 
+    void CRoots::reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size)
+    {
+        /*
+        Overview:
+            Reinitialize the roots in place for a new search, reusing the storage of the roots and their legal actions.
+        Arguments:
+            - root_num: the number of the roots in the new search.
+            - legal_actions_mask: the row-major legal action mask of shape (root_num, action_space_size).
+            - action_space_size: the size of action space of the current env.
+        */
+        this->root_num = root_num;
+        this->num_active = root_num;
+        this->legal_actions_list.resize(root_num);
+        this->roots.resize(root_num);
+        this->budgets.assign(root_num, INT_MAX);
+        this->active.assign(root_num, 1);
+        // the nodes of the previous search are recycled by the next one.
+        this->node_pool.reset();
+
+        for (int i = 0; i < root_num; ++i)
+        {
+            const unsigned char *mask = legal_actions_mask + i * action_space_size;
+            std::vector<int> &legal_actions = this->legal_actions_list[i];
+            legal_actions.clear();
+            for (int a = 0; a < action_space_size; ++a)
+            {
+                if (mask[a])
+                {
+                    legal_actions.push_back(a);
+                }
+            }
+            this->roots[i].reset(0);
+            this->roots[i].legal_actions = legal_actions;
+        }
+    }
+
     void CRoots::clear()
     {
         /*
         Overview:
-            Clear the roots vector.
+            Clear the roots vector and release the nodes of the tree.
         */
         this->roots.clear();
+        this->node_pool.reset();
+    }
+
+    void CRoots::set_budgets(const std::vector<int> &budgets)
+    {
+        /*
+        Overview:
+            Set the simulation budget of each root and reactivate the roots with a positive budget. \
+            The roots with a budget of 0 or less are retired at once, so that they run no simulation.
+        Arguments:
+            - budgets: the maximum number of simulations of each root.
+        */
+        assert((int)budgets.size() == this->root_num);
+        this->budgets = budgets;
+        this->num_active = 0;
+        for (int i = 0; i < this->root_num; ++i)
+        {
+            this->active[i] = budgets[i] > 0;
+            this->num_active += this->active[i];
+        }
+    }
+
+    int CRoots::update_active(float entropy_threshold, int entropy_min_simulations)
+    {
+        /*
+        Overview:
+            Retire the active roots whose search can stop early. A retired root is skipped by ``cbatch_traverse``, \
+            so that its leaves drop out of the following inference batches. A root retires when its budget is used up, \
+            when the remaining simulations cannot change the most visited child, or when the entropy of the visit \
+            distribution of its children is below ``entropy_threshold`` after ``entropy_min_simulations`` simulations.
+        Arguments:
+            - entropy_threshold: the visit entropy (in nats) under which a root retires, 0 disables this criterion.
+            - entropy_min_simulations: the number of simulations of a root before the entropy criterion applies.
+        Returns:
+            - num_active: the number of roots still active.
+        */
+        this->num_active = 0;
+        for (int i = 0; i < this->root_num; ++i)
+        {
+            if (!this->active[i])
+            {
+                continue;
+            }
+            CNode *root = &(this->roots[i]);
+            // the visit count of an expanded root is one more than its number of simulations.
+            int simulations = root->visit_count - 1;
+            int remaining = this->budgets[i] - simulations;
+
+            int best = 0, second = 0;
+            double entropy = 0.0;
+            for (auto a : root->legal_actions)
+            {
+                int visits = root->get_child(a)->visit_count;
+                if (visits > best)
+                {
+                    second = best;
+                    best = visits;
+                }
+                else if (visits > second)
+                {
+                    second = visits;
+                }
+                if (visits > 0 && simulations > 0)
+                {
+                    double p = double(visits) / simulations;
+                    entropy -= p * log(p);
+                }
+            }
+
+            // the runner-up can not catch up with the most visited child within the remaining simulations.
+            bool decided = remaining <= 0 || second + remaining < best;
+            bool concentrated = entropy_threshold > 0 && simulations >= entropy_min_simulations && simulations > 0 && entropy < entropy_threshold;
+            if (decided || concentrated)
+            {
+                this->active[i] = 0;
+            }
+            else
+            {
+                this->num_active += 1;
+            }
+        }
+        return this->num_active;
     }
 
     std::vector<std::vector<int> > CRoots::get_trajectories()
@@ -437,8 +700,14 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 node->value_sum += bootstrap_value;
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 float true_reward = node->reward;
 
@@ -455,11 +724,17 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 if (node->to_play == to_play)
                     node->value_sum += bootstrap_value;
                 else
                     node->value_sum += -bootstrap_value;
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 // NOTE: in self-play-mode, value_prefix is not calculated according to the perspective of current player of node,
                 // but treated as 1 player, just for obtaining the true reward in the perspective of current player of node.
@@ -492,10 +767,11 @@ namespace tree
             - results: the search results.
             - to_play_batch: the batch of which player is playing on this node.
         */
-        for (int i = 0; i < results.num; ++i)
+        // only the roots traversed by ``cbatch_traverse`` have a leaf, the i-th of which belongs to root ``root_indices[i]``.
+        for (int i = 0; i < int(results.nodes.size()); ++i)
         {
-            results.nodes[i]->expand(to_play_batch[i], current_latent_state_index, i, rewards[i], policies[i]);
-            cbackpropagate(results.search_paths[i], min_max_stats_lst->stats_lst[i], to_play_batch[i], values[i], discount_factor);
+            results.nodes[i]->expand(to_play_batch[i], current_latent_state_index, i, rewards[i], policies[i], results.node_pool);
+            cbackpropagate(results.search_paths[i], min_max_stats_lst->stats_lst[results.root_indices[i]], to_play_batch[i], values[i], discount_factor);
         }
     }
 
@@ -596,7 +872,8 @@ namespace tree
     {
         /*
         Overview:
-            Search node path from the roots.
+            Search node path from the active roots. The results only hold the leaves of the active roots, in the order of \
+            the roots, and ``results.root_indices`` maps each of them back to its root.
         Arguments:
             - roots: the roots that search from.
             - pb_c_base: constants c2 in muzero.
@@ -611,7 +888,9 @@ namespace tree
 
         int last_action = -1;
         float parent_q = 0.0;
-        results.search_lens = std::vector<int>();
+        results.search_lens.clear();
+        // the leaves expanded in ``cbatch_backpropagate`` take their children from the node pool of the roots.
+        results.node_pool = &(roots->node_pool);
 
         int players = 0;
         int largest_element = *max_element(virtual_to_play_batch.begin(), virtual_to_play_batch.end()); // 0 or 2
@@ -622,14 +901,19 @@ namespace tree
 
         for (int i = 0; i < results.num; ++i)
         {
+            if (!roots->active[i])
+            {
+                continue;
+            }
+            std::vector<CNode *> &search_path = results.search_paths[results.nodes.size()];
             CNode *node = &(roots->roots[i]);
             int is_root = 1;
             int search_len = 0;
-            results.search_paths[i].push_back(node);
+            search_path.push_back(node);
 
             while (node->expanded())
             {
-                float mean_q = node->compute_mean_q(is_root, parent_q, discount_factor);
+                float mean_q = node->compute_mean_q(is_root, parent_q);
                 is_root = 0;
                 parent_q = mean_q;
 
@@ -647,11 +931,11 @@ namespace tree
                 // next
                 node = node->get_child(action);
                 last_action = action;
-                results.search_paths[i].push_back(node);
+                search_path.push_back(node);
                 search_len += 1;
             }
 
-            CNode *parent = results.search_paths[i][results.search_paths[i].size() - 2];
+            CNode *parent = search_path[search_path.size() - 2];
 
             results.latent_state_index_in_search_path.push_back(parent->current_latent_state_index);
             results.latent_state_index_in_batch.push_back(parent->batch_index);
@@ -660,6 +944,7 @@ namespace tree
             results.search_lens.push_back(search_len);
             results.nodes.push_back(node);
             results.virtual_to_play_batchs.push_back(virtual_to_play_batch[i]);
+            results.root_indices.push_back(i);
         }
     }
 
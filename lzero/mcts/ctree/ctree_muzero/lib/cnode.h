@@ -18,12 +18,17 @@ const int DEBUG_MODE = 0;
 
 namespace tree {
 
+    class CNodePool;
+
     class CNode {
         public:
             int visit_count, to_play, current_latent_state_index, batch_index, best_action;
             float reward, prior, value_sum;
+            int num_visited_children;
+            double children_q_sum;
             std::vector<int> children_index;
-            std::map<int, CNode> children;
+            // the children are indexed by action in a contiguous block of the node pool of the tree, NULL if not expanded.
+            CNode *children;
 
             std::vector<int> legal_actions;
 
@@ -31,9 +36,13 @@ namespace tree {
             CNode(float prior, std::vector<int> &legal_actions);
             ~CNode();
 
-            void expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits);
+            void reset(float prior);
+
+            void expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, CNodePool *node_pool);
             void add_exploration_noise(float exploration_fraction, const std::vector<float> &noises);
-            float compute_mean_q(int isRoot, float parent_q, float discount_factor);
+            float compute_mean_q(int isRoot, float parent_q);
+            float compute_child_q(CNode *child, float discount_factor);
+            void update_child_q(CNode *child, float old_qsa, float discount_factor);
             void print_out();
 
             int expanded();
@@ -45,11 +54,27 @@ namespace tree {
             CNode* get_child(int action);
     };
 
+    class CNodePool{
+        public:
+            int block_size, current_block, num_used;
+            std::vector<std::vector<CNode> > blocks;
+
+            CNodePool();
+            CNodePool(int block_size);
+            ~CNodePool();
+
+            CNode* allocate(int num);
+            void reset();
+    };
+
     class CRoots{
         public:
-            int root_num;
+            int root_num, num_active;
             std::vector<CNode> roots;
             std::vector<std::vector<int> > legal_actions_list;
+            std::vector<int> budgets;
+            std::vector<unsigned char> active;
+            CNodePool node_pool;
 
             CRoots();
             CRoots(int root_num, std::vector<std::vector<int> > &legal_actions_list);
@@ -57,7 +82,10 @@ namespace tree {
 
             void prepare(float root_noise_weight, const std::vector<std::vector<float> > &noises, const std::vector<float> &rewards, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
             void prepare_no_noise(const std::vector<float> &rewards, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
+            void reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size);
             void clear();
+            void set_budgets(const std::vector<int> &budgets);
+            int update_active(float entropy_threshold, int entropy_min_simulations);
             std::vector<std::vector<int> > get_trajectories();
             std::vector<std::vector<int> > get_distributions();
             std::vector<float> get_values();
@@ -68,14 +96,17 @@ namespace tree {
         public:
             int num;
             std::vector<int> latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, search_lens;
-            std::vector<int> virtual_to_play_batchs;
+            std::vector<int> virtual_to_play_batchs, root_indices;
             std::vector<CNode*> nodes;
+            CNodePool *node_pool;
             std::vector<std::vector<CNode*> > search_paths;
 
             CSearchResults();
             CSearchResults(int num);
             ~CSearchResults();
 
+            void reset();
+
     };
 
 
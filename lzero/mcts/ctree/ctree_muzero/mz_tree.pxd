@@ -30,15 +30,20 @@ cdef extern from "lib/cnode.cpp":
 
 
 cdef extern from "lib/cnode.h" namespace "tree":
+    cdef cppclass CNodePool:
+        CNodePool() except +
+
     cdef cppclass CNode:
         CNode() except +
         CNode(float prior, vector[int] &legal_actions) except +
         int visit_count, to_play, current_latent_state_index, batch_index, best_action
+        vector[int] legal_actions
         float value_prefixs, prior, value_sum, parent_value_prefix
 
-        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefixs, vector[float] policy_logits)
+        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefixs, vector[float] policy_logits, CNodePool *node_pool)
         void add_exploration_noise(float exploration_fraction, vector[float] noises)
-        float compute_mean_q(int isRoot, float parent_q, float discount_factor)
+        float compute_mean_q(int isRoot, float parent_q)
+        float compute_child_q(CNode *child, float discount_factor)
 
         int expanded()
         float value()
@@ -49,12 +54,17 @@ cdef extern from "lib/cnode.h" namespace "tree":
     cdef cppclass CRoots:
         CRoots() except +
         CRoots(int root_num, vector[vector[int]] legal_actions_list) except +
-        int root_num
+        int root_num, num_active
         vector[CNode] roots
+        vector[int] budgets
+        vector[unsigned char] active
 
         void prepare(float root_noise_weight, const vector[vector[float]] &noises, const vector[float] &value_prefixs, const vector[vector[float]] &policies, vector[int] to_play_batch)
         void prepare_no_noise(const vector[float] &value_prefixs, const vector[vector[float]] &policies, vector[int] to_play_batch)
+        void reset(int root_num, const unsigned char *legal_actions_mask, int action_space_size)
         void clear()
+        void set_budgets(const vector[int] &budgets)
+        int update_active(float entropy_threshold, int entropy_min_simulations)
         vector[vector[int]] get_trajectories()
         vector[vector[int]] get_distributions()
         vector[float] get_values()
@@ -64,9 +74,11 @@ cdef extern from "lib/cnode.h" namespace "tree":
         CSearchResults(int num) except +
         int num
         vector[int] latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, search_lens
-        vector[int] virtual_to_play_batchs
+        vector[int] virtual_to_play_batchs, root_indices
         vector[CNode*] nodes
 
+        void reset()
+
     cdef void cbackpropagate(vector[CNode*] &search_path, CMinMaxStats &min_max_stats, int to_play, float value, float discount_factor)
     void cbatch_backpropagate(int current_latent_state_index, float discount_factor, vector[float] value_prefixs, vector[float] values, vector[vector[float]] policies,
                                CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, vector[int] &to_play_batch)
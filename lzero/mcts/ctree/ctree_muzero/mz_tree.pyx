@@ -2,6 +2,9 @@
 # cython:language_level=3
 from libcpp.vector cimport vector
 
+include "../common_lib/legal_actions.pxi"
+include "../common_lib/scalar_transform.pxi"
+
 cdef class MinMaxStatsList:
     cdef CMinMaxStatsList *cmin_max_stats_lst
 
@@ -23,13 +26,21 @@ cdef class ResultsWrapper:
     def get_search_len(self):
         return self.cresults.search_lens
 
+    def reset(self):
+        # Clear the results of the last simulation, keeping the allocated buffers for the next one.
+        self.cresults.reset()
+
 cdef class Roots:
     cdef int root_num
     cdef CRoots *roots
 
-    def __cinit__(self, int root_num, vector[vector[int]] legal_actions_list):
+    def __cinit__(self, int root_num, legal_actions_list, int bitmask_action_space_size=0):
+        # ``legal_actions_list`` is a list of the legal actions of each root, or a (root_num, action_space_size)
+        # numpy mask, or a mask packed by ``np.packbits`` if ``bitmask_action_space_size`` > 0, see ``to_legal_actions_mask``.
+        cdef vector[vector[int]] clegal_actions_list = to_legal_actions_list(root_num, legal_actions_list,
+                                                                              bitmask_action_space_size)
         self.root_num = root_num
-        self.roots = new CRoots(root_num, legal_actions_list)
+        self.roots = new CRoots(root_num, clegal_actions_list)
 
     def prepare(self, float root_noise_weight, list noises, list value_prefix_pool, list policy_logits_pool,
                 vector[int] & to_play_batch):
@@ -47,6 +58,26 @@ cdef class Roots:
     def get_values(self):
         return self.roots[0].get_values()
 
+    def reset(self, int root_num, legal_actions_mask):
+        # Reinitialize the roots in place from a (root_num, action_space_size) legal action mask, normalized by
+        # ``to_legal_actions_mask``.
+        cdef const unsigned char[:, ::1] mask = to_legal_actions_mask(root_num, legal_actions_mask, 0)
+        self.root_num = root_num
+        if root_num == 0 or mask.shape[1] == 0:
+            self.roots[0].reset(root_num, NULL, 0)
+        else:
+            self.roots[0].reset(root_num, &mask[0, 0], mask.shape[1])
+
+    def set_budgets(self, vector[int] budgets):
+        # Set the maximum number of simulations of each root and reactivate the roots with a positive budget.
+        if budgets.size() != self.root_num:
+            raise ValueError("the length of budgets must be equal to root_num")
+        self.roots[0].set_budgets(budgets)
+
+    def update_active(self, float entropy_threshold=0., int entropy_min_simulations=0):
+        # Retire the roots whose search can stop early, and return the number of the roots still active.
+        return self.roots[0].update_active(entropy_threshold, entropy_min_simulations)
+
     def clear(self):
         self.roots[0].clear()
 
@@ -57,8 +88,19 @@ cdef class Roots:
     def num(self):
         return self.root_num
 
+    @property
+    def num_active(self):
+        return self.roots[0].num_active
+
+    @property
+    def active(self):
+        # The uint8 mask of the roots still traversed by ``batch_traverse``.
+        return np.asarray(self.roots[0].active, dtype=np.uint8)
+
 cdef class Node:
     cdef CNode cnode
+    # the children of the node are taken from this pool.
+    cdef CNodePool node_pool
 
     def __cinit__(self):
         pass
@@ -69,13 +111,22 @@ cdef class Node:
     def expand(self, int to_play, int current_latent_state_index, int batch_index, float value_prefix,
                list policy_logits):
         cdef vector[float] cpolicy = policy_logits
-        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy)
+        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy, &self.node_pool)
 
-def batch_backpropagate(int current_latent_state_index, float discount_factor, list value_prefixs, list values, list policies,
-                         MinMaxStatsList min_max_stats_lst, ResultsWrapper results, list to_play_batch):
+def batch_backpropagate(int current_latent_state_index, float discount_factor, value_prefixs, values, list policies,
+                         MinMaxStatsList min_max_stats_lst, ResultsWrapper results, list to_play_batch,
+                         int support_size=0, float epsilon=0.001):
+    # If ``support_size`` > 0, ``value_prefixs`` and ``values`` are the raw categorical logits of shape
+    # (batch_size, 2 * support_size + 1), decoded to scalars in C++ instead of by ``InverseScalarTransform``.
     cdef int i
-    cdef vector[float] cvalue_prefixs = value_prefixs
-    cdef vector[float] cvalues = values
+    cdef vector[float] cvalue_prefixs
+    cdef vector[float] cvalues
+    if support_size > 0:
+        cvalue_prefixs = decode_categorical(value_prefixs, support_size, epsilon)
+        cvalues = decode_categorical(values, support_size, epsilon)
+    else:
+        cvalue_prefixs = value_prefixs
+        cvalues = values
     cdef vector[vector[float]] cpolicies = policies
 
     cbatch_backpropagate(current_latent_state_index, discount_factor, cvalue_prefixs, cvalues, cpolicies,
@@ -87,3 +138,20 @@ def batch_traverse(Roots roots, int pb_c_base, float pb_c_init, float discount_f
                     virtual_to_play_batch)
 
     return results.cresults.latent_state_index_in_search_path, results.cresults.latent_state_index_in_batch, results.cresults.last_actions, results.cresults.virtual_to_play_batchs
+
+def pcompute_mean_q(Roots roots, int index, float discount_factor):
+    # The mean q value of a root from the running statistics of its visited children, and from a scan of their q values.
+    cdef CNode *root
+    cdef CNode *child
+    cdef int a
+    cdef float q_sum = 0.0
+    cdef int num_visited_children = 0
+    if index < 0 or index >= roots.root_num:
+        raise IndexError("index out of range")
+    root = &(roots.roots[0].roots[index])
+    for a in root.legal_actions:
+        child = root.get_child(a)
+        if child.visit_count > 0:
+            q_sum += root.compute_child_q(child, discount_factor)
+            num_visited_children += 1
+    return root.compute_mean_q(1, 0.0), q_sum / num_visited_children if num_visited_children > 0 else 0.0
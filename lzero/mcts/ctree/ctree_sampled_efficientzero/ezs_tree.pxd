@@ -74,6 +74,7 @@ cdef extern from "lib/cnode.h" namespace "tree":
         vector[vector[int]] get_distributions()
         vector[vector[vector[float]]] get_sampled_actions()
         vector[float] get_values()
+        void get_root_outputs(float *sampled_actions, int *distributions, float *values, unsigned char *valid_masks, int max_num_sampled_actions, int action_dim)
 
     cdef cppclass CSearchResults:
         CSearchResults() except +
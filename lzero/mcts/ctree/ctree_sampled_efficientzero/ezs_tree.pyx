@@ -2,6 +2,8 @@
 # cython:language_level=3
 from libcpp.vector cimport vector
 
+include "../common_lib/legal_actions.pxi"
+
 cdef class MinMaxStatsList:
     cdef CMinMaxStatsList *cmin_max_stats_lst
 
@@ -45,13 +47,25 @@ cdef class Roots:
     def __cinit__(self):
         pass
 
-    def __cinit__(self, int root_num, list legal_actions_list, int action_space_size, int num_of_sampled_actions,
-                  bool continuous_action_space):
+    def __cinit__(self, int root_num, legal_actions_list, int action_space_size, int num_of_sampled_actions,
+                  bool continuous_action_space, int bitmask_action_space_size=0):
         #def __cinit__(self, int root_num, list legal_actions_list, int action_space_size, int num_of_sampled_actions):
+        # ``legal_actions_list`` is a list of the legal actions of each root, or a (root_num, action_space_size)
+        # numpy mask, or a mask packed by ``np.packbits`` if ``bitmask_action_space_size`` > 0, see ``to_legal_actions_mask``.
+        cdef vector[vector[float]] clegal_actions_list
+        cdef vector[vector[int]] cmask_legal_actions_list
+        cdef int i
+        if isinstance(legal_actions_list, np.ndarray):
+            cmask_legal_actions_list = to_legal_actions_list(root_num, legal_actions_list, bitmask_action_space_size)
+            clegal_actions_list.resize(root_num)
+            for i in range(root_num):
+                clegal_actions_list[i].assign(cmask_legal_actions_list[i].begin(), cmask_legal_actions_list[i].end())
+        else:
+            clegal_actions_list = legal_actions_list
         self.root_num = root_num
         self.action_space_size = action_space_size
         self.num_of_sampled_actions = num_of_sampled_actions
-        self.roots = new CRoots(root_num, legal_actions_list, action_space_size, num_of_sampled_actions,
+        self.roots = new CRoots(root_num, clegal_actions_list, action_space_size, num_of_sampled_actions,
                                 continuous_action_space)
 
     def prepare(self, float root_noise_weight, list noises, list value_prefix_pool, list policy_logits_pool,
@@ -73,6 +87,20 @@ cdef class Roots:
     def get_values(self):
         return self.roots[0].get_values()
 
+    def get_root_outputs(self, float[:, :, ::1] sampled_actions, int[:, ::1] distributions, float[::1] values,
+                         unsigned char[:, ::1] valid_masks):
+        # Fill the caller-owned arrays of shape (B, K, D), (B, K), (B, ) and (B, K) in place.
+        cdef int num_of_sampled_actions = sampled_actions.shape[1]
+        if sampled_actions.shape[0] != self.root_num or distributions.shape[0] != self.root_num or \
+                values.shape[0] != self.root_num or valid_masks.shape[0] != self.root_num:
+            raise ValueError("the first dimension of the output arrays must be equal to root_num")
+        if distributions.shape[1] != num_of_sampled_actions or valid_masks.shape[1] != num_of_sampled_actions:
+            raise ValueError("sampled_actions, distributions and valid_masks must have the same number of sampled actions")
+        if self.root_num == 0 or num_of_sampled_actions == 0 or sampled_actions.shape[2] == 0:
+            return
+        self.roots[0].get_root_outputs(&sampled_actions[0, 0, 0], &distributions[0, 0], &values[0], &valid_masks[0, 0],
+                                       num_of_sampled_actions, sampled_actions.shape[2])
+
     def clear(self):
         self.roots[0].clear()
 
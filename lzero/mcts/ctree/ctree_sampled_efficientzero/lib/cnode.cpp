@@ -800,6 +800,62 @@ namespace tree
         return values;
     }
 
+    void CRoots::get_root_outputs(float *sampled_actions, int *distributions, float *values, unsigned char *valid_masks, int max_num_sampled_actions, int action_dim)
+    {
+        /*
+        Overview:
+            Write the sampled actions, visit counts, values and valid masks of all roots into caller-owned contiguous buffers \
+            in a single pass, so that no nested vectors are built and converted to python lists.
+            Roots with fewer than ``max_num_sampled_actions`` sampled actions are padded with their last sampled action \
+            and zero visit counts, and the padded slots are marked as invalid in ``valid_masks``.
+        Arguments:
+            - sampled_actions: the buffer of sampled actions, shape (root_num, max_num_sampled_actions, action_dim).
+            - distributions: the buffer of visit counts, shape (root_num, max_num_sampled_actions).
+            - values: the buffer of root values, shape (root_num, ).
+            - valid_masks: the buffer of valid masks of the sampled actions, shape (root_num, max_num_sampled_actions).
+            - max_num_sampled_actions: the number of sampled action slots of each root, i.e. K in the Sampled MuZero papers.
+            - action_dim: the dimension of each sampled action.
+        */
+        for (int i = 0; i < this->root_num; ++i)
+        {
+            CNode *root = &(this->roots[i]);
+            int num_of_actions = std::min((int)root->legal_actions.size(), max_num_sampled_actions);
+            int expanded = root->expanded();
+
+            float *root_actions = sampled_actions + (size_t)i * max_num_sampled_actions * action_dim;
+            int *root_distribution = distributions + (size_t)i * max_num_sampled_actions;
+            unsigned char *root_mask = valid_masks + (size_t)i * max_num_sampled_actions;
+
+            values[i] = root->value();
+
+            for (int k = 0; k < max_num_sampled_actions; ++k)
+            {
+                float *action_slot = root_actions + (size_t)k * action_dim;
+                if (k < num_of_actions)
+                {
+                    CAction &action = root->legal_actions[k];
+                    int dim = std::min((int)action.value.size(), action_dim);
+                    for (int d = 0; d < action_dim; ++d)
+                    {
+                        action_slot[d] = d < dim ? action.value[d] : 0;
+                    }
+                    root_distribution[k] = expanded ? root->get_child(action)->visit_count : 0;
+                    root_mask[k] = 1;
+                }
+                else
+                {
+                    // Use the last sampled action to pad the invalid slots.
+                    for (int d = 0; d < action_dim; ++d)
+                    {
+                        action_slot[d] = num_of_actions > 0 ? root_actions[(size_t)(num_of_actions - 1) * action_dim + d] : 0;
+                    }
+                    root_distribution[k] = 0;
+                    root_mask[k] = 0;
+                }
+            }
+        }
+    }
+
     //*********************************************************
     //
     void update_tree_q(CNode *root, tools::CMinMaxStats &min_max_stats, float discount_factor, int players)
@@ -93,6 +93,7 @@ namespace tree
         std::vector<std::vector<int> > get_distributions();
 
         std::vector<float> get_values();
+        void get_root_outputs(float *sampled_actions, int *distributions, float *values, unsigned char *valid_masks, int max_num_sampled_actions, int action_dim);
     };
 
     class CSearchResults
@@ -30,6 +30,10 @@ namespace tree
             Initialization of CSearchResults, the default result number is set to 0.
         */
         this->num = 0;
+        this->num_chance_leaves = 0;
+        this->node_pool = NULL;
+        this->chance_top_k = 0;
+        this->chance_prob_mass = 1.0;
     }
 
     CSearchResults::CSearchResults(int num)
@@ -39,6 +43,10 @@ namespace tree
             Initialization of CSearchResults with result number.
         */
         this->num = num;
+        this->num_chance_leaves = 0;
+        this->node_pool = NULL;
+        this->chance_top_k = 0;
+        this->chance_prob_mass = 1.0;
         for (int i = 0; i < num; ++i)
         {
             this->search_paths.push_back(std::vector<CNode *>());
@@ -60,11 +68,15 @@ namespace tree
 
         this->visit_count = 0;
         this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
         this->best_action = -1;
         this->to_play = 0;
         this->reward = 0.0;
         this->is_chance = false;
         this->chance_space_size= 2;
+        this->num_outcomes = 0;
+        this->outcomes = NULL;
 
     }
 
@@ -83,17 +95,21 @@ namespace tree
 
         this->visit_count = 0;
         this->value_sum = 0;
+        this->num_visited_children = 0;
+        this->children_q_sum = 0.0;
         this->best_action = -1;
         this->to_play = 0;
         this->current_latent_state_index = -1;
         this->batch_index = -1;
         this->is_chance = is_chance;
         this->chance_space_size = chance_space_size;
+        this->num_outcomes = 0;
+        this->outcomes = NULL;
     }
 
     CNode::~CNode() {}
 
-    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, bool child_is_chance)
+    void CNode::expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, bool child_is_chance, CNodePool *node_pool, int chance_top_k, float chance_prob_mass)
     {
         /*
         Overview:
@@ -104,6 +120,11 @@ namespace tree
             - batch_index: The index of latent state of the leaf node in the search path of the current node.
             - reward: the reward of the current node.
             - policy_logits: the logit of the child nodes.
+            - node_pool: the node pool of the tree, required by a chance node, which takes one outcome record per \
+                chance code from the pool instead of creating child nodes.
+            - chance_top_k: if > 0, a chance node can only sample its chance_top_k most probable outcomes at first.
+            - chance_prob_mass: a chance node can only sample the smallest set of its most probable outcomes covering \
+                this probability mass at first. The other outcomes are added later by ``widen_outcomes``.
         */
         this->to_play = to_play;
         this->current_latent_state_index = current_latent_state_index;
@@ -122,6 +143,53 @@ namespace tree
         }
 
         int action_num = policy_logits.size();
+        if (this->is_chance)
+        {
+            // fixed-arity chance node: the softmax over all chance codes is computed without branches.
+            assert(node_pool != NULL);
+            this->chance_space_size = action_num;
+            this->outcomes = node_pool->allocate_outcomes(action_num);
+            float outcome_max = FLOAT_MIN;
+            for (int i = 0; i < action_num; ++i)
+            {
+                outcome_max = std::max(outcome_max, policy_logits[i]);
+            }
+            float outcome_sum = 0.0;
+            for (int i = 0; i < action_num; ++i)
+            {
+                this->outcomes[i].code = i;
+                this->outcomes[i].prior = exp(policy_logits[i] - outcome_max);
+                this->outcomes[i].node = NULL;
+                outcome_sum += this->outcomes[i].prior;
+            }
+            for (int i = 0; i < action_num; ++i)
+            {
+                this->outcomes[i].prior /= outcome_sum;
+            }
+            this->num_outcomes = action_num;
+
+            bool is_truncated = (chance_top_k > 0 && chance_top_k < action_num) || chance_prob_mass < 1.0;
+            if (!is_truncated)
+            {
+                return;
+            }
+            // truncated chance node: the records are sorted by prior, and only the most probable outcomes can be sampled.
+            std::stable_sort(this->outcomes, this->outcomes + action_num, [](const COutcome &a, const COutcome &b) { return a.prior > b.prior; });
+            int num_outcomes = 0;
+            float covered_prob_mass = 0.0;
+            while (num_outcomes < action_num && covered_prob_mass < chance_prob_mass)
+            {
+                covered_prob_mass += this->outcomes[num_outcomes].prior;
+                num_outcomes += 1;
+            }
+            if (chance_top_k > 0)
+            {
+                num_outcomes = std::min(num_outcomes, chance_top_k);
+            }
+            this->num_outcomes = std::max(num_outcomes, 1);
+            return;
+        }
+
         if (this->legal_actions.size() == 0)
         {
             for (int i = 0; i < action_num; ++i)
@@ -172,6 +240,24 @@ namespace tree
         #endif
     }
 
+    void CNode::widen_outcomes()
+    {
+        /*
+        Overview:
+            Let a truncated chance node sample its next most probable outcome once the prior of this outcome becomes \
+            relevant, i.e. once it is expected to be sampled at least once in the visits of the node. \
+            The records are sorted by prior, so the outcome is added by extending the prefix of the records that can be sampled.
+        */
+        if (this->num_outcomes >= this->chance_space_size)
+        {
+            return;
+        }
+        if (this->visit_count * this->outcomes[this->num_outcomes].prior >= 1.0)
+        {
+            this->num_outcomes += 1;
+        }
+    }
+
     void CNode::add_exploration_noise(float exploration_fraction, const std::vector<float> &noises)
     {
         /*
@@ -192,29 +278,18 @@ namespace tree
         }
     }
 
-    float CNode::compute_mean_q(int isRoot, float parent_q, float discount_factor)
+    float CNode::compute_mean_q(int isRoot, float parent_q)
     {
         /*
         Overview:
-            Compute the mean q value of the current node.
+            Compute the mean q value of the current node in O(1) from the running statistics of its visited children.
         Arguments:
             - isRoot: whether the current node is a root node.
             - parent_q: the q value of the parent node.
-            - discount_factor: the discount_factor of reward.
         */
-        float total_unsigned_q = 0.0;
-        int total_visits = 0;
-        for (auto a : this->legal_actions)
-        {
-            CNode *child = this->get_child(a);
-            if (child->visit_count > 0)
-            {
-                float true_reward = child->reward;
-                float qsa = true_reward + discount_factor * child->value();
-                total_unsigned_q += qsa;
-                total_visits += 1;
-            }
-        }
+        // The q values of the visited children are accumulated incrementally in cbackpropagate.
+        float total_unsigned_q = (float)this->children_q_sum;
+        int total_visits = this->num_visited_children;
 
         float mean_q = 0.0;
         if (isRoot && total_visits > 0)
@@ -228,6 +303,41 @@ namespace tree
         return mean_q;
     }
 
+    float CNode::compute_child_q(CNode *child, float discount_factor)
+    {
+        /*
+        Overview:
+            Compute the q value of a child node from the perspective of the current node.
+        Arguments:
+            - child: the child node.
+            - discount_factor: the discount_factor of reward.
+        */
+        float true_reward = child->reward;
+        return true_reward + discount_factor * child->value();
+    }
+
+    void CNode::update_child_q(CNode *child, float old_qsa, float discount_factor)
+    {
+        /*
+        Overview:
+            Update the running sum and count of the visited children's q values after the statistics of a child changed.
+        Arguments:
+            - child: the child node whose value sum and visit count have just been updated.
+            - old_qsa: the q value of the child before the update, ignored if this is its first visit.
+            - discount_factor: the discount_factor of reward.
+        */
+        float new_qsa = this->compute_child_q(child, discount_factor);
+        if (child->visit_count == 1)
+        {
+            this->num_visited_children += 1;
+            this->children_q_sum += new_qsa;
+        }
+        else
+        {
+            this->children_q_sum += new_qsa - old_qsa;
+        }
+    }
+
     void CNode::print_out()
     {
         return;
@@ -239,7 +349,7 @@ namespace tree
         Overview:
             Return whether the current node is expanded.
         */
-        return this->children.size() > 0;
+        return this->outcomes != NULL || this->children.size() > 0;
     }
 
     float CNode::value()
@@ -306,13 +416,175 @@ namespace tree
     {
         /*
         Overview:
-            Get the child node corresponding to the input action.
+            Get the child node corresponding to the input action. The child of a chance node is the decision node \
+            of the outcome, which is NULL if the outcome has never been sampled or can not be sampled.
         Arguments:
-            - action: the action to get child.
+            - action: the action to get child, i.e. the chance code for a chance node.
         */
+        if (this->outcomes != NULL)
+        {
+            COutcome *outcome = this->get_outcome(action);
+            return outcome == NULL ? NULL : outcome->node;
+        }
         return &(this->children[action]);
     }
 
+    COutcome *CNode::get_outcome(int code)
+    {
+        /*
+        Overview:
+            Get the record of the chance code among the outcomes that can be sampled, NULL if there is none.
+        Arguments:
+            - code: the chance code.
+        */
+        // the records of a chance node that is not truncated are in the order of the codes.
+        if (code >= 0 && code < this->num_outcomes && this->outcomes[code].code == code)
+        {
+            return &(this->outcomes[code]);
+        }
+        for (int i = 0; i < this->num_outcomes; ++i)
+        {
+            if (this->outcomes[i].code == code)
+            {
+                return &(this->outcomes[i]);
+            }
+        }
+        return NULL;
+    }
+
+    CNode *CNode::get_outcome_node(int code, CNodePool *node_pool)
+    {
+        /*
+        Overview:
+            Get the decision node of a sampled outcome of the chance node, it is taken from the node pool at the \
+            first time the outcome is sampled.
+        Arguments:
+            - code: the sampled chance code.
+            - node_pool: the node pool of the tree.
+        */
+        COutcome *outcome = this->get_outcome(code);
+        assert(outcome != NULL);
+        if (outcome->node == NULL)
+        {
+            std::vector<int> tmp_empty;
+            outcome->node = node_pool->allocate(1);
+            *(outcome->node) = CNode(outcome->prior, tmp_empty, false, this->chance_space_size);
+        }
+        return outcome->node;
+    }
+
+    std::vector<float> CNode::get_outcome_priors()
+    {
+        /*
+        Overview:
+            Get the sampling distribution of an expanded chance node, i.e. the priors of the outcomes that can be sampled \
+            renormalized among them.
+        Returns:
+            - priors: the prior of each chance code, 0 for the codes that can not be sampled, empty if the node is not \
+                an expanded chance node.
+        */
+        std::vector<float> priors;
+        if (this->outcomes == NULL)
+        {
+            return priors;
+        }
+        priors.assign(this->chance_space_size, 0.0);
+        float prior_sum = 0.0;
+        for (int i = 0; i < this->num_outcomes; ++i)
+        {
+            prior_sum += this->outcomes[i].prior;
+        }
+        for (int i = 0; i < this->num_outcomes; ++i)
+        {
+            priors[this->outcomes[i].code] = this->outcomes[i].prior / prior_sum;
+        }
+        return priors;
+    }
+
+    //*********************************************************
+
+    CNodePool::CNodePool()
+    {
+        /*
+        Overview:
+            The initialization of CNodePool.
+        */
+        this->block_size = 4096;
+        this->num_used = 0;
+        this->num_used_outcomes = 0;
+    }
+
+    CNodePool::CNodePool(int block_size)
+    {
+        /*
+        Overview:
+            The initialization of CNodePool with the number of nodes in each block.
+        Arguments:
+            - block_size: the number of nodes in each block.
+        */
+        this->block_size = block_size;
+        this->num_used = 0;
+        this->num_used_outcomes = 0;
+    }
+
+    CNodePool::~CNodePool() {}
+
+    CNode* CNodePool::allocate(int num)
+    {
+        /*
+        Overview:
+            Allocate contiguous nodes from the pool. The nodes are never moved, \
+            so the pointers stay valid until the pool is cleared. The blocks double in size up to block_size, \
+            so that a small tree does not construct a whole block of nodes.
+        Arguments:
+            - num: the number of contiguous nodes to allocate.
+        Returns:
+            - nodes: the pointer to the first allocated node.
+        */
+        if (this->blocks.empty() || this->num_used + num > this->blocks.back().size())
+        {
+            int size = this->blocks.empty() ? 64 : 2 * int(this->blocks.back().size());
+            this->blocks.push_back(std::vector<CNode>(std::max(std::min(size, this->block_size), num)));
+            this->num_used = 0;
+        }
+        CNode *nodes = &(this->blocks.back()[this->num_used]);
+        this->num_used += num;
+        return nodes;
+    }
+
+    COutcome* CNodePool::allocate_outcomes(int num)
+    {
+        /*
+        Overview:
+            Allocate a contiguous outcome table from the pool.
+        Arguments:
+            - num: the number of contiguous outcomes to allocate.
+        Returns:
+            - outcomes: the pointer to the first allocated outcome.
+        */
+        if (this->outcome_blocks.empty() || this->num_used_outcomes + num > this->outcome_blocks.back().size())
+        {
+            int size = this->outcome_blocks.empty() ? 64 : 2 * int(this->outcome_blocks.back().size());
+            this->outcome_blocks.push_back(std::vector<COutcome>(std::max(std::min(size, this->block_size), num)));
+            this->num_used_outcomes = 0;
+        }
+        COutcome *outcomes = &(this->outcome_blocks.back()[this->num_used_outcomes]);
+        this->num_used_outcomes += num;
+        return outcomes;
+    }
+
+    void CNodePool::clear()
+    {
+        /*
+        Overview:
+            Release all the nodes of the pool.
+        */
+        this->blocks.clear();
+        this->num_used = 0;
+        this->outcome_blocks.clear();
+        this->num_used_outcomes = 0;
+    }
+
     //*********************************************************
 
     CRoots::CRoots()
@@ -322,6 +594,9 @@ namespace tree
             The initialization of CRoots.
         */
         this->root_num = 0;
+        this->chance_space_size = 2;
+        this->chance_top_k = 0;
+        this->chance_prob_mass = 1.0;
     }
 
     CRoots::CRoots(int root_num, std::vector<std::vector<int> > &legal_actions_list, int chance_space_size=2)
@@ -335,6 +610,9 @@ namespace tree
         */
         this->root_num = root_num;
         this->legal_actions_list = legal_actions_list;
+        this->chance_space_size = chance_space_size;
+        this->chance_top_k = 0;
+        this->chance_prob_mass = 1.0;
 
         for (int i = 0; i < root_num; ++i)
         {
@@ -392,6 +670,21 @@ namespace tree
             Clear the roots vector.
         */
         this->roots.clear();
+        this->node_pool.clear();
+    }
+
+    void CRoots::set_chance_truncation(int chance_top_k, float chance_prob_mass)
+    {
+        /*
+        Overview:
+            Set the truncation of the outcomes of the chance nodes expanded in the search.
+        Arguments:
+            - chance_top_k: if > 0, a chance node can only sample its chance_top_k most probable outcomes at first.
+            - chance_prob_mass: a chance node can only sample the smallest set of its most probable outcomes covering \
+                this probability mass at first, 1.0 means no truncation.
+        */
+        this->chance_top_k = chance_top_k;
+        this->chance_prob_mass = chance_prob_mass;
     }
 
     std::vector<std::vector<int> > CRoots::get_trajectories()
@@ -444,6 +737,18 @@ namespace tree
         return values;
     }
 
+    std::vector<float> CRoots::get_outcome_priors(int index, int action)
+    {
+        /*
+        Overview:
+            Return the sampling distribution of the chance node reached by the action from the root.
+        Arguments:
+            - index: the index of the root.
+            - action: the action of the root.
+        */
+        return this->roots[index].get_child(action)->get_outcome_priors();
+    }
+
     //*********************************************************
     //
     void update_tree_q(CNode *root, tools::CMinMaxStats &min_max_stats, float discount_factor, int players)
@@ -482,6 +787,17 @@ namespace tree
                 min_max_stats.update(qsa);
             }
 
+            if (node->outcomes != NULL)
+            {
+                for (int i = 0; i < node->num_outcomes; ++i)
+                {
+                    CNode *child = node->outcomes[i].node;
+                    if (child != NULL && child->expanded())
+                    {
+                        node_stack.push(child);
+                    }
+                }
+            }
             for (auto a : node->legal_actions)
             {
                 CNode *child = node->get_child(a);
@@ -514,8 +830,14 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 node->value_sum += bootstrap_value;
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 float true_reward = node->reward;
 
@@ -534,11 +856,17 @@ namespace tree
             for (int i = path_len - 1; i >= 0; --i)
             {
                 CNode *node = search_path[i];
+                CNode *parent = (i >= 1) ? search_path[i - 1] : NULL;
+                float old_qsa = (parent != NULL && node->visit_count > 0) ? parent->compute_child_q(node, discount_factor) : 0.0;
                 if (node->to_play == to_play)
                     node->value_sum += bootstrap_value;
                 else
                     node->value_sum += -bootstrap_value;
                 node->visit_count += 1;
+                if (parent != NULL)
+                {
+                    parent->update_child_q(node, old_qsa, discount_factor);
+                }
 
                 // NOTE: in self-play-mode, value_prefix is not calculated according to the perspective of current player of node,
                 // but treated as 1 player, just for obtaining the true reward in the perspective of current player of node.
@@ -556,39 +884,44 @@ namespace tree
         }
     }
 
-    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, const std::vector<float> &value_prefixs, const std::vector<float> &values, const std::vector<std::vector<float> > &policies, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &to_play_batch, std::vector<bool> &is_chance_list, std::vector<int> &leaf_idx_list)
+    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, const float *value_prefixs, const float *values, const float *chance_policies, int chance_space_size, const float *decision_policies, int action_space_size, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &to_play_batch)
     {
         /*
         Overview:
-            Expand the nodes along the search path and update the infos.
+            Expand the leaf nodes of both groups and update the infos along the search paths in one pass. \
+            The leaves are in the grouped order of ``cbatch_traverse``, i.e. the chance leaves come first, \
+            so the i-th leaf is expanded with the batch index i and its latent state is the i-th one of the inference outputs.
         Arguments:
             - current_latent_state_index: The index of latent state of the leaf node in the search path.
             - discount_factor: the discount factor of reward.
-            - value_prefixs: the value prefixs of nodes along the search path.
-            - values: the values to propagate along the search path.
-            - policies: the policy logits of nodes along the search path.
+            - value_prefixs: the value prefixs of the leaf nodes, of shape (num, ).
+            - values: the values to propagate along the search path, of shape (num, ).
+            - chance_policies: the policy logits of the chance leaf nodes, of shape (num_chance_leaves, chance_space_size).
+            - chance_space_size: the size of the chance space.
+            - decision_policies: the policy logits of the decision leaf nodes, of shape (num - num_chance_leaves, action_space_size).
+            - action_space_size: the size of the action space.
             - min_max_stats: a tool used to min-max normalize the q value.
             - results: the search results.
-            - to_play_batch: the batch of which player is playing on this node.
+            - to_play_batch: the batch of which player is playing on the leaf nodes, in the grouped order.
         */
-
-        if (leaf_idx_list.empty()) {
-            leaf_idx_list.resize(results.num);
-            for (int i = 0; i < results.num; ++i) {
-                leaf_idx_list[i] = i;
-            }
-        }
-
-        for (auto leaf_order = 0; leaf_order < leaf_idx_list.size(); ++leaf_order) {
-            int i = leaf_idx_list[leaf_order];
-        }
-        for (int leaf_order = 0; leaf_order < leaf_idx_list.size(); ++leaf_order)
+        std::vector<float> policy_logits;
+        for (int leaf_order = 0; leaf_order < results.leaf_order.size(); ++leaf_order)
         {
-            int i = leaf_idx_list[leaf_order];
-            results.nodes[i]->expand(to_play_batch[i], current_latent_state_index, i, value_prefixs[leaf_order], policies[leaf_order], is_chance_list[i]);
-            cbackpropagate(results.search_paths[i], min_max_stats_lst->stats_lst[i], to_play_batch[i], values[leaf_order], discount_factor);
+            int i = results.leaf_order[leaf_order];
+            bool is_chance = leaf_order < results.num_chance_leaves;
+            if (is_chance)
+            {
+                const float *policy = chance_policies + (size_t)leaf_order * chance_space_size;
+                policy_logits.assign(policy, policy + chance_space_size);
+            }
+            else
+            {
+                const float *policy = decision_policies + (size_t)(leaf_order - results.num_chance_leaves) * action_space_size;
+                policy_logits.assign(policy, policy + action_space_size);
+            }
+            results.nodes[i]->expand(to_play_batch[leaf_order], current_latent_state_index, leaf_order, value_prefixs[leaf_order], policy_logits, is_chance, results.node_pool, results.chance_top_k, results.chance_prob_mass);
+            cbackpropagate(results.search_paths[i], min_max_stats_lst->stats_lst[i], to_play_batch[leaf_order], values[leaf_order], discount_factor);
         }
-
     }
 
     int cselect_child(CNode *root, tools::CMinMaxStats &min_max_stats, int pb_c_base, float pb_c_init, float discount_factor, float mean_q, int players)
@@ -608,25 +941,23 @@ namespace tree
             - action: the action to select.
         */
         if (root->is_chance) {
-                // std::cout << "root->is_chance: True " << std::endl;
-
-                // If the node is a chance node, we sample from the prior outcome distribution.
-                std::vector<int> outcomes;
-                std::vector<double> probs;
-
-                for (const auto& kv : root->children) {
-                    outcomes.push_back(kv.first);
-                    probs.push_back(kv.second.prior); // Assuming 'prior' is a member variable of Node
-                }
-
-                std::random_device rd;
-                std::mt19937 gen(rd());
-                std::discrete_distribution<> dist(probs.begin(), probs.end());
-
-                int outcome = outcomes[dist(gen)];
-                // std::cout << "Outcome: " << outcome << std::endl;
-
-            return outcome;
+            // If the node is a chance node, we sample from the prior outcome distribution,
+            // by inverse transform sampling over the contiguous outcome records without allocation.
+            static thread_local std::mt19937 gen((std::random_device())());
+            float prior_sum = 0.0;
+            for (int i = 0; i < root->num_outcomes; ++i)
+            {
+                prior_sum += root->outcomes[i].prior;
+            }
+            float threshold = std::uniform_real_distribution<float>(0.0, prior_sum)(gen);
+            float cumulative_prior = 0.0;
+            int outcome = 0;
+            for (int i = 0; i < root->num_outcomes - 1; ++i)
+            {
+                cumulative_prior += root->outcomes[i].prior;
+                outcome += (cumulative_prior <= threshold);
+            }
+            return root->outcomes[outcome].code;
         }
 
         // std::cout << "root->is_chance: False " << std::endl;
@@ -728,6 +1059,10 @@ namespace tree
         int last_action = -1;
         float parent_q = 0.0;
         results.search_lens = std::vector<int>();
+        // the chance nodes expanded in ``cbatch_backpropagate`` store their outcomes in the node pool of the roots.
+        results.node_pool = &(roots->node_pool);
+        results.chance_top_k = roots->chance_top_k;
+        results.chance_prob_mass = roots->chance_prob_mass;
 
         int players = 0;
         int largest_element = *max_element(virtual_to_play_batch.begin(), virtual_to_play_batch.end()); // 0 or 2
@@ -748,7 +1083,11 @@ namespace tree
 
             while (node->expanded())
             {
-                float mean_q = node->compute_mean_q(is_root, parent_q, discount_factor);
+                if (node->is_chance)
+                {
+                    node->widen_outcomes();
+                }
+                float mean_q = node->compute_mean_q(is_root, parent_q);
                 is_root = 0;
                 parent_q = mean_q;
                 // std::cout << "node->is_chance: " <<node->is_chance<< std::endl;
@@ -764,8 +1103,8 @@ namespace tree
                 }
 
                 node->best_action = action;
-                // next
-                node = node->get_child(action);
+                // next, the decision node of a sampled outcome is taken from the node pool at its first sample.
+                node = node->is_chance ? node->get_outcome_node(action, &(roots->node_pool)) : node->get_child(action);
                 last_action = action;
                 results.search_paths[i].push_back(node);
                 search_len += 1;
@@ -783,6 +1122,39 @@ namespace tree
             results.virtual_to_play_batchs.push_back(virtual_to_play_batch[i]);
 
         }
+
+        // group the leaves, the chance leaves come first and the decision leaves follow,
+        // so that each group can be inferred with a contiguous slice of the batch.
+        results.leaf_order.clear();
+        for (int i = 0; i < results.num; ++i)
+        {
+            if (results.nodes[i]->is_chance)
+            {
+                results.leaf_order.push_back(i);
+            }
+        }
+        results.num_chance_leaves = results.leaf_order.size();
+        for (int i = 0; i < results.num; ++i)
+        {
+            if (!results.nodes[i]->is_chance)
+            {
+                results.leaf_order.push_back(i);
+            }
+        }
+        std::vector<int> grouped(results.num);
+        std::vector<int> *per_leaf_results[] = {&results.latent_state_index_in_search_path, &results.latent_state_index_in_batch, &results.last_actions, &results.virtual_to_play_batchs};
+        for (auto per_leaf : per_leaf_results)
+        {
+            for (int leaf_order = 0; leaf_order < results.num; ++leaf_order)
+            {
+                grouped[leaf_order] = (*per_leaf)[results.leaf_order[leaf_order]];
+            }
+            per_leaf->swap(grouped);
+        }
+        for (int leaf_order = 0; leaf_order < results.num; ++leaf_order)
+        {
+            results.leaf_node_is_chance[leaf_order] = leaf_order < results.num_chance_leaves;
+        }
     }
 
 }
\ No newline at end of file
@@ -18,24 +18,50 @@ const int DEBUG_MODE = 0;
 
 namespace tree {
 
+    class CNodePool;
+
+    class CNode;
+
+    class COutcome {
+        public:
+            // the record of one chance code of an expanded chance node.
+            int code;
+            float prior;
+            // the decision node of the outcome, taken from the node pool the first time the outcome is sampled.
+            CNode *node;
+    };
+
     class CNode {
         public:
             int visit_count, to_play, current_latent_state_index, batch_index, best_action;
             float reward, prior, value_sum;
+            int num_visited_children;
+            double children_q_sum;
             bool is_chance;
             int chance_space_size;
             std::vector<int> children_index;
             std::map<int, CNode> children;
+            // an expanded chance node holds one outcome record per chance code in the node pool instead of ``children``,
+            // only the first num_outcomes records can be sampled.
+            int num_outcomes;
+            COutcome *outcomes;
 
             std::vector<int> legal_actions;
 
             CNode();
             CNode(float prior, std::vector<int> &legal_actions, bool is_chance = false, int chance_space_size = 2);
+            CNode(const CNode &node) = default;
+            CNode(CNode &&node) = default;
+            CNode& operator=(const CNode &node) = default;
+            CNode& operator=(CNode &&node) = default;
             ~CNode();
 
-            void expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, bool is_chance);
+            void expand(int to_play, int current_latent_state_index, int batch_index, float reward, const std::vector<float> &policy_logits, bool is_chance, CNodePool *node_pool = NULL, int chance_top_k = 0, float chance_prob_mass = 1.0);
+            void widen_outcomes();
             void add_exploration_noise(float exploration_fraction, const std::vector<float> &noises);
-            float compute_mean_q(int isRoot, float parent_q, float discount_factor);
+            float compute_mean_q(int isRoot, float parent_q);
+            float compute_child_q(CNode *child, float discount_factor);
+            void update_child_q(CNode *child, float old_qsa, float discount_factor);
             void print_out();
 
             int expanded();
@@ -45,6 +71,24 @@ namespace tree {
             std::vector<int> get_trajectory();
             std::vector<int> get_children_distribution();
             CNode* get_child(int action);
+            COutcome* get_outcome(int code);
+            CNode* get_outcome_node(int code, CNodePool *node_pool);
+            std::vector<float> get_outcome_priors();
+    };
+
+    class CNodePool{
+        public:
+            int block_size, num_used, num_used_outcomes;
+            std::vector<std::vector<CNode> > blocks;
+            std::vector<std::vector<COutcome> > outcome_blocks;
+
+            CNodePool();
+            CNodePool(int block_size);
+            ~CNodePool();
+
+            CNode* allocate(int num);
+            COutcome* allocate_outcomes(int num);
+            void clear();
     };
 
     class CRoots{
@@ -53,6 +97,10 @@ namespace tree {
             std::vector<CNode> roots;
             std::vector<std::vector<int> > legal_actions_list;
             int chance_space_size;
+            // the truncation of the outcomes of the chance nodes, see ``CNode::expand``.
+            int chance_top_k;
+            float chance_prob_mass;
+            CNodePool node_pool;
 
             CRoots();
             CRoots(int root_num, std::vector<std::vector<int> > &legal_actions_list, int chance_space_size);
@@ -61,9 +109,11 @@ namespace tree {
             void prepare(float root_noise_weight, const std::vector<std::vector<float> > &noises, const std::vector<float> &rewards, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
             void prepare_no_noise(const std::vector<float> &rewards, const std::vector<std::vector<float> > &policies, std::vector<int> &to_play_batch);
             void clear();
+            void set_chance_truncation(int chance_top_k, float chance_prob_mass);
             std::vector<std::vector<int> > get_trajectories();
             std::vector<std::vector<int> > get_distributions();
             std::vector<float> get_values();
+            std::vector<float> get_outcome_priors(int index, int action);
 
     };
 
@@ -73,7 +123,14 @@ namespace tree {
             std::vector<int> latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, search_lens;
             std::vector<int> virtual_to_play_batchs;
             std::vector<CNode*> nodes;
+            CNodePool *node_pool;
+            int chance_top_k;
+            float chance_prob_mass;
             std::vector<bool> leaf_node_is_chance;
+            // the leaves are grouped in ``cbatch_traverse``: leaf_order[j] is the root index of the j-th leaf,
+            // the first num_chance_leaves leaves are chance nodes.
+            int num_chance_leaves;
+            std::vector<int> leaf_order;
             std::vector<std::vector<CNode*> > search_paths;
 
             CSearchResults();
@@ -86,7 +143,7 @@ namespace tree {
     //*********************************************************
     void update_tree_q(CNode* root, tools::CMinMaxStats &min_max_stats, float discount_factor, int players);
     void cbackpropagate(std::vector<CNode*> &search_path, tools::CMinMaxStats &min_max_stats, int to_play, float value, float discount_factor);
-    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, const std::vector<float> &rewards, const std::vector<float> &values, const std::vector<std::vector<float> > &policies, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &to_play_batch, std::vector<int> & is_chance_list, std::vector<int> &leaf_idx_list);
+    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, const float *rewards, const float *values, const float *chance_policies, int chance_space_size, const float *decision_policies, int action_space_size, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &to_play_batch);
     int cselect_child(CNode* root, tools::CMinMaxStats &min_max_stats, int pb_c_base, float pb_c_init, float discount_factor, float mean_q, int players);
     float cucb_score(CNode *child, tools::CMinMaxStats &min_max_stats, float parent_mean_q, float total_children_visit_counts, float pb_c_base, float pb_c_init, float discount_factor, int players);
     void cbatch_traverse(CRoots *roots, int pb_c_base, float pb_c_init, float discount_factor, tools::CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, std::vector<int> &virtual_to_play_batch);
@@ -30,15 +30,20 @@ cdef extern from "lib/cnode.cpp":
 
 
 cdef extern from "lib/cnode.h" namespace "tree":
+    cdef cppclass CNodePool:
+        CNodePool() except +
+
     cdef cppclass CNode:
         CNode() except +
         CNode(float prior, vector[int] &legal_actions, bool is_chance, int chance_space_size) except +
         int visit_count, to_play, current_latent_state_index, batch_index, best_action
+        vector[int] legal_actions
         float value_prefixs, prior, value_sum, parent_value_prefix
 
-        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefixs, vector[float] policy_logits, bool is_chance)
+        void expand(int to_play, int current_latent_state_index, int batch_index, float value_prefixs, vector[float] policy_logits, bool is_chance, CNodePool *node_pool)
         void add_exploration_noise(float exploration_fraction, vector[float] noises)
-        float compute_mean_q(int isRoot, float parent_q, float discount_factor)
+        float compute_mean_q(int isRoot, float parent_q)
+        float compute_child_q(CNode *child, float discount_factor)
 
         int expanded()
         float value()
@@ -55,9 +60,11 @@ cdef extern from "lib/cnode.h" namespace "tree":
         void prepare(float root_noise_weight, const vector[vector[float]] &noises, const vector[float] &value_prefixs, const vector[vector[float]] &policies, vector[int] to_play_batch)
         void prepare_no_noise(const vector[float] &value_prefixs, const vector[vector[float]] &policies, vector[int] to_play_batch)
         void clear()
+        void set_chance_truncation(int chance_top_k, float chance_prob_mass)
         vector[vector[int]] get_trajectories()
         vector[vector[int]] get_distributions()
         vector[float] get_values()
+        vector[float] get_outcome_priors(int index, int action)
 
     cdef cppclass CSearchResults:
         CSearchResults() except +
@@ -66,9 +73,12 @@ cdef extern from "lib/cnode.h" namespace "tree":
         vector[int] latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, search_lens
         vector[int] virtual_to_play_batchs
         vector[bool] leaf_node_is_chance
+        int num_chance_leaves
+        vector[int] leaf_order
         vector[CNode*] nodes
 
     cdef void cbackpropagate(vector[CNode*] &search_path, CMinMaxStats &min_max_stats, int to_play, float value, float discount_factor)
-    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, vector[float] value_prefixs, vector[float] values, vector[vector[float]] policies,
-                               CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, vector[int] &to_play_batch, vector[bool] &is_chance_list, vector[int] &leaf_idx_list)
+    void cbatch_backpropagate(int current_latent_state_index, float discount_factor, const float *value_prefixs, const float *values,
+                               const float *chance_policies, int chance_space_size, const float *decision_policies, int action_space_size,
+                               CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, vector[int] &to_play_batch)
     void cbatch_traverse(CRoots *roots, int pb_c_base, float pb_c_init, float discount_factor, CMinMaxStatsList *min_max_stats_lst, CSearchResults &results, vector[int] &virtual_to_play_batch)
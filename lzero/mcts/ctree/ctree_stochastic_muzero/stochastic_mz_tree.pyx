@@ -3,6 +3,8 @@
 from libcpp.vector cimport vector
 from libcpp cimport bool
 
+include "../common_lib/legal_actions.pxi"
+
 cdef class MinMaxStatsList:
     cdef CMinMaxStatsList *cmin_max_stats_lst
 
@@ -28,9 +30,13 @@ cdef class Roots:
     cdef int root_num
     cdef CRoots *roots
 
-    def __cinit__(self, int root_num, vector[vector[int]] legal_actions_list, int chance_space_size):
+    def __cinit__(self, int root_num, legal_actions_list, int chance_space_size, int bitmask_action_space_size=0):
+        # ``legal_actions_list`` is a list of the legal actions of each root, or a (root_num, action_space_size)
+        # numpy mask, or a mask packed by ``np.packbits`` if ``bitmask_action_space_size`` > 0, see ``to_legal_actions_mask``.
+        cdef vector[vector[int]] clegal_actions_list = to_legal_actions_list(root_num, legal_actions_list,
+                                                                              bitmask_action_space_size)
         self.root_num = root_num
-        self.roots = new CRoots(root_num, legal_actions_list, chance_space_size)
+        self.roots = new CRoots(root_num, clegal_actions_list, chance_space_size)
 
     def prepare(self, float root_noise_weight, list noises, list value_prefix_pool, list policy_logits_pool,
                 vector[int] & to_play_batch):
@@ -39,6 +45,9 @@ cdef class Roots:
     def prepare_no_noise(self, list value_prefix_pool, list policy_logits_pool, vector[int] & to_play_batch):
         self.roots[0].prepare_no_noise(value_prefix_pool, policy_logits_pool, to_play_batch)
 
+    def set_chance_truncation(self, int chance_top_k, float chance_prob_mass):
+        self.roots[0].set_chance_truncation(chance_top_k, chance_prob_mass)
+
     def get_trajectories(self):
         return self.roots[0].get_trajectories()
 
@@ -48,6 +57,9 @@ cdef class Roots:
     def get_values(self):
         return self.roots[0].get_values()
 
+    def get_outcome_priors(self, int index, int action):
+        return self.roots[0].get_outcome_priors(index, action)
+
     def clear(self):
         self.roots[0].clear()
 
@@ -60,6 +72,8 @@ cdef class Roots:
 
 cdef class Node:
     cdef CNode cnode
+    # the outcome records of an expanded chance node are taken from this pool.
+    cdef CNodePool node_pool
 
     def __cinit__(self):
         pass
@@ -70,22 +84,60 @@ cdef class Node:
     def expand(self, int to_play, int current_latent_state_index, int batch_index, float value_prefix,
                list policy_logits, bool is_chance):
         cdef vector[float] cpolicy = policy_logits
-        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy, is_chance)
-
-def batch_backpropagate(int current_latent_state_index, float discount_factor, list value_prefixs, list values, list policies,
-                         MinMaxStatsList min_max_stats_lst, ResultsWrapper results, list to_play_batch, list is_chance_list, list leaf_idx_list):
-    cdef int i
-    cdef vector[float] cvalue_prefixs = value_prefixs
-    cdef vector[float] cvalues = values
-    cdef vector[vector[float]] cpolicies = policies
-
-    cbatch_backpropagate(current_latent_state_index, discount_factor, cvalue_prefixs, cvalues, cpolicies,
-                          min_max_stats_lst.cmin_max_stats_lst, results.cresults, to_play_batch, is_chance_list, leaf_idx_list)
+        self.cnode.expand(to_play, current_latent_state_index, batch_index, value_prefix, cpolicy, is_chance, &self.node_pool)
+
+def batch_backpropagate(int current_latent_state_index, float discount_factor, float[::1] value_prefixs, float[::1] values,
+                        float[:, ::1] chance_policies, float[:, ::1] decision_policies,
+                        MinMaxStatsList min_max_stats_lst, ResultsWrapper results, list to_play_batch):
+    # The inputs are in the grouped order of ``batch_traverse``: ``value_prefixs`` and ``values`` have shape (B, ),
+    # ``chance_policies`` has shape (num_chance_leaves, C) and ``decision_policies`` has shape (B - num_chance_leaves, A).
+    # The policies of an empty group can be None.
+    cdef int num = results.cresults.leaf_order.size()
+    cdef int num_chance_leaves = results.cresults.num_chance_leaves
+    cdef const float *cchance_policies = NULL
+    cdef const float *cdecision_policies = NULL
+    cdef int chance_space_size = 0
+    cdef int action_space_size = 0
+    if value_prefixs.shape[0] != num or values.shape[0] != num:
+        raise ValueError("the length of value_prefixs and values must be equal to the number of leaves")
+    if num_chance_leaves > 0:
+        if chance_policies is None or chance_policies.shape[0] != num_chance_leaves:
+            raise ValueError("the first dimension of chance_policies must be equal to the number of chance leaves")
+        cchance_policies = &chance_policies[0, 0]
+        chance_space_size = chance_policies.shape[1]
+    if num - num_chance_leaves > 0:
+        if decision_policies is None or decision_policies.shape[0] != num - num_chance_leaves:
+            raise ValueError("the first dimension of decision_policies must be equal to the number of decision leaves")
+        cdecision_policies = &decision_policies[0, 0]
+        action_space_size = decision_policies.shape[1]
+    if num == 0:
+        return
+
+    cbatch_backpropagate(current_latent_state_index, discount_factor, &value_prefixs[0], &values[0], cchance_policies,
+                         chance_space_size, cdecision_policies, action_space_size, min_max_stats_lst.cmin_max_stats_lst,
+                         results.cresults, to_play_batch)
 
 def batch_traverse(Roots roots, int pb_c_base, float pb_c_init, float discount_factor, MinMaxStatsList min_max_stats_lst,
                    ResultsWrapper results, list virtual_to_play_batch):
     cbatch_traverse(roots.roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst.cmin_max_stats_lst, results.cresults,
                     virtual_to_play_batch)
 
-    return results.cresults.leaf_node_is_chance, results.cresults.latent_state_index_in_search_path, results.cresults.latent_state_index_in_batch, results.cresults.last_actions, results.cresults.virtual_to_play_batchs
-
+    # The leaves are grouped: the first ``num_chance_leaves`` leaves are chance nodes and the others are decision nodes.
+    return results.cresults.num_chance_leaves, results.cresults.latent_state_index_in_search_path, results.cresults.latent_state_index_in_batch, results.cresults.last_actions, results.cresults.virtual_to_play_batchs
+
+def pcompute_mean_q(Roots roots, int index, float discount_factor):
+    # The mean q value of a root from the running statistics of its visited children, and from a scan of their q values.
+    cdef CNode *root
+    cdef CNode *child
+    cdef int a
+    cdef float q_sum = 0.0
+    cdef int num_visited_children = 0
+    if index < 0 or index >= roots.root_num:
+        raise IndexError("index out of range")
+    root = &(roots.roots[0].roots[index])
+    for a in root.legal_actions:
+        child = root.get_child(a)
+        if child.visit_count > 0:
+            q_sum += root.compute_child_q(child, discount_factor)
+            num_visited_children += 1
+    return root.compute_mean_q(1, 0.0), q_sum / num_visited_children if num_visited_children > 0 else 0.0
@@ -223,6 +223,9 @@ class MCTS(object):
                 start_player_index=state_config_for_simulate_env_reset.start_player_index,
                 init_state=state_config_for_simulate_env_reset.init_state,
             )
+        # If the env supports snapshots, every simulation restores the root state instead of resetting the env again.
+        use_snapshot = hasattr(self.simulate_env, 'clone_state') and hasattr(self.simulate_env, 'restore_state')
+        root_snapshot = self.simulate_env.clone_state() if use_snapshot else None
         # Expand the root node by adding children to it.
         self._expand_leaf_node(root, self.simulate_env, policy_forward_fn)
 
@@ -233,10 +236,13 @@ class MCTS(object):
         # Perform MCTS search for a fixed number of iterations.
         for n in range(self._num_simulations):
             # Initialize the simulated environment and reset it to the root node.
-            self.simulate_env.reset(
-                start_player_index=state_config_for_simulate_env_reset.start_player_index,
-                init_state=state_config_for_simulate_env_reset.init_state,
-            )
+            if use_snapshot:
+                self.simulate_env.restore_state(root_snapshot)
+            else:
+                self.simulate_env.reset(
+                    start_player_index=state_config_for_simulate_env_reset.start_player_index,
+                    init_state=state_config_for_simulate_env_reset.init_state,
+                )
             # Set the battle mode adopted by the environment during the MCTS process.
             # In ``self_play_mode``, when the environment calls the step function once, it will play one move based on the incoming action.
             # In ``play_with_bot_mode``, when the step function is called, it will play one move based on the incoming action,
@@ -231,17 +231,22 @@ class MCTS(object):
             start_player_index=state_config_for_env_reset.start_player_index,
             init_state=state_config_for_env_reset.init_state,
         )
-        # self.simulate_env_root = copy.deepcopy(self.simulate_env)
+        # If the env supports snapshots, every simulation restores the root state instead of resetting the env again.
+        use_snapshot = hasattr(self.simulate_env, 'clone_state') and hasattr(self.simulate_env, 'restore_state')
+        root_snapshot = self.simulate_env.clone_state() if use_snapshot else None
         self._expand_leaf_node(self.root, self.simulate_env, policy_value_func)
 
         if sample:
             self._add_exploration_noise(self.root)
 
         for n in range(self._num_simulations):
-            self.simulate_env.reset(
-                start_player_index=state_config_for_env_reset.start_player_index,
-                init_state=state_config_for_env_reset.init_state,
-            )
+            if use_snapshot:
+                self.simulate_env.restore_state(root_snapshot)
+            else:
+                self.simulate_env.reset(
+                    start_player_index=state_config_for_env_reset.start_player_index,
+                    init_state=state_config_for_env_reset.init_state,
+                )
             self.simulate_env.battle_mode = self.simulate_env.battle_mode_in_simulation_env
             self._simulate(self.root, self.simulate_env, policy_value_func)
 
@@ -0,0 +1,59 @@
+import numpy as np
+import pytest
+import torch
+
+from lzero.mcts.ctree.ctree_muzero import mz_tree as tree_muzero
+from lzero.policy.scaling_transform import InverseScalarTransform
+
+batch_size = 16
+action_num = 4
+support_size = 300
+discount_factor = 0.997
+
+
+def one_simulation(value_logits, reward_logits, decode_in_ctree):
+    # Run one simulation from ``batch_size`` roots, whose leaf values and rewards are decoded from the categorical
+    # logits either by ``batch_backpropagate`` in C++ or by ``InverseScalarTransform`` beforehand.
+    legal_actions = [list(range(action_num)) for _ in range(batch_size)]
+    to_play = [-1 for _ in range(batch_size)]
+    roots = tree_muzero.Roots(batch_size, legal_actions)
+    roots.prepare_no_noise([0. for _ in range(batch_size)], [[0. for _ in range(action_num)] for _ in range(batch_size)], to_play)
+    min_max_stats_lst = tree_muzero.MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+    results = tree_muzero.ResultsWrapper(num=batch_size)
+    tree_muzero.batch_traverse(roots, 19652, 1.25, discount_factor, min_max_stats_lst, results, to_play)
+
+    policies = [[0. for _ in range(action_num)] for _ in range(batch_size)]
+    if decode_in_ctree:
+        tree_muzero.batch_backpropagate(
+            1, discount_factor, reward_logits.numpy(), value_logits.numpy(), policies, min_max_stats_lst, results,
+            to_play, support_size=support_size
+        )
+    else:
+        inverse_scalar_transform_handle = InverseScalarTransform(support_size)
+        rewards = inverse_scalar_transform_handle(reward_logits).reshape(-1).tolist()
+        values = inverse_scalar_transform_handle(value_logits).reshape(-1).tolist()
+        tree_muzero.batch_backpropagate(
+            1, discount_factor, rewards, values, policies, min_max_stats_lst, results, to_play
+        )
+    return np.array(roots.get_values())
+
+
+@pytest.mark.unittest
+def test_decode_categorical():
+    torch.manual_seed(0)
+    # Scale the logits, so that the decoded scalars spread over both signs and several orders of magnitude.
+    value_logits = 5 * torch.randn(batch_size, 2 * support_size + 1)
+    reward_logits = 5 * torch.randn(batch_size, 2 * support_size + 1)
+
+    ctree_values = one_simulation(value_logits, reward_logits, decode_in_ctree=True)
+    torch_values = one_simulation(value_logits, reward_logits, decode_in_ctree=False)
+    assert np.abs(torch_values).max() > 1.
+    np.testing.assert_allclose(ctree_values, torch_values, rtol=1e-4, atol=1e-4)
+
+
+@pytest.mark.unittest
+def test_decode_categorical_shape():
+    value_logits = torch.zeros(batch_size, 2 * support_size)
+    with pytest.raises(ValueError):
+        one_simulation(value_logits, value_logits, decode_in_ctree=True)
@@ -0,0 +1,581 @@
+import os
+import sys
+import time
+from types import SimpleNamespace
+
+import numpy as np
+import pytest
+
+# The C++ AlphaZero MCTS is a pybind11 module built by CMake in ``lzero/mcts/ctree/ctree_alphazero/build``.
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../ctree/ctree_alphazero/build'))
+mcts_alphazero = pytest.importorskip('mcts_alphazero')
+
+
+def make_env(game_name, board_size=6, scale=True, channel_last=False):
+    if game_name == 'tictactoe':
+        from zoo.board_games.tictactoe.envs.tictactoe_env import TicTacToeEnv as Env
+    elif game_name == 'connect4':
+        from zoo.board_games.connect4.envs.connect4_env import Connect4Env as Env
+    elif game_name == 'gomoku':
+        from zoo.board_games.gomoku.envs.gomoku_env import GomokuEnv as Env
+    else:
+        raise KeyError(game_name)
+    cfg = Env.default_config()
+    cfg.battle_mode = 'self_play_mode'
+    cfg.scale = scale
+    cfg.channel_last = channel_last
+    if game_name == 'gomoku':
+        cfg.board_size = board_size
+    return Env(cfg)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('game_name', ['tictactoe', 'connect4', 'gomoku'])
+@pytest.mark.parametrize('scale, channel_last', [(True, False), (False, True)])
+def test_native_game_current_state(game_name, scale, channel_last):
+    # Play random games in the zoo env and in the native game, which must give the same state planes, legal actions
+    # and outcome after every move.
+    rng = np.random.RandomState(0)
+    env = make_env(game_name, scale=scale, channel_last=channel_last)
+    game = mcts_alphazero.make_game(game_name, board_size=6, scale=scale, channel_last=channel_last)
+    for start_player_index in [0, 1]:
+        env.reset(start_player_index=start_player_index)
+        game.reset(start_player_index)
+        done = False
+        while not done:
+            raw_obs, scale_obs = env.current_state()
+            native_raw_obs, native_scale_obs = game.current_state()
+            np.testing.assert_array_equal(native_raw_obs, raw_obs)
+            np.testing.assert_array_equal(native_scale_obs, scale_obs)
+            assert game.legal_actions == list(env.legal_actions)
+            assert game.current_player == env.current_player
+
+            action = int(rng.choice(game.legal_actions))
+            timestep = env.step(action)
+            game.step(action)
+            done = timestep.done
+            assert game.get_done_winner() == env.get_done_winner()
+        np.testing.assert_array_equal(game.current_state()[0], env.current_state()[0])
+
+
+def make_fake_network(action_space_size):
+    # A deterministic fake network for the C++ MCTS: the priors and the value of a position only depend on its scaled
+    # state planes, and are float32 in both the batched and the single versions, so that they expand the same trees.
+    def policy_value_fn_batch(observations, legal_actions_batch):
+        num = len(legal_actions_batch)
+        features = np.asarray(observations, dtype=np.float32).reshape(num, -1)
+        features = features @ np.arange(1, features.shape[1] + 1, dtype=np.float32)
+        action_probs = np.zeros((num, action_space_size), dtype=np.float32)
+        for i, legal_actions in enumerate(legal_actions_batch):
+            logits = np.float32(1) + np.mod(features[i] * np.arange(1, action_space_size + 1), 7).astype(np.float32)
+            action_probs[i, legal_actions] = logits[legal_actions] / logits[legal_actions].sum()
+        values = (0.5 * np.sin(features)).astype(np.float32)
+        return action_probs, values
+
+    def policy_value_fn(game):
+        action_probs, values = policy_value_fn_batch(game.current_state()[1][None], [game.legal_actions])
+        return {action: float(action_probs[0, action]) for action in game.legal_actions}, float(values[0])
+
+    return policy_value_fn, policy_value_fn_batch
+
+
+def make_state_config(board=None, start_player_index=0):
+    return dict(
+        start_player_index=start_player_index,
+        init_state=None if board is None else np.asarray(board, dtype=np.int32),
+        katago_policy_init=False,
+        katago_game_state=None,
+    )
+
+
+def make_native_mcts(game_name='tictactoe', num_simulations=40, leaf_batch_size=1):
+    mcts = mcts_alphazero.MCTS(num_simulations=num_simulations, simulate_env=None, leaf_batch_size=leaf_batch_size)
+    mcts.set_native_game(game_name, board_size=6)
+    return mcts
+
+
+@pytest.mark.unittest
+def test_batched_leaves():
+    # The leaves gathered with virtual loss are evaluated in batches, and once they are backed up the root children
+    # hold exactly one visit per simulation, i.e. no virtual visit is left on the tree.
+    num_simulations = 40
+    _, policy_value_fn_batch = make_fake_network(7)
+    batch_sizes = []
+
+    def counting_policy_value_fn_batch(observations, legal_actions_batch):
+        batch_sizes.append(len(legal_actions_batch))
+        return policy_value_fn_batch(observations, legal_actions_batch)
+
+    mcts = make_native_mcts('connect4', num_simulations=num_simulations, leaf_batch_size=8)
+    action, action_probs = mcts.get_next_action(make_state_config(), counting_policy_value_fn_batch, 1.0, False)
+    assert mcts.num_simulations_done == num_simulations
+    assert max(batch_sizes) > 1
+    assert sum(batch_sizes) <= num_simulations + 1
+    visits = np.array(action_probs) * num_simulations
+    np.testing.assert_allclose(visits, np.round(visits), atol=1e-6)
+    assert action == int(np.argmax(action_probs))
+
+
+class NativeGameEnv:
+    # A Python simulation env playing a native game, which counts how many times its legal actions are queried.
+
+    def __init__(self, game_name):
+        self.game = mcts_alphazero.make_game(game_name, board_size=6)
+        self.battle_mode = 'self_play_mode'
+        self.battle_mode_in_simulation_env = 'self_play_mode'
+        self.action_space = SimpleNamespace(n=self.game.action_space_size)
+        self.num_legal_actions_calls = 0
+
+    def reset(self, start_player_index=0, init_state=None, katago_policy_init=False, katago_game_state=None):
+        board = None if init_state is None else np.frombuffer(init_state, dtype=np.int32)
+        self.game.reset(start_player_index, board)
+
+    def step(self, action):
+        self.game.step(action)
+
+    def get_done_winner(self):
+        return self.game.get_done_winner()
+
+    def current_state(self):
+        return self.game.current_state()
+
+    @property
+    def current_player(self):
+        return self.game.current_player
+
+    @property
+    def legal_actions(self):
+        self.num_legal_actions_calls += 1
+        return self.game.legal_actions
+
+
+@pytest.mark.unittest
+def test_cached_legal_actions():
+    # The legal actions of a node are queried from the env once, when the node is expanded, and not again each time a
+    # simulation selects a child of the node.
+    env = NativeGameEnv('tictactoe')
+    policy_value_fn, _ = make_fake_network(9)
+    num_evaluations = 0
+
+    def counting_policy_value_fn(env):
+        nonlocal num_evaluations
+        num_evaluations += 1
+        return policy_value_fn(env.game)
+
+    mcts = mcts_alphazero.MCTS(num_simulations=50, simulate_env=env)
+    mcts.get_next_action(make_state_config(), counting_policy_value_fn, 1.0, False)
+    assert num_evaluations > 1
+    assert env.num_legal_actions_calls == num_evaluations
+
+
+@pytest.mark.unittest
+def test_reuse_tree():
+    # After ``update_with_move``, a search of the state reached by the move starts from the kept subtree, whose root is
+    # already expanded, while a search of any other state starts from a new root.
+    policy_value_fn, _ = make_fake_network(9)
+    evaluated_states = []
+
+    def recording_policy_value_fn(game):
+        evaluated_states.append(game.get_state())
+        return policy_value_fn(game)
+
+    game = mcts_alphazero.make_game('tictactoe')
+    mcts = make_native_mcts('tictactoe', num_simulations=50)
+    action, _ = mcts.get_next_action(make_state_config(), recording_policy_value_fn, 1.0, False)
+    assert evaluated_states[0] == game.get_state()
+
+    mcts.update_with_move(action)
+    game.step(action)
+    board = np.frombuffer(game.get_state()[1:], dtype=np.uint8).astype(np.int32)
+    evaluated_states.clear()
+    state_config = make_state_config(board, start_player_index=1)
+    action, _ = mcts.get_next_action(state_config, recording_policy_value_fn, 1.0, False)
+    assert len(evaluated_states) > 0
+    assert game.get_state() not in evaluated_states
+
+    # The empty board is not the state reached by the move.
+    mcts.update_with_move(action)
+    evaluated_states.clear()
+    mcts.get_next_action(make_state_config(), recording_policy_value_fn, 1.0, False)
+    assert evaluated_states[0] == mcts_alphazero.make_game('tictactoe').get_state()
+
+
+@pytest.mark.unittest
+def test_node_pool():
+    # A node built in Python gets its children from a pool, which keeps its blocks across ``clear`` for the next tree.
+    pool = mcts_alphazero.NodePool(block_size=64)
+    root = mcts_alphazero.Node()
+    for action in [5, 2, 9]:
+        root.add_child(pool, action, 0.1 * action)
+    child = root.children[5]
+    child.add_child(pool, 0, 0.5)
+    assert sorted(root.children) == [2, 5, 9]
+    assert root.children[5].prior_p == pytest.approx(0.5)
+    assert sorted(root.children[5].children) == [0]
+    assert not root.is_leaf()
+    with pytest.raises(ValueError):
+        root.add_child(pool, 2, 0.5)
+
+    # Adding 10 children one at a time allocates 1 + 2 + ... + 10 = 55 nodes, which fit in the first block once no
+    # handle to the nodes of the pool is left.
+    del child
+    for _ in range(3):
+        pool.clear()
+        root = mcts_alphazero.Node()
+        for action in range(10):
+            root.add_child(pool, action, 0.1)
+        assert pool.capacity == 64
+    other_root = mcts_alphazero.Node()
+    for action in range(10):
+        other_root.add_child(pool, action, 0.1)
+    assert pool.capacity > 64
+
+    # the nodes of a cleared pool are released: walking them raises instead of reading recycled nodes.
+    child = other_root.children[3]
+    pool.clear()
+    assert child.is_released() and not other_root.is_released()
+    with pytest.raises(RuntimeError):
+        child.children
+    with pytest.raises(RuntimeError):
+        child.add_child(pool, 0, 0.5)
+    with pytest.raises(RuntimeError):
+        child.value()
+    with pytest.raises(RuntimeError):
+        child.visit_count()
+    with pytest.raises(RuntimeError):
+        child.update(1.0)
+
+    # the handle stays released once the pool is used again, whose new nodes are not allocated where it points.
+    other_root = mcts_alphazero.Node()
+    for action in range(10):
+        other_root.add_child(pool, action, 0.1)
+    assert child.is_released() and not other_root.children[3].is_released()
+    with pytest.raises(RuntimeError):
+        child.value()
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('leaf_batch_size', [1, 4])
+def test_batched_mcts(leaf_batch_size):
+    # Searching several states in lockstep gives each of them the same tree as a search of that state alone.
+    num_simulations = 40
+    policy_value_fn, policy_value_fn_batch = make_fake_network(9)
+    state_configs = [
+        make_state_config(),
+        make_state_config([1, 0, 0, 0, 2, 0, 0, 0, 0]),
+        make_state_config([0, 1, 0, 0, 0, 0, 0, 0, 0], start_player_index=1),
+    ]
+    batched_mcts = mcts_alphazero.BatchedMCTS(
+        'tictactoe', num_simulations=num_simulations, leaf_batch_size=leaf_batch_size
+    )
+    results = batched_mcts.get_next_actions(state_configs, policy_value_fn_batch, 1.0, False)
+    assert batched_mcts.num_simulations_done == [num_simulations] * len(state_configs)
+
+    for state_config, (action, action_probs) in zip(state_configs, results):
+        mcts = make_native_mcts('tictactoe', num_simulations=num_simulations, leaf_batch_size=leaf_batch_size)
+        func = policy_value_fn if leaf_batch_size == 1 else policy_value_fn_batch
+        expected_action, expected_action_probs = mcts.get_next_action(state_config, func, 1.0, False)
+        assert action == expected_action
+        assert action_probs == expected_action_probs
+
+
+@pytest.mark.unittest
+def test_evaluation_cache():
+    # A position reached again through another move order is expanded with the priors and the value of its first
+    # evaluation, so the search visits the tree as without the cache while evaluating every position only once. The
+    # nodes of the position do not share their statistics: the cache is not a DAG of the positions.
+    policy_value_fn, _ = make_fake_network(9)
+
+    def search(evaluation_cache):
+        evaluated_states = []
+
+        def recording_policy_value_fn(game):
+            evaluated_states.append(game.get_state())
+            return policy_value_fn(game)
+
+        mcts = mcts_alphazero.MCTS(num_simulations=300, simulate_env=None)
+        mcts.set_native_game('tictactoe', evaluation_cache=evaluation_cache)
+        _, action_probs = mcts.get_next_action(make_state_config(), recording_policy_value_fn, 1.0, False)
+        return action_probs, evaluated_states
+
+    action_probs, evaluated_states = search(False)
+    action_probs_with_cache, evaluated_states_with_cache = search(True)
+    assert action_probs_with_cache == action_probs
+    assert len(evaluated_states_with_cache) < len(evaluated_states)
+    assert len(set(evaluated_states_with_cache)) == len(evaluated_states_with_cache)
+
+
+@pytest.mark.unittest
+def test_evaluation_cache_batched_mcts():
+    # The games searched together by BatchedMCTS have their own caches: two copies of a state are evaluated as often
+    # as in two separate searches, and their trees are the same as the tree of one search.
+    _, policy_value_fn_batch = make_fake_network(9)
+
+    def search(num_games):
+        num_evaluations = 0
+
+        def counting_policy_value_fn_batch(observations, legal_actions_batch):
+            nonlocal num_evaluations
+            num_evaluations += len(legal_actions_batch)
+            return policy_value_fn_batch(observations, legal_actions_batch)
+
+        mcts = mcts_alphazero.BatchedMCTS('tictactoe', num_simulations=300, evaluation_cache=True)
+        results = mcts.get_next_actions([make_state_config()] * num_games, counting_policy_value_fn_batch, 1.0, False)
+        return results, num_evaluations
+
+    (result, ), num_evaluations = search(1)
+    results, num_evaluations_of_two = search(2)
+    assert num_evaluations_of_two == 2 * num_evaluations
+    assert results == [result, result]
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('game_name, action_space_size', [('tictactoe', 9), ('connect4', 7)])
+@pytest.mark.parametrize('leaf_batch_size', [1, 4])
+def test_graph_search(game_name, action_space_size, leaf_batch_size):
+    # The nodes of a position reached through several move orders share its children and statistics, so the graph
+    # evaluates every position once, and fewer positions than the tree for the same number of simulations.
+    num_simulations = 1000
+    policy_value_fn, policy_value_fn_batch = make_fake_network(action_space_size)
+
+    def search(graph_search):
+        evaluated_states = []
+
+        def recording_policy_value_fn(game):
+            evaluated_states.append(game.get_state())
+            return policy_value_fn(game)
+
+        def counting_policy_value_fn_batch(observations, legal_actions_batch):
+            evaluated_states.extend([None] * len(legal_actions_batch))
+            return policy_value_fn_batch(observations, legal_actions_batch)
+
+        mcts = mcts_alphazero.MCTS(num_simulations=num_simulations, simulate_env=None, leaf_batch_size=leaf_batch_size)
+        mcts.set_native_game(game_name, graph_search=graph_search)
+        func = recording_policy_value_fn if leaf_batch_size == 1 else counting_policy_value_fn_batch
+        action, action_probs = mcts.get_next_action(make_state_config(), func, 1.0, False)
+        assert mcts.num_simulations_done == num_simulations
+        return action, action_probs, evaluated_states
+
+    _, _, evaluated_states = search(False)
+    action, action_probs, evaluated_states_of_graph = search(True)
+    assert len(evaluated_states_of_graph) < len(evaluated_states)
+    if leaf_batch_size == 1:
+        assert len(set(evaluated_states_of_graph)) == len(evaluated_states_of_graph)
+    assert sum(action_probs) == pytest.approx(1.0)
+    assert action_probs[action] > 0
+
+
+@pytest.mark.unittest
+def test_graph_search_finds_win():
+    # The values backed up through the shared positions still lead the search to an immediate win.
+    policy_value_fn, _ = make_fake_network(9)
+    mcts = mcts_alphazero.MCTS(num_simulations=300, simulate_env=None)
+    mcts.set_native_game('tictactoe', graph_search=True)
+    state_config = make_state_config(board=[[1, 1, 0], [2, 2, 0], [0, 0, 0]])
+    action, action_probs = mcts.get_next_action(state_config, policy_value_fn, 1.0, False)
+    assert action == 2 and action_probs[2] > 0.5
+
+
+@pytest.mark.unittest
+def test_graph_search_batched_mcts():
+    # The games searched together by BatchedMCTS have their own graphs.
+    _, policy_value_fn_batch = make_fake_network(9)
+
+    def search(num_games):
+        mcts = mcts_alphazero.BatchedMCTS('tictactoe', num_simulations=300, leaf_batch_size=4, graph_search=True)
+        return mcts.get_next_actions([make_state_config()] * num_games, policy_value_fn_batch, 1.0, False)
+
+    (result, ) = search(1)
+    assert search(2) == [result, result]
+
+
+@pytest.mark.unittest
+def test_graph_search_unsupported():
+    # The positions of go can repeat, and the graph is not searched by worker threads.
+    mcts = mcts_alphazero.MCTS(num_simulations=10, simulate_env=None)
+    with pytest.raises(ValueError):
+        mcts.set_native_game('go', board_size=9, graph_search=True)
+    policy_value_fn, _ = make_fake_network(9)
+    mcts.set_native_game('tictactoe', graph_search=True)
+    mcts.set_num_threads(2)
+    with pytest.raises(ValueError):
+        mcts.get_next_action(make_state_config(), policy_value_fn, 1.0, False)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('game_name, action_space_size', [('tictactoe', 9), ('connect4', 7)])
+def test_single_worker_thread(game_name, action_space_size):
+    # One worker thread backs up every simulation before it starts the next one, so the tree-parallel search visits the
+    # tree like the sequential search.
+    num_simulations = 100
+    policy_value_fn, policy_value_fn_batch = make_fake_network(action_space_size)
+    mcts = make_native_mcts(game_name, num_simulations=num_simulations)
+    expected_action, expected_action_probs = mcts.get_next_action(make_state_config(), policy_value_fn, 1.0, False)
+
+    threaded_mcts = make_native_mcts(game_name, num_simulations=num_simulations)
+    threaded_mcts.set_num_threads(1)
+    action, action_probs = threaded_mcts.get_next_action(make_state_config(), policy_value_fn_batch, 1.0, False)
+    assert threaded_mcts.num_simulations_done == num_simulations
+    assert action == expected_action
+    assert action_probs == expected_action_probs
+
+
+@pytest.mark.unittest
+def test_worker_threads_abort():
+    # An error of the policy-value function aborts the workers, which give up their simulations in progress, and the
+    # next search starts from a fresh tree.
+    policy_value_fn, policy_value_fn_batch = make_fake_network(9)
+    num_calls = 0
+
+    def failing_policy_value_fn_batch(observations, legal_actions_batch):
+        nonlocal num_calls
+        num_calls += 1
+        if num_calls == 3:
+            raise RuntimeError('evaluation failed')
+        return policy_value_fn_batch(observations, legal_actions_batch)
+
+    mcts = make_native_mcts('tictactoe', num_simulations=100)
+    mcts.set_num_threads(4)
+    with pytest.raises(RuntimeError):
+        mcts.get_next_action(make_state_config(), failing_policy_value_fn_batch, 1.0, False)
+
+    mcts.set_num_threads(1)
+    _, action_probs = mcts.get_next_action(make_state_config(), policy_value_fn_batch, 1.0, False)
+    _, expected_action_probs = make_native_mcts('tictactoe', num_simulations=100).get_next_action(
+        make_state_config(), policy_value_fn, 1.0, False
+    )
+    assert action_probs == expected_action_probs
+
+
+def go_board(game):
+    # The cells of a native go game, which follow the player to move, the passes and the ko point in its state.
+    return list(game.get_state()[4:])
+
+
+@pytest.mark.unittest
+def test_go_capture_and_ko():
+    # Black captures the white stone at (1, 1) by playing (1, 2), and white may only retake once another move has been
+    # played. Undoing the moves restores the captured stones, the board and the hash exactly.
+    board = np.zeros((5, 5), dtype=np.int32)
+    board[0, 1] = board[1, 0] = board[2, 1] = 1
+    board[0, 2] = board[1, 3] = board[2, 2] = board[1, 1] = 2
+    game = mcts_alphazero.make_game('go', board_size=5, komi=0.5)
+    game.reset(0, board)
+    state, zobrist_hash = game.get_state(), game.zobrist_hash
+
+    game.step(1 * 5 + 2)
+    assert go_board(game)[1 * 5 + 1] == 0
+    assert 1 * 5 + 1 not in game.legal_actions
+    game.step(4 * 5 + 4)
+    game.step(4 * 5 + 0)
+    assert 1 * 5 + 1 in game.legal_actions
+    game.step(1 * 5 + 1)
+    assert go_board(game)[1 * 5 + 2] == 0
+
+    for _ in range(4):
+        game.undo()
+    assert go_board(game) == board.reshape(-1).tolist()
+    assert game.get_state() == state
+    assert game.zobrist_hash == zobrist_hash
+
+
+@pytest.mark.unittest
+def test_go_suicide():
+    # White may not play in the corner surrounded by black stones, where its stone would have no liberty.
+    game = mcts_alphazero.make_game('go', board_size=3, komi=0.5)
+    game.reset(1, np.array([0, 1, 0, 1, 0, 0, 0, 0, 0], dtype=np.int32))
+    assert 0 not in game.legal_actions
+    assert 9 in game.legal_actions
+    with pytest.raises(ValueError):
+        game.step(0)
+
+
+@pytest.mark.unittest
+def test_go_undo():
+    # Undoing random moves, captures and passes included, goes back through the exact states and hashes of the game.
+    rng = np.random.RandomState(0)
+    for _ in range(20):
+        game = mcts_alphazero.make_game('go', board_size=5)
+        history = []
+        while not game.get_done_winner()[0] and len(history) < 75:
+            history.append((game.get_state(), game.zobrist_hash))
+            legal_actions = game.legal_actions
+            # Pass rarely, so that the games fill the board and capture.
+            if len(legal_actions) > 1 and rng.rand() < 0.9:
+                legal_actions = legal_actions[:-1]
+            game.step(int(rng.choice(legal_actions)))
+        for state, zobrist_hash in reversed(history):
+            game.undo()
+            assert game.get_state() == state
+            assert game.zobrist_hash == zobrist_hash
+
+
+@pytest.mark.unittest
+def test_go_scoring():
+    # A game ends after two passes and is won on area, komi included.
+    game = mcts_alphazero.make_game('go', board_size=3, komi=7.5)
+    game.step(4)
+    game.step(9)
+    game.step(9)
+    assert game.get_done_winner() == (True, 1)
+    assert game.legal_actions == []
+    game.undo()
+    assert game.get_done_winner() == (False, -1)
+
+    # One stone each and two neutral points: komi decides, and a tie is a draw.
+    for komi, winner in [(0.5, 2), (0., -1)]:
+        game = mcts_alphazero.make_game('go', board_size=2, komi=komi)
+        game.reset(0, np.array([1, 2, 0, 0], dtype=np.int32))
+        game.step(4)
+        game.step(4)
+        assert game.get_done_winner() == (True, winner)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('game_name', ['tictactoe', 'connect4', 'gomoku', 'go'])
+def test_native_game_rejects_invalid_cells(game_name):
+    # A board whose cells are not 0, 1 or 2 is rejected by ``reset`` and ``set_state``, which leave the game unchanged.
+    game = mcts_alphazero.make_game(game_name, board_size=5)
+    game.step(game.legal_actions[0])
+    state = game.get_state()
+    num_cells = len(state) - (4 if game_name == 'go' else 1)
+    for value in [3, -1]:
+        board = np.zeros(num_cells, dtype=np.int32)
+        board[1] = value
+        with pytest.raises(ValueError):
+            game.reset(0, board)
+        invalid_state = state[:-1] + bytes([value % 256])
+        with pytest.raises(ValueError):
+            game.set_state(invalid_state)
+        assert game.get_state() == state
+
+
+@pytest.mark.unittest
+def test_time_budget():
+    # Every evaluation takes a millisecond, so a search with a budget of a microsecond runs out of time after its first
+    # simulation, which always runs, while a search without budget runs all its simulations.
+    num_simulations = 50
+    policy_value_fn, policy_value_fn_batch = make_fake_network(9)
+
+    def slow_policy_value_fn(game):
+        time.sleep(1e-3)
+        return policy_value_fn(game)
+
+    def slow_policy_value_fn_batch(observations, legal_actions_batch):
+        time.sleep(1e-3)
+        return policy_value_fn_batch(observations, legal_actions_batch)
+
+    mcts = make_native_mcts('tictactoe', num_simulations=num_simulations)
+    mcts.set_time_budget(1)
+    _, action_probs = mcts.get_next_action(make_state_config(), slow_policy_value_fn, 1.0, False)
+    assert mcts.num_simulations_done == 1
+    assert sorted(action_probs)[-1] == 1.
+    mcts.set_time_budget(0)
+    mcts.get_next_action(make_state_config(), slow_policy_value_fn, 1.0, False)
+    assert mcts.num_simulations_done == num_simulations
+
+    # The budget of a state config only stops the search of that state.
+    batched_mcts = mcts_alphazero.BatchedMCTS('tictactoe', num_simulations=num_simulations)
+    state_configs = [dict(make_state_config(), time_budget_us=1), make_state_config()]
+    batched_mcts.get_next_actions(state_configs, slow_policy_value_fn_batch, 1.0, False)
+    assert batched_mcts.num_simulations_done == [1, num_simulations]
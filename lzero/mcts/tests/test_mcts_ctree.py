@@ -280,6 +280,26 @@ def test_mcts_vs_bot_to_play_legal_action():
         assert action == legal_actions_list[i][action_index]
         print('\n action_index={}, legal_action={}, action={}'.format(action_index, legal_actions_list[i], action))
 
+    if policy == 'GumbelMuZero':
+        # the dense export must be equal to the separate getters
+        visit_counts, values, improved_policies, completed_values = MCTSCtree.get_root_outputs(
+            roots, policy_config.discount_factor, policy_config.model.action_space_size
+        )
+        np.testing.assert_allclose(values, roots_values, rtol=1e-6)
+        np.testing.assert_allclose(
+            improved_policies,
+            roots.get_policies(policy_config.discount_factor, policy_config.model.action_space_size),
+            rtol=1e-6
+        )
+        np.testing.assert_allclose(
+            completed_values,
+            roots.get_children_values(policy_config.discount_factor, policy_config.model.action_space_size),
+            rtol=1e-6
+        )
+        for i in range(env_nums):
+            assert visit_counts[i][legal_actions_list[i]].tolist() == roots_distributions[i]
+            assert visit_counts[i].sum() == sum(roots_distributions[i])
+
 
 @pytest.mark.unittest
 def test_mcts_self_play():
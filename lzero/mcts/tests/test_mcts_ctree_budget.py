@@ -0,0 +1,132 @@
+import time
+
+import numpy as np
+import pytest
+import torch
+from easydict import EasyDict
+
+from lzero.mcts.ctree.ctree_muzero import mz_tree as tree_muzero
+from lzero.mcts.tree_search.mcts_ctree import MuZeroMCTSCtree as MCTSCtree
+
+batch_size = 4
+action_space_size = 6
+
+policy_config = EasyDict(
+    num_simulations=50,
+    pb_c_base=19652,
+    pb_c_init=1.25,
+    discount_factor=0.997,
+    value_delta_max=0.01,
+    device='cpu',
+    model=dict(
+        action_space_size=action_space_size,
+        support_scale=300,
+        categorical_distribution=True,
+    ),
+    env_type='not_board_games',
+)
+
+
+class SlowMuZeroModelFake(torch.nn.Module):
+    """
+    Overview:
+        Fake MuZero model whose recurrent inference takes a millisecond, for the tests of the budgets of the search.
+    Interfaces:
+        __init__, recurrent_inference
+    """
+
+    def __init__(self, action_num):
+        super().__init__()
+        self.action_num = action_num
+
+    def recurrent_inference(self, latent_states, actions):
+        time.sleep(1e-3)
+        batch_size = latent_states.shape[0]
+        return EasyDict(
+            latent_state=torch.zeros(size=(batch_size, 4)),
+            reward=torch.zeros(size=(batch_size, 601)),
+            value=torch.zeros(size=(batch_size, 601)),
+            policy_logits=torch.zeros(size=(batch_size, self.action_num)),
+        )
+
+
+def search(**kwargs):
+    legal_actions = [list(range(action_space_size)) for _ in range(batch_size)]
+    roots = MCTSCtree.roots(batch_size, legal_actions)
+    roots.prepare_no_noise(
+        [0. for _ in range(batch_size)], [[0. for _ in range(action_space_size)] for _ in range(batch_size)],
+        [-1 for _ in range(batch_size)]
+    )
+    latent_state_roots = np.zeros((batch_size, 4), dtype=np.float32)
+    num_simulations_done = MCTSCtree(policy_config).search(
+        roots, SlowMuZeroModelFake(action_space_size), latent_state_roots, [-1 for _ in range(batch_size)], **kwargs
+    )
+    return roots, num_simulations_done
+
+
+@pytest.mark.unittest
+def test_time_budget():
+    # A budget of a microsecond runs out after the first simulation, which always runs, and the roots hold its visits.
+    roots, num_simulations_done = search(time_budget_us=1)
+    assert num_simulations_done == 1
+    assert [sum(distribution) for distribution in roots.get_distributions()] == [1] * batch_size
+
+    num_simulations = policy_config.num_simulations
+    roots, num_simulations_done = search(time_budget_us=0)
+    assert num_simulations_done == num_simulations
+    assert [sum(distribution) for distribution in roots.get_distributions()] == [num_simulations] * batch_size
+
+
+@pytest.mark.unittest
+def test_update_active():
+    # Root 0 puts all its prior on one action, whose lead cannot be caught up within the budget after six simulations,
+    # so it retires and drops out of the traversals, while the visits of root 1 stay even until its budget is used up.
+    budget = 10
+    roots = MCTSCtree.roots(2, [list(range(action_space_size)) for _ in range(2)])
+    roots.prepare_no_noise([0., 0.], [[20.] + [0.] * (action_space_size - 1), [0.] * action_space_size], [-1, -1])
+    roots.set_budgets([budget, budget])
+    min_max_stats_lst = tree_muzero.MinMaxStatsList(2)
+    min_max_stats_lst.set_delta(policy_config.value_delta_max)
+    results = tree_muzero.ResultsWrapper(num=2)
+
+    num_leaves = []
+    for simulation_index in range(budget):
+        results.reset()
+        _, latent_state_index_in_batch, _, virtual_to_play_batch = tree_muzero.batch_traverse(
+            roots, policy_config.pb_c_base, policy_config.pb_c_init, policy_config.discount_factor, min_max_stats_lst,
+            results, [-1, -1]
+        )
+        num = len(latent_state_index_in_batch)
+        num_leaves.append(num)
+        tree_muzero.batch_backpropagate(
+            simulation_index + 1, policy_config.discount_factor, [0.] * num, [0.] * num,
+            [[0.] * action_space_size for _ in range(num)], min_max_stats_lst, results, virtual_to_play_batch
+        )
+        num_active = roots.update_active()
+        if simulation_index + 1 == 6:
+            assert num_active == 1
+            assert roots.active.tolist() == [0, 1]
+    assert num_leaves == [2] * 6 + [1] * 4
+    assert roots.num_active == 0
+    assert [sum(distribution) for distribution in roots.get_distributions()] == [6, budget]
+
+
+@pytest.mark.unittest
+def test_budgets():
+    # A root with a budget of 0 runs no simulation, and the others run their budget, capped by ``num_simulations``.
+    num_simulations = policy_config.num_simulations
+    roots, num_simulations_done = search(budgets=[0, 5, num_simulations, 2 * num_simulations])
+    assert num_simulations_done == num_simulations
+    assert [sum(distribution) for distribution in roots.get_distributions()] == [0, 5, num_simulations, num_simulations]
+
+    roots, num_simulations_done = search(budgets=[0] * batch_size)
+    assert num_simulations_done == 0
+
+
+@pytest.mark.unittest
+def test_unsupported_budget_options():
+    from lzero.mcts.tree_search.mcts_ctree import EfficientZeroMCTSCtree, GumbelMuZeroMCTSCtree
+    with pytest.raises(ValueError):
+        EfficientZeroMCTSCtree(EasyDict(policy_config, ctree_adaptive_budget=True))
+    with pytest.raises(ValueError):
+        GumbelMuZeroMCTSCtree(EasyDict(policy_config, ctree_time_budget_us=1000))
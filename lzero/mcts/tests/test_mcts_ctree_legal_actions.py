@@ -0,0 +1,80 @@
+import numpy as np
+import pytest
+
+from lzero.mcts.ctree.ctree_efficientzero import ez_tree as tree_efficientzero
+from lzero.mcts.ctree.ctree_gumbel_muzero import gmz_tree as tree_gumbel_muzero
+from lzero.mcts.ctree.ctree_muzero import mz_tree as tree_muzero
+from lzero.mcts.ctree.ctree_sampled_efficientzero import ezs_tree as tree_sampled_efficientzero
+from lzero.mcts.ctree.ctree_stochastic_muzero import stochastic_mz_tree as tree_stochastic_muzero
+
+root_num = 5
+action_space_size = 11
+trees = [tree_muzero, tree_efficientzero, tree_gumbel_muzero, tree_stochastic_muzero, tree_sampled_efficientzero]
+
+
+def random_mask(seed):
+    rng = np.random.RandomState(seed)
+    mask = rng.rand(root_num, action_space_size) < 0.5
+    mask[0] = False
+    mask[1] = True
+    return mask
+
+
+def expected_legal_actions(mask):
+    return [np.flatnonzero(row).tolist() for row in mask]
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('tree', trees)
+@pytest.mark.parametrize(
+    'to_mask', [
+        lambda mask: mask,
+        lambda mask: mask.astype(np.uint8),
+        lambda mask: mask.astype(np.float32),
+        lambda mask: mask.astype(np.int64),
+        # every nonzero entry is legal, whatever its value
+        lambda mask: (mask * np.array([1, 2, -1, 255, 0.5, 3, 1, 1, 1, 1, 7])).astype(np.float64),
+        lambda mask: (mask * 255).astype(np.uint8),
+        # a non contiguous mask
+        lambda mask: np.asfortranarray(mask.astype(np.uint8)),
+    ]
+)
+def test_legal_actions_from_mask(tree, to_mask):
+    mask = random_mask(0)
+    assert tree.plegal_actions_list(root_num, to_mask(mask)) == expected_legal_actions(mask)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('tree', trees)
+def test_legal_actions_from_packed_mask(tree):
+    mask = random_mask(1)
+    packed_mask = np.packbits(mask.astype(np.uint8), axis=1)
+    assert tree.plegal_actions_list(root_num, packed_mask, action_space_size) == expected_legal_actions(mask)
+    with pytest.raises(ValueError):
+        tree.plegal_actions_list(root_num, packed_mask.astype(np.float32), action_space_size)
+    with pytest.raises(ValueError):
+        tree.plegal_actions_list(root_num, packed_mask, 8 * packed_mask.shape[1] + 1)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('tree', trees)
+def test_legal_actions_from_list(tree):
+    # a list is the legal actions of each root, not a mask.
+    legal_actions = expected_legal_actions(random_mask(2))
+    assert tree.plegal_actions_list(root_num, legal_actions) == legal_actions
+    with pytest.raises(ValueError):
+        tree.plegal_actions_list(root_num + 1, random_mask(2))
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('tree', [tree_muzero, tree_efficientzero])
+def test_roots_reset_from_mask(tree):
+    # ``Roots.reset`` normalizes its mask like the constructor. A root without legal actions expands all the actions,
+    # so every root keeps one.
+    mask = random_mask(3)
+    mask[:, 0] = True
+    roots = tree.Roots(0, [])
+    for legal_actions_mask in [mask, mask.astype(np.uint8), mask.astype(np.float32) * 0.5, mask.tolist()]:
+        roots.reset(root_num, legal_actions_mask)
+        roots.prepare_no_noise([0.] * root_num, np.zeros((root_num, action_space_size)).tolist(), [-1] * root_num)
+        assert [len(distribution) for distribution in roots.get_distributions()] == mask.sum(axis=1).tolist()
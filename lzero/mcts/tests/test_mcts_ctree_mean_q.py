@@ -0,0 +1,101 @@
+import numpy as np
+import pytest
+
+from lzero.mcts.ctree.ctree_efficientzero import ez_tree as tree_efficientzero
+from lzero.mcts.ctree.ctree_muzero import mz_tree as tree_muzero
+from lzero.mcts.ctree.ctree_stochastic_muzero import stochastic_mz_tree as tree_stochastic_muzero
+
+batch_size = 4
+action_space_size = 6
+chance_space_size = 4
+num_simulations = 50
+discount_factor = 0.99
+pb_c_base = 19652
+pb_c_init = 1.25
+
+
+roots_module = {
+    tree_muzero.Roots: tree_muzero,
+    tree_efficientzero.Roots: tree_efficientzero,
+    tree_stochastic_muzero.Roots: tree_stochastic_muzero
+}
+
+
+def prepare_roots(rng, roots):
+    roots.prepare_no_noise(
+        [0. for _ in range(batch_size)],
+        rng.randn(batch_size, action_space_size).tolist(), [-1 for _ in range(batch_size)]
+    )
+    min_max_stats_lst = roots_module[type(roots)].MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+    return min_max_stats_lst
+
+
+def assert_mean_q_matches_scan(tree, roots):
+    # The mean q value from the running sum of the q values of the visited children must be the mean of a scan of them.
+    for i in range(batch_size):
+        running_mean_q, scanned_mean_q = tree.pcompute_mean_q(roots, i, discount_factor)
+        np.testing.assert_allclose(running_mean_q, scanned_mean_q, rtol=1e-4, atol=1e-5)
+
+
+@pytest.mark.unittest
+def test_muzero_mean_q():
+    rng = np.random.RandomState(0)
+    roots = tree_muzero.Roots(batch_size, [list(range(action_space_size)) for _ in range(batch_size)])
+    min_max_stats_lst = prepare_roots(rng, roots)
+    for simulation_index in range(num_simulations):
+        results = tree_muzero.ResultsWrapper(num=batch_size)
+        _, _, _, virtual_to_play_batch = tree_muzero.batch_traverse(
+            roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1 for _ in range(batch_size)]
+        )
+        tree_muzero.batch_backpropagate(
+            simulation_index + 1, discount_factor,
+            rng.randn(batch_size).tolist(),
+            rng.randn(batch_size).tolist(),
+            rng.randn(batch_size, action_space_size).tolist(), min_max_stats_lst, results, virtual_to_play_batch
+        )
+        assert_mean_q_matches_scan(tree_muzero, roots)
+
+
+@pytest.mark.unittest
+def test_efficientzero_mean_q():
+    # The q value of a child depends on the value prefix of its parent unless the parent resets it.
+    rng = np.random.RandomState(0)
+    roots = tree_efficientzero.Roots(batch_size, [list(range(action_space_size)) for _ in range(batch_size)])
+    min_max_stats_lst = prepare_roots(rng, roots)
+    for simulation_index in range(num_simulations):
+        results = tree_efficientzero.ResultsWrapper(num=batch_size)
+        _, _, _, virtual_to_play_batch = tree_efficientzero.batch_traverse(
+            roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1 for _ in range(batch_size)]
+        )
+        tree_efficientzero.batch_backpropagate(
+            simulation_index + 1, discount_factor,
+            rng.randn(batch_size).tolist(),
+            rng.randn(batch_size).tolist(),
+            rng.randn(batch_size, action_space_size).tolist(), min_max_stats_lst, results,
+            rng.randint(0, 2, size=batch_size).tolist(), virtual_to_play_batch
+        )
+        assert_mean_q_matches_scan(tree_efficientzero, roots)
+
+
+@pytest.mark.unittest
+def test_stochastic_muzero_mean_q():
+    rng = np.random.RandomState(0)
+    roots = tree_stochastic_muzero.Roots(
+        batch_size, [list(range(action_space_size)) for _ in range(batch_size)], chance_space_size
+    )
+    min_max_stats_lst = prepare_roots(rng, roots)
+    for simulation_index in range(num_simulations):
+        results = tree_stochastic_muzero.ResultsWrapper(num=batch_size)
+        num_chance_leaves, _, _, _, virtual_to_play_batch = tree_stochastic_muzero.batch_traverse(
+            roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1 for _ in range(batch_size)]
+        )
+        tree_stochastic_muzero.batch_backpropagate(
+            simulation_index + 1, discount_factor,
+            rng.randn(batch_size).astype(np.float32),
+            rng.randn(batch_size).astype(np.float32),
+            rng.randn(num_chance_leaves, chance_space_size).astype(np.float32),
+            rng.randn(batch_size - num_chance_leaves, action_space_size).astype(np.float32), min_max_stats_lst,
+            results, virtual_to_play_batch
+        )
+        assert_mean_q_matches_scan(tree_stochastic_muzero, roots)
@@ -0,0 +1,81 @@
+import numpy as np
+import pytest
+
+from lzero.mcts.ctree.ctree_efficientzero import ez_tree as tree_efficientzero
+from lzero.mcts.ctree.ctree_muzero import mz_tree as tree_muzero
+
+batch_size = 4
+action_space_size = 6
+num_simulations = 30
+discount_factor = 0.99
+pb_c_base = 19652
+pb_c_init = 1.25
+
+
+def search(tree, roots, results, root_num):
+    # A search with a deterministic model whose outputs only depend on the root and the depth of the leaf, and whose
+    # priors are uniform: the statistics do not depend on how the ties of the unvisited children are broken.
+    roots.prepare_no_noise([0. for _ in range(root_num)], np.zeros((root_num, action_space_size)).tolist(), [-1] * root_num)
+    min_max_stats_lst = tree.MinMaxStatsList(root_num)
+    min_max_stats_lst.set_delta(0.01)
+    latent_state_batch_in_search_path = [np.arange(1, root_num + 1)]
+    for simulation_index in range(num_simulations):
+        results.reset()
+        latent_state_index_in_search_path, latent_state_index_in_batch, _, virtual_to_play_batch = tree.batch_traverse(
+            roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1] * root_num
+        )
+        latent_states = np.array(
+            [
+                (latent_state_batch_in_search_path[ix][iy] * 31 + 1) % 1000003
+                for ix, iy in zip(latent_state_index_in_search_path, latent_state_index_in_batch)
+            ]
+        )
+        latent_state_batch_in_search_path.append(latent_states)
+        outputs = np.array([np.random.RandomState(latent_state).randn(2) for latent_state in latent_states])
+        policies = np.zeros((root_num, action_space_size)).tolist()
+        if tree is tree_efficientzero:
+            tree.batch_backpropagate(
+                simulation_index + 1, discount_factor, outputs[:, 0].tolist(), outputs[:, 1].tolist(), policies,
+                min_max_stats_lst, results, [0] * root_num, virtual_to_play_batch
+            )
+        else:
+            tree.batch_backpropagate(
+                simulation_index + 1, discount_factor, outputs[:, 0].tolist(), outputs[:, 1].tolist(), policies,
+                min_max_stats_lst, results, virtual_to_play_batch
+            )
+
+
+def assert_same_statistics(roots, expected_roots):
+    assert [sorted(distribution) for distribution in roots.get_distributions()] == \
+           [sorted(distribution) for distribution in expected_roots.get_distributions()]
+    np.testing.assert_allclose(roots.get_values(), expected_roots.get_values(), rtol=1e-5)
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('tree', [tree_muzero, tree_efficientzero])
+def test_roots_reset(tree):
+    # Roots and results reset in place, whose nodes are recycled from the previous search, must give the same
+    # statistics as new ones.
+    rng = np.random.RandomState(0)
+    masks = [(rng.rand(batch_size, action_space_size) < 0.7).astype(np.uint8) for _ in range(3)]
+    for mask in masks:
+        mask[:, 0] = 1
+    roots = tree.Roots(batch_size, masks[0])
+    results = tree.ResultsWrapper(num=batch_size)
+    search(tree, roots, results, batch_size)
+
+    for mask in masks[1:]:
+        roots.reset(batch_size, mask)
+        assert roots.get_distributions() == [[] for _ in range(batch_size)]
+        search(tree, roots, results, batch_size)
+        expected_roots = tree.Roots(batch_size, mask)
+        search(tree, expected_roots, tree.ResultsWrapper(num=batch_size), batch_size)
+        assert [len(distribution) for distribution in roots.get_distributions()] == mask.sum(axis=1).tolist()
+        assert_same_statistics(roots, expected_roots)
+
+    # fewer roots than in the previous searches.
+    roots.reset(batch_size // 2, masks[0][:batch_size // 2])
+    search(tree, roots, tree.ResultsWrapper(num=batch_size // 2), batch_size // 2)
+    expected_roots = tree.Roots(batch_size // 2, masks[0][:batch_size // 2])
+    search(tree, expected_roots, tree.ResultsWrapper(num=batch_size // 2), batch_size // 2)
+    assert_same_statistics(roots, expected_roots)
@@ -0,0 +1,130 @@
+import itertools
+import os
+import sys
+from types import SimpleNamespace
+
+import numpy as np
+import pytest
+
+# The C++ Gumbel AlphaZero MCTS is a pybind11 module built by CMake in its ``build`` directory.
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), '../ctree/ctree_gumbel_alphazero/build'))
+mcts_gumbel_alphazero = pytest.importorskip('mcts_gumbel_alphazero')
+
+
+class OpenBoardEnv:
+    # A simulation env of nine cells filled in turn, which only ends when the board is full, so that the search never
+    # reaches a terminal leaf within a few simulations.
+
+    def __init__(self):
+        self.battle_mode = 'self_play_mode'
+        self.battle_mode_in_simulation_env = 'self_play_mode'
+        self.action_space = SimpleNamespace(n=9)
+        self.reset()
+
+    def reset(self, start_player_index=0, init_state=None, katago_policy_init=False, katago_game_state=None):
+        self.board = np.zeros(9, dtype=np.float32)
+        self.current_player = start_player_index + 1
+
+    def step(self, action):
+        self.board[action] = self.current_player
+        self.current_player = 3 - self.current_player
+
+    @property
+    def legal_actions(self):
+        return [action for action in range(9) if self.board[action] == 0]
+
+    def get_done_winner(self):
+        return len(self.legal_actions) == 0, -1
+
+    def current_state(self):
+        state = self.board.reshape(1, 3, 3).copy()
+        return state, state
+
+
+@pytest.mark.unittest
+def test_batched_halving_schedule():
+    # With ``batched_halving``, every phase of the root sequential halving is one call of the batched policy-value
+    # function, which evaluates one leaf below each action considered in that phase.
+    num_simulations = 16
+    max_num_considered_actions = 4
+    batch_sizes = []
+
+    def policy_value_fn_batch(observations, legal_actions_batch):
+        num = len(legal_actions_batch)
+        batch_sizes.append(num)
+        return np.full((num, 9), 1. / 9, dtype=np.float32), np.zeros(num, dtype=np.float32)
+
+    mcts = mcts_gumbel_alphazero.MCTS(
+        num_simulations=num_simulations,
+        max_num_considered_actions=max_num_considered_actions,
+        simulate_env=OpenBoardEnv(),
+        batched_halving=True
+    )
+    state_config = dict(start_player_index=0, init_state=None, katago_policy_init=False, katago_game_state=None)
+    mcts.get_next_action(state_config, policy_value_fn_batch, 1.0, False)
+
+    considered_visits = mcts.get_sequence_of_considered_visits(max_num_considered_actions, num_simulations)
+    phase_sizes = [len(list(phase)) for _, phase in itertools.groupby(considered_visits)]
+    # Four actions are visited twice, then the two best of them four more times each.
+    assert phase_sizes == [4, 4, 2, 2, 2, 2]
+    # The first call evaluates the root.
+    assert batch_sizes == [1] + phase_sizes
+
+
+@pytest.mark.unittest
+def test_node_pool():
+    # A node built in Python gets its children from a pool, one at a time with ``add_child`` or all at once by setting
+    # ``children``, whose values are copied into the pool.
+    pool = mcts_gumbel_alphazero.NodePool(block_size=64)
+    root = mcts_gumbel_alphazero.Node()
+    for action in [5, 2, 9]:
+        root.add_child(pool, action, 0.1 * action)
+    root.children[5].add_child(pool, 0, 0.5)
+    assert sorted(root.children) == [2, 5, 9]
+    assert root.children[5].prior_p == pytest.approx(0.5)
+    assert sorted(root.children[5].children) == [0]
+    with pytest.raises(ValueError):
+        root.add_child(pool, 2, 0.5)
+
+    other = mcts_gumbel_alphazero.Node(prior_p=0.25)
+    other.visit_count = 7
+    root.children = {3: root.children[5], 1: other}
+    assert sorted(root.children) == [1, 3]
+    assert root.children[1].visit_count == 7 and root.children[1].prior_p == pytest.approx(0.25)
+    assert sorted(root.children[3].children) == [0]
+    assert root.children[3].children[0].parent().action == 3
+    root.children = {}
+    assert root.is_leaf()
+    with pytest.raises(ValueError):
+        root.children = {0: other}
+
+    # Adding 10 children one at a time allocates 1 + 2 + ... + 10 = 55 nodes, which fit in the first block.
+    for _ in range(3):
+        pool.clear()
+        root = mcts_gumbel_alphazero.Node()
+        for action in range(10):
+            root.add_child(pool, action, 0.1)
+        assert pool.capacity == 64
+
+    # the nodes of a cleared pool are released: walking them raises instead of reading recycled nodes.
+    child = root.children[3]
+    pool.clear()
+    assert child.is_released() and not root.is_released()
+    with pytest.raises(RuntimeError):
+        child.children
+    with pytest.raises(RuntimeError):
+        child.children = {}
+    with pytest.raises(RuntimeError):
+        child.value
+    with pytest.raises(RuntimeError):
+        child.visit_count = 1
+    with pytest.raises(RuntimeError):
+        child.update(1.0)
+
+    # the handle stays released once the pool is used again, whose new nodes are not allocated where it points.
+    root = mcts_gumbel_alphazero.Node()
+    for action in range(10):
+        root.add_child(pool, action, 0.1)
+    assert child.is_released() and not root.children[3].is_released()
+    with pytest.raises(RuntimeError):
+        child.raw_value
@@ -0,0 +1,138 @@
+import numpy as np
+import pytest
+
+from lzero.mcts.ctree.ctree_gumbel_muzero import gmz_tree as tree_gumbel_muzero
+from lzero.mcts.tree_search.mcts_ctree import GumbelMuZeroMCTSCtree as MCTSCtree
+
+batch_size = 8
+action_space_size = 16
+discount_factor = 0.99
+# the scale of the gumbel noise of the roots, see ``CNode::CNode``.
+gumbel_scale = 10.
+
+
+def prepare_roots(rng, gumbel_seeds):
+    legal_actions = [list(range(action_space_size)) for _ in range(batch_size)]
+    roots = tree_gumbel_muzero.Roots(batch_size, legal_actions)
+    roots.set_gumbel_seeds(gumbel_seeds)
+    roots.prepare_no_noise(
+        [0. for _ in range(batch_size)],
+        rng.randn(batch_size).tolist(),
+        rng.randn(batch_size, action_space_size).tolist(), [-1 for _ in range(batch_size)]
+    )
+    return roots
+
+
+def traverse(roots, num_simulations, max_num_considered_actions):
+    results = tree_gumbel_muzero.ResultsWrapper(num=batch_size)
+    _, _, _, virtual_to_play_batch = tree_gumbel_muzero.batch_traverse(
+        roots, num_simulations, max_num_considered_actions, discount_factor, results, [-1 for _ in range(batch_size)]
+    )
+    return results, virtual_to_play_batch
+
+
+def backpropagate(rng, simulation_index, min_max_stats_lst, results, virtual_to_play_batch):
+    # The outputs of a random model, whose rewards, values and policies spread the statistics of the children.
+    tree_gumbel_muzero.batch_back_propagate(
+        simulation_index + 1, discount_factor,
+        rng.randn(batch_size).tolist(),
+        rng.randn(batch_size).tolist(),
+        (2 * rng.randn(batch_size, action_space_size)).tolist(), min_max_stats_lst, results, virtual_to_play_batch
+    )
+
+
+def select_root_child_by_table(roots, index, gumbel, num_simulations, max_num_considered_actions):
+    # The root selection of the table of considered visits: only the children whose visit count is the considered
+    # visit of the current simulation are scored, by gumbel + prior + completed Q value.
+    visit_counts = np.array(roots.get_distributions()[index])
+    # ``get_policies`` returns the softmax of the prior + completed Q value of each child, whose log only differs from
+    # the prior + completed Q value by a constant.
+    scores = np.array(gumbel) + np.log(roots.get_policies(discount_factor, action_space_size)[index])
+    table = tree_gumbel_muzero.pget_table_of_considered_visits(max_num_considered_actions, num_simulations)
+    considered_visit = table[min(max_num_considered_actions, num_simulations)][visit_counts.sum()]
+    scores[visit_counts != considered_visit] = -np.inf
+    return int(np.argmax(scores))
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize(
+    'max_num_considered_actions, num_simulations', [(2, 8), (4, 10), (4, 32), (8, 20), (16, 16), (16, 50)]
+)
+def test_sequential_halving_matches_table(max_num_considered_actions, num_simulations):
+    # The precomputed sequential halving schedule and the incremental considered set must select the same root
+    # actions as the table of considered visits at every simulation.
+    rng = np.random.RandomState(num_simulations)
+    gumbel_seeds = list(range(1, batch_size + 1))
+    roots = prepare_roots(rng, gumbel_seeds)
+    gumbels = [tree_gumbel_muzero.pgenerate_gumbel(gumbel_scale, seed, action_space_size) for seed in gumbel_seeds]
+    min_max_stats_lst = tree_gumbel_muzero.MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+
+    for simulation_index in range(num_simulations):
+        results, virtual_to_play_batch = traverse(roots, num_simulations, max_num_considered_actions)
+        # the traversal does not change the statistics, so the reference is computed from the same tree.
+        root_actions = [trajectory[0] for trajectory in roots.get_trajectories()]
+        for i in range(batch_size):
+            assert root_actions[i] == select_root_child_by_table(
+                roots, i, gumbels[i], num_simulations, max_num_considered_actions
+            )
+        backpropagate(rng, simulation_index, min_max_stats_lst, results, virtual_to_play_batch)
+
+    assert [sum(distribution) for distribution in roots.get_distributions()] == [num_simulations] * batch_size
+
+
+@pytest.mark.unittest
+def test_gumbel_seeds():
+    # The gumbel noise of a root only depends on its own seed: it is reproducible, and distinct seeds give distinct noise.
+    rng = np.random.RandomState(0)
+    gumbel_seeds = [1, 2, 3, 4, 5, 6, 7, 1]
+    gumbels = np.array(prepare_roots(rng, gumbel_seeds).get_gumbels())
+    assert gumbels.shape == (batch_size, action_space_size)
+    for i, seed in enumerate(gumbel_seeds):
+        np.testing.assert_array_equal(gumbels[i], tree_gumbel_muzero.pgenerate_gumbel(gumbel_scale, seed, action_space_size))
+    np.testing.assert_array_equal(gumbels[0], gumbels[-1])
+    assert len(np.unique(gumbels[:-1], axis=0)) == batch_size - 1
+
+    np.testing.assert_array_equal(prepare_roots(rng, gumbel_seeds).get_gumbels(), gumbels)
+
+    # new seeds drop the noise already generated.
+    roots = prepare_roots(rng, gumbel_seeds)
+    roots.get_gumbels()
+    roots.set_gumbel_seeds(list(range(10, 10 + batch_size)))
+    new_gumbels = np.array(roots.get_gumbels())
+    np.testing.assert_array_equal(new_gumbels[0], tree_gumbel_muzero.pgenerate_gumbel(gumbel_scale, 10, action_space_size))
+    assert not np.any(np.all(new_gumbels == gumbels, axis=1))
+
+
+@pytest.mark.unittest
+def test_gumbel_seeds_of_roots_wrapper():
+    # Without seeds, the wrapper draws the seeds from ``np.random``: the roots get distinct noise, which is reproducible
+    # with the global seed.
+    legal_actions = np.ones((batch_size, action_space_size), dtype=np.uint8)
+    np.random.seed(0)
+    gumbels = np.array(MCTSCtree.roots(batch_size, legal_actions).get_gumbels())
+    assert len(np.unique(gumbels, axis=0)) == batch_size
+    np.random.seed(0)
+    np.testing.assert_array_equal(MCTSCtree.roots(batch_size, legal_actions).get_gumbels(), gumbels)
+
+
+@pytest.mark.unittest
+def test_interior_selection_matches_softmax():
+    # The fused selection of the interior nodes must select the same children as the softmax of the prior + completed
+    # Q value of ``qtransform_completed_by_mix_value``, penalized by the visit counts.
+    rng = np.random.RandomState(0)
+    num_simulations = 30
+    roots = prepare_roots(rng, list(range(batch_size)))
+    min_max_stats_lst = tree_gumbel_muzero.MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+
+    for simulation_index in range(num_simulations):
+        # ``get_policies`` returns the softmax of the prior + completed Q value of each child.
+        policies = np.array(roots.get_policies(discount_factor, action_space_size))
+        visit_counts = np.array(roots.get_distributions())
+        to_argmax = policies - visit_counts / (1 + visit_counts.sum(axis=1, keepdims=True))
+        for i in range(batch_size):
+            assert tree_gumbel_muzero.pselect_interior_child(roots, i, discount_factor) == np.argmax(to_argmax[i])
+
+        results, virtual_to_play_batch = traverse(roots, num_simulations, 4)
+        backpropagate(rng, simulation_index, min_max_stats_lst, results, virtual_to_play_batch)
@@ -133,3 +133,14 @@ def test_mcts():
     MCTSCtree(policy_config).search(roots, model, latent_state_roots, reward_hidden_state_state, to_play_batch)
     roots_distributions = roots.get_distributions()
     assert np.array(roots_distributions).shape == (batch_size, policy_config.num_of_sampled_actions)
+
+    sampled_actions, visit_counts, values, valid_masks = MCTSCtree.get_root_outputs(
+        roots, policy_config.num_of_sampled_actions, policy_config.model.action_space_size
+    )
+    assert sampled_actions.shape == (
+        batch_size, policy_config.num_of_sampled_actions, policy_config.model.action_space_size
+    )
+    assert valid_masks.all()
+    assert (visit_counts == np.array(roots_distributions)).all()
+    assert np.allclose(values, np.array(roots.get_values()))
+    assert np.allclose(sampled_actions, np.array(roots.get_sampled_actions()))
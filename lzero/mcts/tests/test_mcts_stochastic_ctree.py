@@ -0,0 +1,170 @@
+import numpy as np
+import pytest
+
+from lzero.mcts.ctree.ctree_stochastic_muzero import stochastic_mz_tree
+
+batch_size = 4
+action_space_size = 3
+chance_space_size = 8
+discount_factor = 0.997
+pb_c_base = 19652
+pb_c_init = 1.25
+
+
+def softmax(logits):
+    exp_logits = np.exp(logits - logits.max())
+    return exp_logits / exp_logits.sum()
+
+
+def prepare_roots(rng, legal_actions, chance_top_k=0, chance_prob_mass=1.):
+    roots = stochastic_mz_tree.Roots(batch_size, legal_actions, chance_space_size)
+    roots.prepare_no_noise(
+        [0. for _ in range(batch_size)],
+        rng.randn(batch_size, action_space_size).tolist(), [-1 for _ in range(batch_size)]
+    )
+    roots.set_chance_truncation(chance_top_k, chance_prob_mass)
+    return roots
+
+
+def simulate(roots, rng, simulation_index, min_max_stats_lst, chance_logits):
+    # One simulation with a random model, except for the chance policies, which are the fixed ``chance_logits``.
+    results = stochastic_mz_tree.ResultsWrapper(num=batch_size)
+    num_chance_leaves, _, _, last_actions, virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
+        roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1 for _ in range(batch_size)]
+    )
+    stochastic_mz_tree.batch_backpropagate(
+        simulation_index + 1, discount_factor,
+        rng.randn(batch_size).astype(np.float32),
+        rng.randn(batch_size).astype(np.float32),
+        np.tile(chance_logits, (num_chance_leaves, 1)).astype(np.float32),
+        rng.randn(batch_size - num_chance_leaves, action_space_size).astype(np.float32), min_max_stats_lst, results,
+        virtual_to_play_batch
+    )
+    return num_chance_leaves, last_actions
+
+
+@pytest.mark.unittest
+def test_chance_outcome_records():
+    # An expanded chance node samples its outcomes from the softmax of the chance policy, and its decision nodes are
+    # only created for the sampled codes, so the search keeps visiting every chance code of the distribution.
+    rng = np.random.RandomState(0)
+    num_simulations = 200
+    chance_logits = rng.randn(chance_space_size)
+    roots = prepare_roots(rng, [[0] for _ in range(batch_size)])
+    min_max_stats_lst = stochastic_mz_tree.MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+
+    sampled_codes = []
+    for simulation_index in range(num_simulations):
+        num_chance_leaves, last_actions = simulate(roots, rng, simulation_index, min_max_stats_lst, chance_logits)
+        if simulation_index == 1:
+            # the chance nodes below the roots are expanded in the first simulation, the second one samples a code
+            # from each of them and stops at its new decision node.
+            assert num_chance_leaves == 0
+            sampled_codes += last_actions
+
+    assert all(0 <= code < chance_space_size for code in sampled_codes)
+    for i in range(batch_size):
+        np.testing.assert_allclose(roots.get_outcome_priors(i, 0), softmax(chance_logits), rtol=1e-5)
+    assert roots.get_distributions() == [[num_simulations] for _ in range(batch_size)]
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('chance_top_k, chance_prob_mass', [(1, 1.), (3, 1.), (0, 0.5), (2, 0.9)])
+def test_chance_truncation(chance_top_k, chance_prob_mass):
+    # A truncated chance node samples its most probable outcomes with renormalized priors, and it adds the next most
+    # probable outcome once the outcome is expected to be sampled at least once, i.e. once visit count * prior >= 1.
+    rng = np.random.RandomState(chance_top_k)
+    num_simulations = 100
+    chance_logits = 2 * rng.randn(chance_space_size)
+    roots = prepare_roots(rng, [[0] for _ in range(batch_size)], chance_top_k, chance_prob_mass)
+    min_max_stats_lst = stochastic_mz_tree.MinMaxStatsList(batch_size)
+    min_max_stats_lst.set_delta(0.01)
+
+    priors = softmax(chance_logits).astype(np.float32)
+    order = np.argsort(-priors, kind='stable')
+    num_outcomes = np.searchsorted(np.cumsum(priors[order]), chance_prob_mass) + 1
+    if chance_top_k > 0:
+        num_outcomes = min(num_outcomes, chance_top_k)
+    num_outcomes = min(max(num_outcomes, 1), chance_space_size)
+    initial_num_outcomes = num_outcomes
+
+    for simulation_index in range(num_simulations):
+        # the chance node below each root is expanded in the first simulation and visited by every later one, so its
+        # visit count is simulation_index when it is traversed.
+        if simulation_index > 0 and num_outcomes < chance_space_size and \
+                np.float32(simulation_index) * priors[order[num_outcomes]] >= 1.:
+            num_outcomes += 1
+        simulate(roots, rng, simulation_index, min_max_stats_lst, chance_logits)
+
+        expected_priors = np.zeros(chance_space_size)
+        expected_priors[order[:num_outcomes]] = priors[order[:num_outcomes]] / priors[order[:num_outcomes]].sum()
+        for i in range(batch_size):
+            np.testing.assert_allclose(roots.get_outcome_priors(i, 0), expected_priors, rtol=1e-5, atol=1e-7)
+
+    # the most probable outcomes that were truncated are added in the search.
+    assert initial_num_outcomes < num_outcomes < chance_space_size
+
+
+def deterministic_search(roots, root_latent_states, num_simulations):
+    # A search with a deterministic model: the latent state of a leaf is a hash of the latent state of its parent and
+    # of the sampled chance code, and the outputs only depend on the latent state. The chance policies put all the mass
+    # on one code, so that the sampling of the chance nodes is deterministic too. The first selection of a decision node
+    # breaks the ties of its unvisited children at random, so the decision policies are uniform and the outputs do not
+    # depend on the decision actions: the statistics of the tree do not depend on how the ties are broken.
+    num = roots.num
+    min_max_stats_lst = stochastic_mz_tree.MinMaxStatsList(num)
+    min_max_stats_lst.set_delta(0.01)
+    latent_state_batch_in_search_path = [np.asarray(root_latent_states)]
+    for simulation_index in range(num_simulations):
+        results = stochastic_mz_tree.ResultsWrapper(num=num)
+        num_chance_leaves, latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, \
+            virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
+                roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results, [-1 for _ in range(num)]
+            )
+        # the leaves are in the grouped order: the chance leaves come first, and the last action of a decision leaf
+        # is a chance code.
+        latent_states = np.array(
+            [
+                (latent_state_batch_in_search_path[ix][iy] * 31 + (1 if leaf < num_chance_leaves else 7 * code + 2)) %
+                1000003 for leaf, (ix, iy, code) in
+                enumerate(zip(latent_state_index_in_search_path, latent_state_index_in_batch, last_actions))
+            ]
+        )
+        latent_state_batch_in_search_path.append(latent_states)
+        outputs = [np.random.RandomState(latent_state).randn(2) for latent_state in latent_states]
+        chance_policies = np.full((num_chance_leaves, chance_space_size), -50.)
+        chance_policies[np.arange(num_chance_leaves), latent_states[:num_chance_leaves] % chance_space_size] = 50.
+        stochastic_mz_tree.batch_backpropagate(
+            simulation_index + 1, discount_factor,
+            np.array([output[0] for output in outputs], dtype=np.float32),
+            np.array([output[1] for output in outputs], dtype=np.float32), chance_policies.astype(np.float32),
+            np.zeros((num - num_chance_leaves, action_space_size), dtype=np.float32), min_max_stats_lst, results,
+            virtual_to_play_batch
+        )
+        yield num_chance_leaves
+
+
+@pytest.mark.unittest
+def test_grouped_batch_matches_single_roots():
+    # The grouped traversal and the one-pass backpropagation of a batch whose leaves mix chance and decision nodes
+    # must give the same statistics as searching each root alone, where the grouping is the identity.
+    rng = np.random.RandomState(0)
+    num_simulations = 50
+    root_latent_states = np.arange(1, batch_size + 1)
+    root_policies = rng.randn(batch_size, action_space_size).tolist()
+    # the roots only have one legal action, so that their first selection does not break ties at random.
+    legal_actions = [[0] for _ in range(batch_size)]
+
+    roots = stochastic_mz_tree.Roots(batch_size, legal_actions, chance_space_size)
+    roots.prepare_no_noise([0. for _ in range(batch_size)], root_policies, [-1 for _ in range(batch_size)])
+    nums_chance_leaves = list(deterministic_search(roots, root_latent_states, num_simulations))
+    # the batches do mix both kinds of leaves.
+    assert any(0 < num_chance_leaves < batch_size for num_chance_leaves in nums_chance_leaves)
+
+    for i in range(batch_size):
+        single_root = stochastic_mz_tree.Roots(1, legal_actions[i:i + 1], chance_space_size)
+        single_root.prepare_no_noise([0.], root_policies[i:i + 1], [-1])
+        list(deterministic_search(single_root, root_latent_states[i:i + 1], num_simulations))
+        assert single_root.get_distributions()[0] == roots.get_distributions()[i]
+        np.testing.assert_allclose(single_root.get_values()[0], roots.get_values()[i], rtol=1e-5)
@@ -1,5 +1,6 @@
 import copy
-from typing import TYPE_CHECKING, List, Any, Union
+import time
+from typing import TYPE_CHECKING, List, Any, Optional, Tuple, Union
 
 import numpy as np
 import torch
@@ -41,6 +42,20 @@ class MuZeroMCTSCtree(object):
         pb_c_init=1.25,
         # (float) The maximum change in value allowed during the backup step of the search tree update.
         value_delta_max=0.01,
+        # (bool) Whether to decode the categorical value/reward logits of the model inside ``batch_backpropagate`` in C++
+        # instead of by ``InverseScalarTransform`` in torch. Only used when ``model.categorical_distribution`` is True.
+        ctree_categorical_decoding=False,
+        # (int) The wall-clock budget of a search in microseconds, checked between simulations: the search stops at
+        # ``num_simulations`` or at this budget, whichever comes first. 0 disables it.
+        ctree_time_budget_us=0,
+        # (bool) Whether to retire a root once the remaining simulations of its budget cannot change its most visited
+        # child, or once its visit entropy is below ``ctree_retire_entropy_threshold``. The leaves of the retired roots
+        # drop out of the following ``recurrent_inference`` batches, and the search stops when all the roots are retired.
+        ctree_adaptive_budget=False,
+        # (float) The visit entropy (in nats) of the children of a root under which the root retires. 0 disables it.
+        ctree_retire_entropy_threshold=0.,
+        # (int) The number of simulations of a root before it can retire by ``ctree_retire_entropy_threshold``.
+        ctree_retire_min_simulations=0,
     )
 
     @classmethod
@@ -76,23 +91,45 @@ class MuZeroMCTSCtree(object):
         )
 
     @classmethod
-    def roots(cls: int, active_collect_env_num: int, legal_actions: List[Any]) -> "mz_ctree":
+    def roots(cls: int, active_collect_env_num: int, legal_actions: Union[List[Any], np.ndarray]) -> "mz_ctree":
         """
         Overview:
             Initializes a batch of roots to search parallelly later.
         Arguments:
             - root_num (:obj:`int`): the number of the roots in a batch.
-            - legal_action_list (:obj:`List[Any]`): the vector of the legal actions for the roots.
+            - legal_action_list (:obj:`Union[List[Any], np.ndarray]`): the vector of the legal actions for the roots, \
+                or a (root_num, action_space_size) action mask whose nonzero entries are legal, from which the legal \
+                actions are built in C++.
 
         ..note::
             The initialization is achieved by the ``Roots`` class from the ``ctree_muzero`` module.
         """
         return tree_muzero.Roots(active_collect_env_num, legal_actions)
 
+    @classmethod
+    def reset_roots(cls: int, roots: Optional["mz_ctree.Roots"], root_num: int,
+                    action_mask: Union[np.ndarray, List[Any]]) -> "mz_ctree.Roots":
+        """
+        Overview:
+            Reinitialize a batch of roots in place so that the storage allocated by the last search is reused.
+        Arguments:
+            - roots (:obj:`Optional[mz_ctree.Roots]`): the roots of the last search, or None to create new ones.
+            - root_num (:obj:`int`): the number of the roots in a batch.
+            - action_mask (:obj:`Union[np.ndarray, List[Any]]`): the legal action mask of shape \
+                (root_num, action_space_size), whose nonzero entries are legal.
+        Returns:
+            - roots (:obj:`mz_ctree.Roots`): the reinitialized roots.
+        """
+        if roots is None:
+            roots = tree_muzero.Roots(0, [])
+        roots.reset(root_num, np.asarray(action_mask))
+        return roots
+
     def search(
             self, roots: Any, model: torch.nn.Module, latent_state_roots: List[Any], to_play_batch: Union[int,
-            List[Any]]
-    ) -> None:
+            List[Any]], time_budget_us: Optional[int] = None, budgets: Optional[List[int]] = None,
+            adaptive_budget: Optional[bool] = None
+    ) -> int:
         """
         Overview:
             Do MCTS for a batch of roots. Parallel in model inference. \
@@ -102,6 +139,15 @@ class MuZeroMCTSCtree(object):
             - latent_state_roots (:obj:`list`): the hidden states of the roots.
             - model (:obj:`torch.nn.Module`): The model used for inference.
             - to_play (:obj:`list`): the to_play list used in in self-play-mode board games.
+            - time_budget_us (:obj:`Optional[int]`): the wall-clock budget of the search in microseconds, \
+                ``ctree_time_budget_us`` if None. The roots keep the visits of the simulations run before it ran out.
+            - budgets (:obj:`Optional[List[int]]`): the maximum number of simulations of each root, capped by \
+                ``num_simulations``. If not None, the roots retire early as if ``adaptive_budget`` were True. \
+                A root with a budget of 0 or less runs no simulation, and any other root runs at least one.
+            - adaptive_budget (:obj:`Optional[bool]`): whether the roots retire early, \
+                ``ctree_adaptive_budget`` if None.
+        Returns:
+            - num_simulations_done (:obj:`int`): the number of simulations run.
 
         .. note::
             The core functions ``batch_traverse`` and ``batch_backpropagate`` are implemented in C++.
@@ -118,14 +164,35 @@ class MuZeroMCTSCtree(object):
             # minimax value storage
             min_max_stats_lst = tree_muzero.MinMaxStatsList(batch_size)
             min_max_stats_lst.set_delta(self._cfg.value_delta_max)
-
+            # a result wrapper to transport results between python and c++ parts, reset in place every simulation
+            results = tree_muzero.ResultsWrapper(num=batch_size)
+            # the half width of the categorical support if the value/reward logits are decoded in C++, otherwise 0
+            support_size = self._cfg.model.support_scale if (
+                self._cfg.ctree_categorical_decoding and self._cfg.model.categorical_distribution
+            ) else 0
+            if time_budget_us is None:
+                time_budget_us = self._cfg.ctree_time_budget_us
+            deadline = time.perf_counter() + time_budget_us * 1e-6 if time_budget_us > 0 else None
+            # the retired roots are skipped by ``batch_traverse``, so that the batches only hold the leaves of the active roots.
+            if adaptive_budget is None:
+                adaptive_budget = self._cfg.ctree_adaptive_budget
+            adaptive_budget = adaptive_budget or budgets is not None
+            if adaptive_budget:
+                roots.set_budgets(budgets if budgets is not None else [self._cfg.num_simulations] * batch_size)
+
+            num_simulations_done = 0
             for simulation_index in range(self._cfg.num_simulations):
                 # In each simulation, we expanded a new node, so in one search, we have ``num_simulations`` num of nodes at most.
+                # Past the deadline, no simulation starts after the first one.
+                if deadline is not None and simulation_index > 0 and time.perf_counter() >= deadline:
+                    break
+                if adaptive_budget and roots.num_active == 0:
+                    break
 
                 latent_states = []
 
-                # prepare a result wrapper to transport results between python and c++ parts
-                results = tree_muzero.ResultsWrapper(num=batch_size)
+                # clear the results of the last simulation
+                results.reset()
 
                 # latent_state_index_in_search_path: the first index of leaf node states in latent_state_batch_in_search_path, i.e. is current_latent_state_index in one the search.
                 # latent_state_index_in_batch: the second index of leaf node states in latent_state_batch_in_search_path, i.e. the index in the batch, whose maximum is ``batch_size``.
@@ -166,13 +233,18 @@ class MuZeroMCTSCtree(object):
 
                 network_output.latent_state = to_detach_cpu_numpy(network_output.latent_state)
                 network_output.policy_logits = to_detach_cpu_numpy(network_output.policy_logits)
-                network_output.value = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value))
-                network_output.reward = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.reward))
+                if support_size > 0:
+                    # the raw categorical logits are decoded to scalars inside ``batch_backpropagate``.
+                    reward_batch = np.ascontiguousarray(to_detach_cpu_numpy(network_output.reward), dtype=np.float32)
+                    value_batch = np.ascontiguousarray(to_detach_cpu_numpy(network_output.value), dtype=np.float32)
+                else:
+                    network_output.value = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value))
+                    network_output.reward = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.reward))
+                    # tolist() is to be compatible with cpp datatype.
+                    reward_batch = network_output.reward.reshape(-1).tolist()
+                    value_batch = network_output.value.reshape(-1).tolist()
 
                 latent_state_batch_in_search_path.append(network_output.latent_state)
-                # tolist() is to be compatible with cpp datatype.
-                reward_batch = network_output.reward.reshape(-1).tolist()
-                value_batch = network_output.value.reshape(-1).tolist()
                 policy_logits_batch = network_output.policy_logits.tolist()
 
                 # In ``batch_backpropagate()``, we first expand the leaf node using ``the policy_logits`` and
@@ -183,8 +255,15 @@ class MuZeroMCTSCtree(object):
                 current_latent_state_index = simulation_index + 1
                 tree_muzero.batch_backpropagate(
                     current_latent_state_index, discount_factor, reward_batch, value_batch, policy_logits_batch,
-                    min_max_stats_lst, results, virtual_to_play_batch
+                    min_max_stats_lst, results, virtual_to_play_batch, support_size
                 )
+                num_simulations_done += 1
+                if adaptive_budget:
+                    roots.update_active(
+                        self._cfg.ctree_retire_entropy_threshold, self._cfg.ctree_retire_min_simulations
+                    )
+
+        return num_simulations_done
 
 
 class EfficientZeroMCTSCtree(object):
@@ -212,6 +291,12 @@ class EfficientZeroMCTSCtree(object):
         pb_c_init=1.25,
         # (float) The maximum change in value allowed during the backup step of the search tree update.
         value_delta_max=0.01,
+        # (bool) Whether to decode the categorical value/reward logits of the model inside ``batch_backpropagate`` in C++
+        # instead of by ``InverseScalarTransform`` in torch. Only used when ``model.categorical_distribution`` is True.
+        ctree_categorical_decoding=False,
+        # (int) The wall-clock budget of a search in microseconds, checked between simulations: the search stops at
+        # ``num_simulations`` or at this budget, whichever comes first. 0 disables it.
+        ctree_time_budget_us=0,
     )
 
     @classmethod
@@ -245,15 +330,20 @@ class EfficientZeroMCTSCtree(object):
         self.inverse_scalar_transform_handle = InverseScalarTransform(
             self._cfg.model.support_scale, self._cfg.device, self._cfg.model.categorical_distribution
         )
+        # The roots of ``ctree_efficientzero`` have no simulation budgets, so the search cannot retire them early.
+        if self._cfg.get('ctree_adaptive_budget', False):
+            raise ValueError('ctree_adaptive_budget is only supported by MuZeroMCTSCtree')
 
     @classmethod
-    def roots(cls: int, active_collect_env_num: int, legal_actions: List[Any]) -> "ez_ctree.Roots":
+    def roots(cls: int, active_collect_env_num: int, legal_actions: Union[List[Any], np.ndarray]) -> "ez_ctree.Roots":
         """
         Overview:
             Initializes a batch of roots to search parallelly later.
         Arguments:
             - root_num (:obj:`int`): the number of the roots in a batch.
-            - legal_action_list (:obj:`List[Any]`): the vector of the legal actions for the roots.
+            - legal_action_list (:obj:`Union[List[Any], np.ndarray]`): the vector of the legal actions for the roots, \
+                or a (root_num, action_space_size) action mask whose nonzero entries are legal, from which the legal \
+                actions are built in C++.
         
         ..note::
             The initialization is achieved by the ``Roots`` class from the ``ctree_efficientzero`` module.
@@ -263,10 +353,30 @@ class EfficientZeroMCTSCtree(object):
         print(f"Memory usage before Roots creation: {psutil.virtual_memory().percent}%")
         return tree_efficientzero.Roots(active_collect_env_num, legal_actions)
 
+    @classmethod
+    def reset_roots(cls: int, roots: Optional["ez_ctree.Roots"], root_num: int,
+                    action_mask: Union[np.ndarray, List[Any]]) -> "ez_ctree.Roots":
+        """
+        Overview:
+            Reinitialize a batch of roots in place so that the storage allocated by the last search is reused.
+        Arguments:
+            - roots (:obj:`Optional[ez_ctree.Roots]`): the roots of the last search, or None to create new ones.
+            - root_num (:obj:`int`): the number of the roots in a batch.
+            - action_mask (:obj:`Union[np.ndarray, List[Any]]`): the legal action mask of shape \
+                (root_num, action_space_size), whose nonzero entries are legal.
+        Returns:
+            - roots (:obj:`ez_ctree.Roots`): the reinitialized roots.
+        """
+        if roots is None:
+            roots = tree_efficientzero.Roots(0, [])
+        roots.reset(root_num, np.asarray(action_mask))
+        return roots
+
     def search(
             self, roots: Any, model: torch.nn.Module, latent_state_roots: List[Any],
-            reward_hidden_state_roots: List[Any], to_play_batch: Union[int, List[Any]]
-    ) -> None:
+            reward_hidden_state_roots: List[Any], to_play_batch: Union[int, List[Any]],
+            time_budget_us: Optional[int] = None
+    ) -> int:
         """
         Overview:
             Do MCTS for a batch of roots. Parallel in model inference. \
@@ -277,7 +387,11 @@ class EfficientZeroMCTSCtree(object):
             - reward_hidden_state_roots (:obj:`list`): the value prefix hidden states in LSTM of the roots.
             - model (:obj:`torch.nn.Module`): The model used for inference.
             - to_play (:obj:`list`): the to_play list used in in self-play-mode board games.
-        
+            - time_budget_us (:obj:`Optional[int]`): the wall-clock budget of the search in microseconds, \
+                ``ctree_time_budget_us`` if None. The roots keep the visits of the simulations run before it ran out.
+        Returns:
+            - num_simulations_done (:obj:`int`): the number of simulations run.
+
         .. note::
             The core functions ``batch_traverse`` and ``batch_backpropagate`` are implemented in C++.
         """
@@ -297,16 +411,29 @@ class EfficientZeroMCTSCtree(object):
             # minimax value storage
             min_max_stats_lst = tree_efficientzero.MinMaxStatsList(batch_size)
             min_max_stats_lst.set_delta(self._cfg.value_delta_max)
-
+            # a result wrapper to transport results between python and c++ parts, reset in place every simulation
+            results = tree_efficientzero.ResultsWrapper(num=batch_size)
+            # the half width of the categorical support if the value/reward logits are decoded in C++, otherwise 0
+            support_size = self._cfg.model.support_scale if (
+                self._cfg.ctree_categorical_decoding and self._cfg.model.categorical_distribution
+            ) else 0
+            if time_budget_us is None:
+                time_budget_us = self._cfg.ctree_time_budget_us
+            deadline = time.perf_counter() + time_budget_us * 1e-6 if time_budget_us > 0 else None
+
+            num_simulations_done = 0
             for simulation_index in range(self._cfg.num_simulations):
                 # In each simulation, we expanded a new node, so in one search, we have ``num_simulations`` num of nodes at most.
+                # Past the deadline, no simulation starts after the first one.
+                if deadline is not None and simulation_index > 0 and time.perf_counter() >= deadline:
+                    break
 
                 latent_states = []
                 hidden_states_c_reward = []
                 hidden_states_h_reward = []
 
-                # prepare a result wrapper to transport results between python and c++ parts
-                results = tree_efficientzero.ResultsWrapper(num=batch_size)
+                # clear the results of the last simulation
+                results.reset()
 
                 # latent_state_index_in_search_path: the first index of leaf node states in latent_state_batch_in_search_path, i.e. is current_latent_state_index in one the search.
                 # latent_state_index_in_batch: the second index of leaf node states in latent_state_batch_in_search_path, i.e. the index in the batch, whose maximum is ``batch_size``.
@@ -356,8 +483,18 @@ class EfficientZeroMCTSCtree(object):
 
                 network_output.latent_state = to_detach_cpu_numpy(network_output.latent_state)
                 network_output.policy_logits = to_detach_cpu_numpy(network_output.policy_logits)
-                network_output.value = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value))
-                network_output.value_prefix = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value_prefix))
+                if support_size > 0:
+                    # the raw categorical logits are decoded to scalars inside ``batch_backpropagate``.
+                    value_prefix_batch = np.ascontiguousarray(
+                        to_detach_cpu_numpy(network_output.value_prefix), dtype=np.float32
+                    )
+                    value_batch = np.ascontiguousarray(to_detach_cpu_numpy(network_output.value), dtype=np.float32)
+                else:
+                    network_output.value = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value))
+                    network_output.value_prefix = to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value_prefix))
+                    # tolist() is to be compatible with cpp datatype.
+                    value_prefix_batch = network_output.value_prefix.reshape(-1).tolist()
+                    value_batch = network_output.value.reshape(-1).tolist()
 
                 network_output.reward_hidden_state = (
                     network_output.reward_hidden_state[0].detach().cpu().numpy(),
@@ -365,9 +502,6 @@ class EfficientZeroMCTSCtree(object):
                 )
 
                 latent_state_batch_in_search_path.append(network_output.latent_state)
-                # tolist() is to be compatible with cpp datatype.
-                value_prefix_batch = network_output.value_prefix.reshape(-1).tolist()
-                value_batch = network_output.value.reshape(-1).tolist()
                 policy_logits_batch = network_output.policy_logits.tolist()
 
                 reward_latent_state_batch = network_output.reward_hidden_state
@@ -390,8 +524,11 @@ class EfficientZeroMCTSCtree(object):
                 current_latent_state_index = simulation_index + 1
                 tree_efficientzero.batch_backpropagate(
                     current_latent_state_index, discount_factor, value_prefix_batch, value_batch, policy_logits_batch,
-                    min_max_stats_lst, results, is_reset_list, virtual_to_play_batch
+                    min_max_stats_lst, results, is_reset_list, virtual_to_play_batch, support_size
                 )
+                num_simulations_done += 1
+
+        return num_simulations_done
 
 
 class GumbelMuZeroMCTSCtree(object):
@@ -449,20 +586,61 @@ class GumbelMuZeroMCTSCtree(object):
         self.inverse_scalar_transform_handle = InverseScalarTransform(
             self._cfg.model.support_scale, self._cfg.device, self._cfg.model.categorical_distribution
         )
+        # The sequential halving of Gumbel MuZero is scheduled for the full ``num_simulations``, so the search can
+        # neither stop at a time budget nor retire its roots early.
+        if self._cfg.get('ctree_time_budget_us', 0) > 0 or self._cfg.get('ctree_adaptive_budget', False):
+            raise ValueError(
+                'ctree_time_budget_us and ctree_adaptive_budget are not supported by GumbelMuZeroMCTSCtree'
+            )
     
     @classmethod
-    def roots(cls: int, active_collect_env_num: int, legal_actions: List[Any]) -> "gmz_ctree":
+    def roots(cls: int, active_collect_env_num: int, legal_actions: Union[List[Any], np.ndarray],
+              gumbel_seeds: Optional[List[int]] = None) -> "gmz_ctree":
         """
         Overview:
             Initializes a batch of roots to search parallelly later.
         Arguments:
             - root_num (:obj:`int`): the number of the roots in a batch.
-            - legal_action_list (:obj:`List[Any]`): the vector of the legal actions for the roots.
+            - legal_action_list (:obj:`Union[List[Any], np.ndarray]`): the vector of the legal actions for the roots, \
+                or a (root_num, action_space_size) action mask whose nonzero entries are legal, from which the legal \
+                actions are built in C++.
+            - gumbel_seeds (:obj:`Optional[List[int]]`): the seed of the gumbel noise of each root. \
+                If None, the seeds are drawn from ``np.random``, so that the roots get distinct noise.
         
         ..note::
-            The initialization is achieved by the ``Roots`` class from the ``ctree_gumbel_muzero`` module.
+            The initialization is achieved by the ``Roots`` class from the ``ctree_gumbel_muzero`` module. \
+            The gumbel noise is only generated for the roots, lazily at the first traversal of the search.
+        """
+        roots = tree_gumbel_muzero.Roots(active_collect_env_num, legal_actions)
+        if gumbel_seeds is None:
+            gumbel_seeds = np.random.randint(0, 2 ** 31 - 1, size=active_collect_env_num).tolist()
+        roots.set_gumbel_seeds(gumbel_seeds)
+        return roots
+
+    @classmethod
+    def get_root_outputs(cls: int, roots: "gmz_ctree.Roots", discount_factor: float,
+                         action_space_size: int) -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+        """
+        Overview:
+            Export the search results of a batch of roots into dense numpy arrays with a single call into C++.
+        Arguments:
+            - roots (:obj:`gmz_ctree.Roots`): a batch of searched root nodes.
+            - discount_factor (:obj:`float`): the discount factor of reward.
+            - action_space_size (:obj:`int`): the action space size of environment.
+        Returns:
+            - visit_counts (:obj:`np.ndarray`): the visit counts of the children, 0 for illegal actions, shape (B, A).
+            - values (:obj:`np.ndarray`): the searched value of each root, shape (B, ).
+            - improved_policies (:obj:`np.ndarray`): the improved policy of each root, same as ``roots.get_policies``, \
+                shape (B, A).
+            - completed_values (:obj:`np.ndarray`): the completed value of the children, -inf for illegal actions, \
+                same as ``roots.get_children_values``, shape (B, A).
         """
-        return tree_gumbel_muzero.Roots(active_collect_env_num, legal_actions)
+        improved_policies = np.zeros((roots.num, action_space_size), dtype=np.float32)
+        completed_values = np.zeros((roots.num, action_space_size), dtype=np.float32)
+        visit_counts = np.zeros((roots.num, action_space_size), dtype=np.int32)
+        values = np.zeros(roots.num, dtype=np.float32)
+        roots.get_root_outputs(discount_factor, improved_policies, completed_values, visit_counts, values)
+        return visit_counts, values, improved_policies, completed_values
 
     def search(self, roots: Any, model: torch.nn.Module, latent_state_roots: List[Any], to_play_batch: Union[int,
                                                                                                           List[Any]]
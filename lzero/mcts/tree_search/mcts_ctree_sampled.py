@@ -1,5 +1,5 @@
 import copy
-from typing import TYPE_CHECKING, List, Any, Union
+from typing import TYPE_CHECKING, List, Any, Tuple, Union
 
 import numpy as np
 import torch
@@ -74,7 +74,7 @@ class SampledEfficientZeroMCTSCtree(object):
 
     @classmethod
     def roots(
-            cls: int, root_num: int, legal_action_lis: List[Any], action_space_size: int, num_of_sampled_actions: int,
+            cls: int, root_num: int, legal_action_lis: Union[List[Any], np.ndarray], action_space_size: int, num_of_sampled_actions: int,
             continuous_action_space: bool
     ) -> "ezs_ctree.Roots":
         """
@@ -82,7 +82,9 @@ class SampledEfficientZeroMCTSCtree(object):
             Initializes a batch of roots to search parallelly later.
         Arguments:
             - root_num (:obj:`int`): the number of the roots in a batch.
-            - legal_action_list (:obj:`List[Any]`): the vector of the legal actions for the roots.
+            - legal_action_list (:obj:`Union[List[Any], np.ndarray]`): the vector of the legal actions for the roots, \
+                or a (root_num, action_space_size) action mask whose nonzero entries are legal, from which the legal \
+                actions are built in C++.
             - action_space_size (:obj:'int'): the size of action space of the current env.
             - num_of_sampled_actions (:obj:'int'): the number of sampled actions, i.e. K in the Sampled MuZero paper.
             - continuous_action_space (:obj:'bool'): whether the action space is continous in current env.
@@ -94,6 +96,30 @@ class SampledEfficientZeroMCTSCtree(object):
             root_num, legal_action_lis, action_space_size, num_of_sampled_actions, continuous_action_space
         )
 
+    @classmethod
+    def get_root_outputs(cls: int, roots: "ezs_ctree.Roots", num_of_sampled_actions: int,
+                         action_dim: int) -> Tuple[np.ndarray, np.ndarray, np.ndarray, np.ndarray]:
+        """
+        Overview:
+            Export the search results of a batch of roots into numpy arrays with a single call into C++.
+        Arguments:
+            - roots (:obj:`ezs_ctree.Roots`): a batch of searched root nodes.
+            - num_of_sampled_actions (:obj:'int'): the number of sampled actions, i.e. K in the Sampled MuZero paper.
+            - action_dim (:obj:'int'): the dimension of each sampled action, i.e. 1 for the discrete action space.
+        Returns:
+            - sampled_actions (:obj:`np.ndarray`): the sampled actions of each root, shape (B, K, D). \
+                The invalid slots are padded with the last valid sampled action.
+            - visit_counts (:obj:`np.ndarray`): the visit counts of the sampled actions, shape (B, K).
+            - values (:obj:`np.ndarray`): the searched value of each root, shape (B, ).
+            - valid_masks (:obj:`np.ndarray`): the mask of the valid sampled actions, shape (B, K).
+        """
+        sampled_actions = np.zeros((roots.num, num_of_sampled_actions, action_dim), dtype=np.float32)
+        visit_counts = np.zeros((roots.num, num_of_sampled_actions), dtype=np.int32)
+        values = np.zeros(roots.num, dtype=np.float32)
+        valid_masks = np.zeros((roots.num, num_of_sampled_actions), dtype=np.uint8)
+        roots.get_root_outputs(sampled_actions, visit_counts, values, valid_masks)
+        return sampled_actions, visit_counts, values, valid_masks
+
     def search(
             self, roots: Any, model: torch.nn.Module, latent_state_roots: List[Any],
             reward_hidden_state_roots: List[Any], to_play_batch: Union[int, List[Any]]
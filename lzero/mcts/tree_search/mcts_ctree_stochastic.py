@@ -5,7 +5,7 @@ import numpy as np
 import torch
 from easydict import EasyDict
 
-from lzero.policy import InverseScalarTransform
+from lzero.policy import InverseScalarTransform, to_detach_cpu_numpy
 from lzero.mcts.ctree.ctree_stochastic_muzero import stochastic_mz_tree
 
 
@@ -34,6 +34,11 @@ class StochasticMuZeroMCTSCtree(object):
         pb_c_init=1.25,
         # (float) The maximum change in value allowed during the backup step of the search tree update.
         value_delta_max=0.01,
+        # (int) If > 0, each chance node only materializes its top-k most probable outcomes at first.
+        chance_top_k=0,
+        # (float) Each chance node only materializes the smallest set of its most probable outcomes covering this
+        # probability mass at first, 1.0 means no truncation.
+        chance_prob_mass=1.0,
     )
 
     @classmethod
@@ -69,14 +74,16 @@ class StochasticMuZeroMCTSCtree(object):
         )
 
     @classmethod
-    def roots(cls: int, active_collect_env_num: int, legal_actions: List[Any],
+    def roots(cls: int, active_collect_env_num: int, legal_actions: Union[List[Any], np.ndarray],
               chance_space_size: int = 2) -> "stochastic_mz_tree.Roots":
         """
         Overview:
             Initializes a batch of roots to search parallelly later.
         Arguments:
             - root_num (:obj:`int`): the number of the roots in a batch.
-            - legal_action_list (:obj:`List[Any]`): the vector of the legal actions for the roots.
+            - legal_action_list (:obj:`Union[List[Any], np.ndarray]`): the vector of the legal actions for the roots, \
+                or a (root_num, action_space_size) action mask whose nonzero entries are legal, from which the legal \
+                actions are built in C++.
         
         ..note::
             The initialization is achieved by the ``Roots`` class from the ``ctree_stochastic_muzero`` module.
@@ -112,6 +119,8 @@ class StochasticMuZeroMCTSCtree(object):
             # minimax value storage
             min_max_stats_lst = stochastic_mz_tree.MinMaxStatsList(batch_size)
             min_max_stats_lst.set_delta(self._cfg.value_delta_max)
+            # the truncation of the chance outcomes, only affects the chance nodes expanded in this search
+            roots.set_chance_truncation(self._cfg.chance_top_k, self._cfg.chance_prob_mass)
 
             for simulation_index in range(self._cfg.num_simulations):
                 # In each simulation, we expanded a new node, so in one search, we have ``num_simulations`` num of nodes at most.
@@ -130,13 +139,13 @@ class StochasticMuZeroMCTSCtree(object):
                     Each simulation starts from the internal root state s0, and finishes when the simulation reaches a leaf node s_l.
                 """
                 if self._cfg.env_type == 'not_board_games':
-                    leaf_node_is_chance, latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
+                    num_chance_leaves, latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
                         roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results,
                         to_play_batch
                     )
                 else:
                     # the ``to_play_batch`` is only used in board games, here we need to deepcopy it to avoid changing the original data.
-                    leaf_node_is_chance, latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
+                    num_chance_leaves, latent_state_index_in_search_path, latent_state_index_in_batch, last_actions, virtual_to_play_batch = stochastic_mz_tree.batch_traverse(
                         roots, pb_c_base, pb_c_init, discount_factor, min_max_stats_lst, results,
                         copy.deepcopy(to_play_batch)
                     )
@@ -155,74 +164,28 @@ class StochasticMuZeroMCTSCtree(object):
                 MCTS stage 3: Backup
                     At the end of the simulation, the statistics along the trajectory are updated.
                 """
-                # network_output = model.recurrent_inference(latent_states, last_actions)
-
-                num = len(leaf_node_is_chance)
-                leaf_idx_list = list(range(num))
-                latent_state_batch = [None] * num
-                value_batch = [None] * num
-                reward_batch = [None] * num
-                policy_logits_batch = [None] * num
-                child_is_chance_batch = [None] * num
-                chance_nodes_index = []
-                decision_nodes_index = []
-
-                for i, leaf_node_is_chance_ in enumerate(leaf_node_is_chance):
-                    if leaf_node_is_chance_:
-                        chance_nodes_index.append(i)
-                    else:
-                        decision_nodes_index.append(i)
-
-                def process_nodes(nodes_index, is_chance):
-                    # Return early if nodes_index is empty
-                    if not nodes_index:
-                        return
-
-                    # Slice and stack latent_states and last_actions based on nodes_index
-                    latent_states_stack = torch.stack([latent_states[i] for i in nodes_index], dim=0)
-                    last_actions_stack = torch.stack([last_actions[i] for i in nodes_index], dim=0)
-
-                    # Pass the stacked batch through the recurrent_inference function
-                    network_output_batch = model.recurrent_inference(latent_states_stack,
-                                                                     last_actions_stack,
-                                                                     afterstate=not is_chance)
-
-                    # Split the batch output into separate nodes
-                    latent_state_splits = torch.split(network_output_batch.latent_state, 1, dim=0)
-                    value_splits = torch.split(network_output_batch.value, 1, dim=0)
-                    reward_splits = torch.split(network_output_batch.reward, 1, dim=0)
-                    policy_logits_splits = torch.split(network_output_batch.policy_logits, 1, dim=0)
-
-                    for i, (latent_state, value, reward, policy_logits) in zip(nodes_index,
-                                                                               zip(latent_state_splits, value_splits,
-                                                                                   reward_splits,
-                                                                                   policy_logits_splits)):
-                        if not model.training:
-                            value = self.inverse_scalar_transform_handle(value).detach().cpu().numpy()
-                            reward = self.inverse_scalar_transform_handle(reward).detach().cpu().numpy()
-                            latent_state = latent_state.detach().cpu().numpy()
-                            policy_logits = policy_logits.detach().cpu().numpy()
-
-                        latent_state_batch[i] = latent_state
-                        value_batch[i] = value.reshape(-1).tolist()
-                        reward_batch[i] = reward.reshape(-1).tolist()
-                        policy_logits_batch[i] = policy_logits.tolist()
-                        child_is_chance_batch[i] = is_chance
-
-                process_nodes(chance_nodes_index, True)
-                process_nodes(decision_nodes_index, False)
-                chance_nodes = chance_nodes_index
-                decision_nodes = decision_nodes_index
-
-                value_batch_chance = [value_batch[leaf_idx] for leaf_idx in chance_nodes]
-                value_batch_decision = [value_batch[leaf_idx] for leaf_idx in decision_nodes]
-                reward_batch_chance = [reward_batch[leaf_idx] for leaf_idx in chance_nodes]
-                reward_batch_decision = [reward_batch[leaf_idx] for leaf_idx in decision_nodes]
-                policy_logits_batch_chance = [policy_logits_batch[leaf_idx] for leaf_idx in chance_nodes]
-                policy_logits_batch_decision = [policy_logits_batch[leaf_idx] for leaf_idx in decision_nodes]
+                # The leaves are already grouped by ``batch_traverse``: the first ``num_chance_leaves`` leaves are
+                # chance nodes and the others are decision nodes, so each group is inferred with a contiguous slice.
+                latent_state_batch, value_batch, reward_batch, policy_logits_batch = [], [], [], [None, None]
+                for group, (leaf_slice, is_chance) in enumerate(
+                        [(slice(0, num_chance_leaves), True), (slice(num_chance_leaves, batch_size), False)]
+                ):
+                    if leaf_slice.start == leaf_slice.stop:
+                        continue
+                    network_output = model.recurrent_inference(
+                        latent_states[leaf_slice], last_actions[leaf_slice], afterstate=not is_chance
+                    )
+                    latent_state_batch.append(to_detach_cpu_numpy(network_output.latent_state))
+                    value_batch.append(to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.value)))
+                    reward_batch.append(to_detach_cpu_numpy(self.inverse_scalar_transform_handle(network_output.reward)))
+                    policy_logits_batch[group] = np.ascontiguousarray(
+                        to_detach_cpu_numpy(network_output.policy_logits), dtype=np.float32
+                    )
 
                 latent_state_batch = np.concatenate(latent_state_batch, axis=0)
                 latent_state_batch_in_search_path.append(latent_state_batch)
+                value_batch = np.ascontiguousarray(np.concatenate(value_batch, axis=0).reshape(-1), dtype=np.float32)
+                reward_batch = np.ascontiguousarray(np.concatenate(reward_batch, axis=0).reshape(-1), dtype=np.float32)
 
                 # In ``batch_backpropagate()``, we first expand the leaf node using ``the policy_logits`` and
                 # ``reward`` predicted by the model, then perform backpropagation along the search path to update the
@@ -231,21 +194,7 @@ class StochasticMuZeroMCTSCtree(object):
                 # NOTE: simulation_index + 1 is very important, which is the depth of the current leaf node.
                 current_latent_state_index = simulation_index + 1
 
-                if (len(chance_nodes) > 0):
-                    value_batch_chance = np.concatenate(value_batch_chance, axis=0).reshape(-1).tolist()
-                    reward_batch_chance = np.concatenate(reward_batch_chance, axis=0).reshape(-1).tolist()
-                    policy_logits_batch_chance = np.concatenate(policy_logits_batch_chance, axis=0).tolist()
-                    stochastic_mz_tree.batch_backpropagate(
-                        current_latent_state_index, discount_factor, reward_batch_chance, value_batch_chance,
-                        policy_logits_batch_chance,
-                        min_max_stats_lst, results, virtual_to_play_batch, child_is_chance_batch, chance_nodes
-                    )
-                if (len(decision_nodes) > 0):
-                    value_batch_decision = np.concatenate(value_batch_decision, axis=0).reshape(-1).tolist()
-                    reward_batch_decision = np.concatenate(reward_batch_decision, axis=0).reshape(-1).tolist()
-                    policy_logits_batch_decision = np.concatenate(policy_logits_batch_decision, axis=0).tolist()
-                    stochastic_mz_tree.batch_backpropagate(
-                        current_latent_state_index, discount_factor, reward_batch_decision, value_batch_decision,
-                        policy_logits_batch_decision,
-                        min_max_stats_lst, results, virtual_to_play_batch, child_is_chance_batch, decision_nodes
-                    )
+                stochastic_mz_tree.batch_backpropagate(
+                    current_latent_state_index, discount_factor, reward_batch, value_batch, policy_logits_batch[0],
+                    policy_logits_batch[1], min_max_stats_lst, results, virtual_to_play_batch
+                )
@@ -1,6 +1,6 @@
 import copy
 from collections import namedtuple
-from typing import List, Dict, Tuple
+from typing import Any, List, Dict, Optional, Tuple, Callable
 
 import numpy as np
 import torch.distributions
@@ -12,7 +12,7 @@ from ding.utils import POLICY_REGISTRY
 from ding.utils.data import default_collate
 from easydict import EasyDict
 
-from lzero.policy import configure_optimizers
+from lzero.policy import configure_optimizers, compute_policy_value_batch
 
 
 @POLICY_REGISTRY.register('alphazero')
@@ -98,6 +98,36 @@ class AlphaZeroPolicy(Policy):
             pb_c_base=19652,
             # (float) The initialization constant used in the PUCT formula for balancing exploration and exploitation during tree search.
             pb_c_init=1.25,
+            # (bool) Whether the C++ MCTS simulates the game natively instead of stepping the Python simulation env.
+            # Only used when ``mcts_ctree`` is True, for the tictactoe, connect4 and gomoku simulation envs.
+            ctree_native_game=False,
+            # (int) The number of leaves the C++ MCTS gathers with virtual loss and evaluates in one forward pass.
+            # Only used when ``mcts_ctree`` is True; 1 evaluates the leaves one by one.
+            ctree_leaf_batch_size=1,
+            # (bool) Whether the C++ MCTS keeps the subtree of the played move for the next search of the same env.
+            # Only used when ``mcts_ctree`` is True; the tree is only reused if the next state is the one reached by the
+            # move, e.g. in self_play_mode, and it is freed otherwise.
+            ctree_reuse_tree=False,
+            # (bool) Whether the C++ MCTS searches the states of all the ready envs together, evaluating the leaves of
+            # all the games in one forward pass per round. Only used when ``mcts_ctree`` and ``ctree_native_game`` are True.
+            ctree_batched_search=False,
+            # (bool) Whether the native C++ search caches the evaluation of the positions by their Zobrist hash, so that a
+            # position reached again by another move order is not evaluated again. Its nodes still keep their own visits
+            # and values. Only used when ``mcts_ctree`` and ``ctree_native_game`` are True.
+            ctree_evaluation_cache=False,
+            # (bool) Whether the native C++ search builds a graph of the positions instead of a tree: the nodes of a
+            # position reached by several move orders share its children and its visits and values, as in Monte-Carlo
+            # Graph Search, so that a position is evaluated once. The graph is rebuilt by every search. Only used when
+            # ``mcts_ctree`` and ``ctree_native_game`` are True, for the tictactoe, connect4 and gomoku simulation envs,
+            # with ``ctree_num_threads`` 0.
+            ctree_graph_search=False,
+            # (int) The number of threads the native C++ search runs its simulations on, sharing one tree; the calling
+            # thread evaluates their leaves in batches. 0 runs the simulations in the calling thread.
+            # Only used when ``mcts_ctree`` and ``ctree_native_game`` are True.
+            ctree_num_threads=0,
+            # (int) The wall-clock budget of a search of the C++ MCTS in microseconds, checked between batches of
+            # simulations; the search stops at ``num_simulations`` or at this budget, whichever comes first. 0 disables it.
+            ctree_time_budget_us=0,
         ),
         other=dict(replay_buffer=dict(
             replay_buffer_size=int(1e6),
@@ -221,17 +251,17 @@ class AlphaZeroPolicy(Policy):
         if self._cfg.mcts_ctree:
             import sys
             sys.path.append('/Users/your_user_name/code/LightZero/lzero/mcts/ctree/ctree_alphazero/build')
-            import mcts_alphazero
-            self._collect_mcts = mcts_alphazero.MCTS(self._cfg.mcts.max_moves, self._cfg.mcts.num_simulations,
-                                                     self._cfg.mcts.pb_c_base,
-                                                     self._cfg.mcts.pb_c_init, self._cfg.mcts.root_dirichlet_alpha,
-                                                     self._cfg.mcts.root_noise_weight, self.simulate_env)
+            self._collect_mcts = self._create_ctree_mcts(self._cfg.mcts.num_simulations)
+            self._collect_batched_mcts = self._create_ctree_batched_mcts(self._cfg.mcts.num_simulations)
         else:
             if self._cfg.sampled_algo:
                 from lzero.mcts.ptree.ptree_az_sampled import MCTS
             else:
                 from lzero.mcts.ptree.ptree_az import MCTS
             self._collect_mcts = MCTS(self._cfg.mcts, self.simulate_env)
+            self._collect_batched_mcts = None
+        # The MCTS of each env when ``mcts.ctree_reuse_tree`` is True, as every env needs its own search tree.
+        self._collect_mcts_per_env = {}
 
         self.collect_mcts_temperature = 1
 
@@ -255,15 +285,26 @@ class AlphaZeroPolicy(Policy):
         # If it's not present (which will raise a KeyError), None is used instead.
         # This approach is taken to maintain compatibility with the handling of 'katago' related parts of 'alphazero_mcts_ctree' in Go.
         katago_game_state = {env_id: obs[env_id].get('katago_game_state', None) for env_id in ready_env_id}
+        # The binary state of ``Game.get_state``, if the env provides it, resets the native game of the C++ MCTS.
+        native_game_state = {env_id: obs[env_id].get('native_game_state', None) for env_id in ready_env_id}
         start_player_index = {env_id: obs[env_id]['current_player_index'] for env_id in ready_env_id}
         output = {}
         self._policy_model = self._collect_model
+        if self._collect_batched_mcts is not None:
+            return self._forward_batched_search(
+                self._collect_batched_mcts, ready_env_id, init_state, start_player_index, self.collect_mcts_temperature,
+                True, native_game_state
+            )
         for env_id in ready_env_id:
             state_config_for_simulation_env_reset = EasyDict(dict(start_player_index=start_player_index[env_id],
                                                                   init_state=init_state[env_id],
                                                                   katago_policy_init=False,
-                                                                  katago_game_state=katago_game_state[env_id]))
-            action, mcts_probs = self._collect_mcts.get_next_action(state_config_for_simulation_env_reset, self._policy_value_fn, self.collect_mcts_temperature, True)
+                                                                  katago_game_state=katago_game_state[env_id],
+                                                                  native_game_state=native_game_state[env_id]))
+            mcts = self._get_env_mcts(self._collect_mcts, self._collect_mcts_per_env, env_id, self._cfg.mcts.num_simulations)
+            action, mcts_probs = mcts.get_next_action(state_config_for_simulation_env_reset, self._get_policy_value_fn(), self.collect_mcts_temperature, True)
+            if mcts is not self._collect_mcts:
+                mcts.update_with_move(action)
 
             output[env_id] = {
                 'action': action,
@@ -280,13 +321,9 @@ class AlphaZeroPolicy(Policy):
         if self._cfg.mcts_ctree:
             import sys
             sys.path.append('/Users/your_user_name/code/LightZero/lzero/mcts/ctree/ctree_alphazero/build')
-            import mcts_alphazero
             # TODO(pu): how to set proper num_simulations for evaluation
-            self._eval_mcts = mcts_alphazero.MCTS(self._cfg.mcts.max_moves,
-                                                  min(800, self._cfg.mcts.num_simulations * 4),
-                                                  self._cfg.mcts.pb_c_base,
-                                                  self._cfg.mcts.pb_c_init, self._cfg.mcts.root_dirichlet_alpha,
-                                                  self._cfg.mcts.root_noise_weight, self.simulate_env)
+            self._eval_mcts = self._create_ctree_mcts(min(800, self._cfg.mcts.num_simulations * 4))
+            self._eval_batched_mcts = self._create_ctree_batched_mcts(min(800, self._cfg.mcts.num_simulations * 4))
         else:
             if self._cfg.sampled_algo:
                 from lzero.mcts.ptree.ptree_az_sampled import MCTS
@@ -296,6 +333,9 @@ class AlphaZeroPolicy(Policy):
             # TODO(pu): how to set proper num_simulations for evaluation
             mcts_eval_config.num_simulations = min(800, mcts_eval_config.num_simulations * 4)
             self._eval_mcts = MCTS(mcts_eval_config, self.simulate_env)
+            self._eval_batched_mcts = None
+        # The MCTS of each env when ``mcts.ctree_reuse_tree`` is True, as every env needs its own search tree.
+        self._eval_mcts_per_env = {}
 
         self._eval_model = self._model
 
@@ -316,17 +356,29 @@ class AlphaZeroPolicy(Policy):
         # If it's not present (which will raise a KeyError), None is used instead.
         # This approach is taken to maintain compatibility with the handling of 'katago' related parts of 'alphazero_mcts_ctree' in Go.
         katago_game_state = {env_id: obs[env_id].get('katago_game_state', None) for env_id in ready_env_id}
+        # The binary state of ``Game.get_state``, if the env provides it, resets the native game of the C++ MCTS.
+        native_game_state = {env_id: obs[env_id].get('native_game_state', None) for env_id in ready_env_id}
         start_player_index = {env_id: obs[env_id]['current_player_index'] for env_id in ready_env_id}
         output = {}
         self._policy_model = self._eval_model
+        if self._eval_batched_mcts is not None:
+            return self._forward_batched_search(
+                self._eval_batched_mcts, ready_env_id, init_state, start_player_index, 1.0, False, native_game_state
+            )
         for env_id in ready_env_id:
             state_config_for_simulation_env_reset = EasyDict(dict(start_player_index=start_player_index[env_id],
                                                                   init_state=init_state[env_id],
                                                                   katago_policy_init=False,
-                                                                  katago_game_state=katago_game_state[env_id]))
-            action, mcts_probs = self._eval_mcts.get_next_action(
-                state_config_for_simulation_env_reset, self._policy_value_fn, 1.0, False
+                                                                  katago_game_state=katago_game_state[env_id],
+                                                                  native_game_state=native_game_state[env_id]))
+            mcts = self._get_env_mcts(
+                self._eval_mcts, self._eval_mcts_per_env, env_id, min(800, self._cfg.mcts.num_simulations * 4)
             )
+            action, mcts_probs = mcts.get_next_action(
+                state_config_for_simulation_env_reset, self._get_policy_value_fn(), 1.0, False
+            )
+            if mcts is not self._eval_mcts:
+                mcts.update_with_move(action)
             output[env_id] = {
                 'action': action,
                 'probs': mcts_probs,
@@ -367,6 +419,164 @@ class AlphaZeroPolicy(Policy):
         else:
             raise NotImplementedError
 
+    def _create_ctree_mcts(self, num_simulations: int) -> 'mcts_alphazero.MCTS':  # noqa
+        """
+        Overview:
+            Create a C++ MCTS instance with the ``mcts`` config and the given number of simulations.
+        Arguments:
+            - num_simulations (:obj:`int`): The number of simulations to perform at each move.
+        Returns:
+            - mcts (:obj:`mcts_alphazero.MCTS`): The C++ MCTS instance.
+        """
+        import mcts_alphazero
+        mcts = mcts_alphazero.MCTS(self._cfg.mcts.max_moves, num_simulations,
+                                   self._cfg.mcts.pb_c_base,
+                                   self._cfg.mcts.pb_c_init, self._cfg.mcts.root_dirichlet_alpha,
+                                   self._cfg.mcts.root_noise_weight, self.simulate_env,
+                                   leaf_batch_size=self._cfg.mcts.ctree_leaf_batch_size)
+        mcts.set_time_budget(self._cfg.mcts.ctree_time_budget_us)
+        if self._cfg.mcts.ctree_native_game:
+            self._set_native_game(mcts)
+            mcts.set_num_threads(self._cfg.mcts.ctree_num_threads)
+        return mcts
+
+    def _create_ctree_batched_mcts(self, num_simulations: int) -> Optional['mcts_alphazero.BatchedMCTS']:  # noqa
+        """
+        Overview:
+            Create the C++ MCTS searching the states of all the envs together if ``mcts.ctree_batched_search`` and \
+            ``mcts.ctree_native_game`` are True, otherwise return None.
+        Arguments:
+            - num_simulations (:obj:`int`): The number of simulations to perform at each move.
+        Returns:
+            - mcts (:obj:`Optional[mcts_alphazero.BatchedMCTS]`): The C++ batched MCTS instance or None.
+        """
+        if not (self._cfg.mcts.ctree_batched_search and self._cfg.mcts.ctree_native_game):
+            return None
+        import mcts_alphazero
+        mcts = mcts_alphazero.BatchedMCTS(
+            self._cfg.simulation_env_id, num_simulations, self._cfg.mcts.pb_c_base, self._cfg.mcts.pb_c_init,
+            self._cfg.mcts.root_dirichlet_alpha, self._cfg.mcts.root_noise_weight,
+            board_size=getattr(self.simulate_env, 'board_size', 15), scale=self.simulate_env.scale,
+            channel_last=self.simulate_env.channel_last,
+            battle_mode_in_simulation_env=self.simulate_env.battle_mode_in_simulation_env,
+            leaf_batch_size=self._cfg.mcts.ctree_leaf_batch_size,
+            evaluation_cache=self._cfg.mcts.ctree_evaluation_cache,
+            komi=getattr(self.simulate_env, 'komi', 7.5),
+            graph_search=self._cfg.mcts.ctree_graph_search
+        )
+        mcts.set_time_budget(self._cfg.mcts.ctree_time_budget_us)
+        return mcts
+
+    def _forward_batched_search(
+            self, mcts: 'mcts_alphazero.BatchedMCTS', ready_env_id: List[int], init_state: Dict[int, np.ndarray],  # noqa
+            start_player_index: Dict[int, int], temperature: float, sample: bool,
+            native_game_state: Optional[Dict[int, Optional[bytes]]] = None
+    ) -> Dict[int, Dict]:
+        """
+        Overview:
+            Search the states of all the ready envs together with the C++ batched MCTS, which evaluates the leaves of \
+            all the games with one call of ``self._policy_value_fn_batch`` per round.
+        Arguments:
+            - mcts (:obj:`mcts_alphazero.BatchedMCTS`): The C++ batched MCTS instance.
+            - ready_env_id (:obj:`List[int]`): The ids of the ready envs.
+            - init_state (:obj:`Dict[int, np.ndarray]`): The board of each env.
+            - start_player_index (:obj:`Dict[int, int]`): The index of the player to move in each env.
+            - temperature (:obj:`float`): The temperature of the action probabilities.
+            - sample (:obj:`bool`): Whether to sample the action, with root noise, or to take the most visited one.
+            - native_game_state (:obj:`Optional[Dict[int, Optional[bytes]]]`): The binary state of the native game of \
+                each env, used in place of its board if not None.
+        Returns:
+            - output (:obj:`Dict[int, Dict]`): The action and the action probabilities of each env.
+        """
+        state_configs = [
+            EasyDict(
+                dict(
+                    start_player_index=start_player_index[env_id],
+                    init_state=init_state[env_id],
+                    native_game_state=native_game_state[env_id] if native_game_state is not None else None
+                )
+            ) for env_id in ready_env_id
+        ]
+        results = mcts.get_next_actions(state_configs, self._policy_value_fn_batch, temperature, sample)
+        return {
+            env_id: {
+                'action': action,
+                'probs': mcts_probs,
+            }
+            for env_id, (action, mcts_probs) in zip(ready_env_id, results)
+        }
+
+    def _get_env_mcts(self, default_mcts: Any, mcts_per_env: Dict[int, Any], env_id: int, num_simulations: int) -> Any:
+        """
+        Overview:
+            Return the MCTS searching for ``env_id``: ``default_mcts``, shared by all the envs, unless the C++ MCTS \
+            reuses its tree across moves, in which case every env gets its own instance in ``mcts_per_env``.
+        Arguments:
+            - default_mcts (:obj:`Any`): The MCTS shared by all the envs.
+            - mcts_per_env (:obj:`Dict[int, Any]`): The MCTS of each env, filled on demand.
+            - env_id (:obj:`int`): The id of the env.
+            - num_simulations (:obj:`int`): The number of simulations of a new instance.
+        Returns:
+            - mcts (:obj:`Any`): The MCTS instance.
+        """
+        if not (self._cfg.mcts_ctree and self._cfg.mcts.ctree_reuse_tree):
+            return default_mcts
+        if env_id not in mcts_per_env:
+            mcts_per_env[env_id] = self._create_ctree_mcts(num_simulations)
+        return mcts_per_env[env_id]
+
+    def _reset_collect(self, data_id: Optional[List[int]] = None) -> None:
+        """
+        Overview:
+            Reset the collect mode: free the search trees kept for the given envs, whose episodes are over.
+        Arguments:
+            - data_id (:obj:`Optional[List[int]]`): The ids of the envs to reset, all the envs if None.
+        """
+        self._reset_env_mcts(self._collect_mcts_per_env, data_id)
+
+    def _reset_eval(self, data_id: Optional[List[int]] = None) -> None:
+        """
+        Overview:
+            Reset the eval mode: free the search trees kept for the given envs, whose episodes are over.
+        Arguments:
+            - data_id (:obj:`Optional[List[int]]`): The ids of the envs to reset, all the envs if None.
+        """
+        self._reset_env_mcts(self._eval_mcts_per_env, data_id)
+
+    @staticmethod
+    def _reset_env_mcts(mcts_per_env: Dict[int, Any], data_id: Optional[List[int]]) -> None:
+        for env_id in (list(mcts_per_env.keys()) if data_id is None else data_id):
+            if env_id in mcts_per_env:
+                mcts_per_env[env_id].reset()
+
+    def _set_native_game(self, mcts: 'mcts_alphazero.MCTS') -> None:  # noqa
+        """
+        Overview:
+            Make the C++ MCTS simulate the game of ``self.simulate_env`` natively, with the same observation options. \
+            ``self._policy_value_fn`` is then called with the native game, which has the same ``legal_actions`` and \
+            ``current_state()`` as the env.
+        Arguments:
+            - mcts (:obj:`mcts_alphazero.MCTS`): The C++ MCTS instance.
+        """
+        mcts.set_native_game(
+            self._cfg.simulation_env_id, getattr(self.simulate_env, 'board_size', 15), self.simulate_env.scale,
+            self.simulate_env.channel_last, self.simulate_env.battle_mode_in_simulation_env,
+            evaluation_cache=self._cfg.mcts.ctree_evaluation_cache,
+            komi=getattr(self.simulate_env, 'komi', 7.5),
+            graph_search=self._cfg.mcts.ctree_graph_search
+        )
+
+    def _get_policy_value_fn(self) -> Callable:
+        """
+        Overview:
+            Return the policy-value function passed to ``get_next_action``: the batched one if the C++ MCTS gathers \
+            several leaves per round or runs several threads, otherwise the one evaluating a single env.
+        """
+        if self._cfg.mcts_ctree and (self._cfg.mcts.ctree_leaf_batch_size > 1 or
+                                     (self._cfg.mcts.ctree_native_game and self._cfg.mcts.ctree_num_threads > 0)):
+            return self._policy_value_fn_batch
+        return self._policy_value_fn
+
     @torch.no_grad()
     def _policy_value_fn(self, env: 'Env') -> Tuple[Dict[int, np.ndarray], float]:  # noqa
         legal_actions = env.legal_actions
@@ -379,6 +589,22 @@ class AlphaZeroPolicy(Policy):
         action_probs_dict = dict(zip(legal_actions, action_probs.squeeze(0)[legal_actions].detach().cpu().numpy()))
         return action_probs_dict, value.item()
 
+    def _policy_value_fn_batch(self, obs: np.ndarray, legal_actions: List[List[int]]) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Overview:
+            The batched policy-value function used by the C++ MCTS when ``mcts.ctree_leaf_batch_size`` > 1, \
+            ``mcts.ctree_num_threads`` > 0 or ``mcts.ctree_batched_search`` is True, which evaluates all the leaves gathered in one round of the search \
+            with a single forward pass.
+        Arguments:
+            - obs (:obj:`np.ndarray`): The stacked scaled states of the leaves, of shape (N, C, H, W).
+            - legal_actions (:obj:`List[List[int]]`): The legal actions of each leaf, only the probabilities of \
+                which are used by the search.
+        Returns:
+            - action_probs (:obj:`np.ndarray`): The action probabilities of shape (N, action_space_size).
+            - values (:obj:`np.ndarray`): The values of shape (N, ).
+        """
+        return compute_policy_value_batch(self._policy_model, obs, self._device)
+
     def _monitor_vars_learn(self) -> List[str]:
         """
         Overview:
@@ -182,6 +182,12 @@ class EfficientZeroPolicy(MuZeroPolicy):
         root_dirichlet_alpha=0.3,
         # (float) The noise weight at the root node of the search tree.
         root_noise_weight=0.25,
+        # (bool) Whether to decode the categorical value/reward logits inside the cpp ``batch_backpropagate`` during the
+        # search instead of in torch. Only used when ``mcts_ctree`` and ``model.categorical_distribution`` are True.
+        ctree_categorical_decoding=False,
+        # (int) The wall-clock budget of a search in microseconds, checked between simulations: the search stops at
+        # ``num_simulations`` or at this budget, whichever comes first. 0 disables it. Only used when ``mcts_ctree`` is True.
+        ctree_time_budget_us=0,
 
         # ****** Explore by random collect ******
         # (int) The number of episodes to collect data randomly before training.
@@ -527,6 +533,8 @@ class EfficientZeroPolicy(MuZeroPolicy):
             self._mcts_collect = MCTSCtree(self._cfg)
         else:
             self._mcts_collect = MCTSPtree(self._cfg)
+        # the cpp roots are kept between steps and reset in place to reuse their storage.
+        self._collect_roots = None
         self._collect_mcts_temperature = 1
         self.collect_epsilon = 0.0
 
@@ -581,7 +589,6 @@ class EfficientZeroPolicy(MuZeroPolicy):
             )
             policy_logits = policy_logits.detach().cpu().numpy().tolist()
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
             # the only difference between collect and eval is the dirichlet noise.
             noises = [
                 np.random.dirichlet([self._cfg.root_dirichlet_alpha] * int(sum(action_mask[j]))
@@ -589,9 +596,11 @@ class EfficientZeroPolicy(MuZeroPolicy):
             ]
             if self._cfg.mcts_ctree:
                 # cpp mcts_tree
-                roots = MCTSCtree.roots(active_collect_env_num, legal_actions)
+                self._collect_roots = MCTSCtree.reset_roots(self._collect_roots, active_collect_env_num, action_mask)
+                roots = self._collect_roots
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
                 roots = MCTSPtree.roots(active_collect_env_num, legal_actions)
             roots.prepare(self._cfg.root_noise_weight, noises, value_prefix_roots, policy_logits, to_play)
             self._mcts_collect.search(
@@ -615,7 +624,7 @@ class EfficientZeroPolicy(MuZeroPolicy):
                     )
                     action = np.where(action_mask[i] == 1.0)[0][action_index_in_legal_action_set]
                     if np.random.rand() < self.collect_epsilon:
-                        action = np.random.choice(legal_actions[i])
+                        action = np.random.choice(np.where(action_mask[i] == 1.0)[0])
                 else:
                     # normal collect
                     # NOTE: Only legal actions possess visit counts, so the ``action_index_in_legal_action_set`` represents
@@ -646,6 +655,8 @@ class EfficientZeroPolicy(MuZeroPolicy):
             self._mcts_eval = MCTSCtree(self._cfg)
         else:
             self._mcts_eval = MCTSPtree(self._cfg)
+        # the cpp roots are kept between steps and reset in place to reuse their storage.
+        self._eval_roots = None
 
     def _forward_eval(self, data: torch.Tensor, action_mask: list, to_play: -1, ready_env_id: np.array = None,):
         """
@@ -688,12 +699,13 @@ class EfficientZeroPolicy(MuZeroPolicy):
                 )
                 policy_logits = policy_logits.detach().cpu().numpy().tolist()  # list shape（B, A）
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
             if self._cfg.mcts_ctree:
                 # cpp mcts_tree
-                roots = MCTSCtree.roots(active_eval_env_num, legal_actions)
+                self._eval_roots = MCTSCtree.reset_roots(self._eval_roots, active_eval_env_num, action_mask)
+                roots = self._eval_roots
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
                 roots = MCTSPtree.roots(active_eval_env_num, legal_actions)
             roots.prepare_no_noise(value_prefix_roots, policy_logits, to_play)
             self._mcts_eval.search(roots, self._eval_model, latent_state_roots, reward_hidden_state_roots, to_play)
@@ -1,6 +1,6 @@
 import copy
 from collections import namedtuple
-from typing import List, Dict, Tuple
+from typing import List, Dict, Tuple, Callable
 
 import numpy as np
 import torch.distributions
@@ -13,7 +13,7 @@ from ding.utils.data import default_collate
 from easydict import EasyDict
 from torch.nn import KLDivLoss
 
-from lzero.policy import configure_optimizers
+from lzero.policy import configure_optimizers, compute_policy_value_batch
 
 
 @POLICY_REGISTRY.register('gumbel_alphazero')
@@ -117,6 +117,12 @@ class GumbelAlphaZeroPolicy(Policy):
             gumbel_rng=0.0,
             #
             max_num_considered_actions=6,
+            # (int) The number of leaves the C++ MCTS gathers with virtual loss and evaluates in one forward pass.
+            # Only used when ``mcts_ctree`` is True; 1 evaluates the leaves one by one.
+            ctree_leaf_batch_size=1,
+            # (bool) Whether the C++ MCTS evaluates the visits of each phase of the root sequential halving in one forward
+            # pass, the considered actions being scored once per phase. Only used when ``mcts_ctree`` is True.
+            ctree_batched_halving=False,
         ),
         other=dict(replay_buffer=dict(
             replay_buffer_size=int(1e6),
@@ -259,7 +265,9 @@ class GumbelAlphaZeroPolicy(Policy):
                                                             self._cfg.mcts.maxvisit_init, self._cfg.mcts.value_scale,
                                                             self._cfg.mcts.gumbel_scale, self._cfg.mcts.gumbel_rng,
                                                             self._cfg.mcts.max_num_considered_actions,
-                                                            self.simulate_env)
+                                                            self.simulate_env,
+                                                            leaf_batch_size=self._cfg.mcts.ctree_leaf_batch_size,
+                                                            batched_halving=self._cfg.mcts.ctree_batched_halving)
         else:
             if self._cfg.sampled_algo:
                 from lzero.mcts.ptree.ptree_az_sampled import MCTS
@@ -301,7 +309,7 @@ class GumbelAlphaZeroPolicy(Policy):
 
             action, mcts_probs, improved_probs = self._collect_mcts.get_next_action(
                 state_config_for_env_reset,
-                self._policy_value_fn,
+                self._get_policy_value_fn(),
                 self.collect_mcts_temperature,
                 True,
             )
@@ -330,7 +338,9 @@ class GumbelAlphaZeroPolicy(Policy):
                                                          self._cfg.mcts.root_noise_weight,
                                                          self._cfg.mcts.maxvisit_init, self._cfg.mcts.value_scale,
                                                          self._cfg.mcts.gumbel_scale, self._cfg.mcts.gumbel_rng,
-                                                         self._cfg.mcts.max_num_considered_actions, self.simulate_env)
+                                                         self._cfg.mcts.max_num_considered_actions, self.simulate_env,
+                                                         leaf_batch_size=self._cfg.mcts.ctree_leaf_batch_size,
+                                                         batched_halving=self._cfg.mcts.ctree_batched_halving)
         else:
             if self._cfg.sampled_algo:
                 from lzero.mcts.ptree.ptree_az_sampled import MCTS
@@ -371,7 +381,7 @@ class GumbelAlphaZeroPolicy(Policy):
                                                        katago_game_state=katago_game_state[env_id]))
 
             action, mcts_probs, improved_probs = self._eval_mcts.get_next_action(
-                state_config_for_env_reset, self._policy_value_fn, 1.0, False)
+                state_config_for_env_reset, self._get_policy_value_fn(), 1.0, False)
             output[env_id] = {
                 'action': action,
                 'probs': mcts_probs,
@@ -412,6 +422,17 @@ class GumbelAlphaZeroPolicy(Policy):
         else:
             raise NotImplementedError
 
+    def _get_policy_value_fn(self) -> Callable:
+        """
+        Overview:
+            Return the policy-value function passed to ``get_next_action``: the batched one if the C++ MCTS gathers \
+            several leaves per round or batches the phases of the root sequential halving, otherwise the one evaluating \
+            a single env.
+        """
+        if self._cfg.mcts_ctree and (self._cfg.mcts.ctree_leaf_batch_size > 1 or self._cfg.mcts.ctree_batched_halving):
+            return self._policy_value_fn_batch
+        return self._policy_value_fn
+
     @torch.no_grad()
     def _policy_value_fn(self, env: 'Env') -> Tuple[Dict[int, np.ndarray], float]:  # noqa
         legal_actions = env.legal_actions
@@ -425,6 +446,22 @@ class GumbelAlphaZeroPolicy(Policy):
             zip(legal_actions, action_probs.squeeze(0)[legal_actions].detach().cpu().numpy()))
         return legal_action_probs_dict, value.item()
 
+    def _policy_value_fn_batch(self, obs: np.ndarray, legal_actions: List[List[int]]) -> Tuple[np.ndarray, np.ndarray]:
+        """
+        Overview:
+            The batched policy-value function used by the C++ MCTS when ``mcts.ctree_leaf_batch_size`` > 1 or \
+            ``mcts.ctree_batched_halving`` is True, which evaluates all the leaves gathered in one round of the search \
+            with a single forward pass.
+        Arguments:
+            - obs (:obj:`np.ndarray`): The stacked scaled states of the leaves, of shape (N, C, H, W).
+            - legal_actions (:obj:`List[List[int]]`): The legal actions of each leaf, only the probabilities of \
+                which are used by the search.
+        Returns:
+            - action_probs (:obj:`np.ndarray`): The action probabilities of shape (N, action_space_size).
+            - values (:obj:`np.ndarray`): The values of shape (N, ).
+        """
+        return compute_policy_value_batch(self._policy_model, obs, self._device)
+
     def _monitor_vars_learn(self) -> List[str]:
         """
         Overview:
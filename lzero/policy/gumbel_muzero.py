@@ -538,35 +538,46 @@ class GumbelMuZeroPolicy(MuZeroPolicy):
             latent_state_roots = latent_state_roots.detach().cpu().numpy()
             policy_logits = policy_logits.detach().cpu().numpy().tolist()
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
             # the only difference between collect and eval is the dirichlet noise
             noises = [
                 np.random.dirichlet([self._cfg.root_dirichlet_alpha] * int(sum(action_mask[j]))
                                     ).astype(np.float32).tolist() for j in range(active_collect_env_num)
             ]
             if self._cfg.mcts_ctree:
-                # cpp mcts_tree
-                roots = MCTSCtree.roots(active_collect_env_num, legal_actions)
+                # cpp mcts_tree, the gumbel noise of each root is drawn with its own seed from ``np.random``
+                # the legal actions are built in C++ from the nonzero entries of the action mask
+                legal_action_mask = np.asarray(action_mask) != 0
+                roots = MCTSCtree.roots(active_collect_env_num, legal_action_mask)
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
                 roots = MCTSPtree.roots(active_collect_env_num, legal_actions)
 
             roots.prepare(self._cfg.root_noise_weight, noises, reward_roots, list(pred_values), policy_logits, to_play)
             self._mcts_collect.search(roots, self._collect_model, latent_state_roots, to_play)
 
-            # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
-            roots_visit_count_distributions = roots.get_distributions()
-            roots_values = roots.get_values()  # shape: {list: batch_size}
-            roots_completed_values = roots.get_children_values(self._cfg.discount_factor,
-                                                               self._cfg.model.action_space_size)
-
             # ==============================================================
             # The core difference between GumbelMuZero and MuZero
             # ==============================================================
             # Gumbel MuZero selects the action according to the improved policy
-            roots_improved_policy_probs = roots.get_policies(self._cfg.discount_factor,
-                                                             self._cfg.model.action_space_size)  # new policy constructed with completed Q in gumbel muzero
-            roots_improved_policy_probs = np.array(roots_improved_policy_probs)
+            if self._cfg.mcts_ctree:
+                # export the dense visit counts, values, improved policies and completed values in one call
+                roots_visit_counts, roots_values, roots_improved_policy_probs, roots_completed_values = \
+                    MCTSCtree.get_root_outputs(roots, self._cfg.discount_factor, self._cfg.model.action_space_size)
+                # list of list, shape: ``{list: batch_size} -> {list: len(legal_actions)}``
+                roots_visit_count_distributions = [
+                    roots_visit_counts[j, legal_action_mask[j]].tolist() for j in range(active_collect_env_num)
+                ]
+                roots_values = roots_values.tolist()
+            else:
+                # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
+                roots_visit_count_distributions = roots.get_distributions()
+                roots_values = roots.get_values()  # shape: {list: batch_size}
+                roots_completed_values = roots.get_children_values(self._cfg.discount_factor,
+                                                                   self._cfg.model.action_space_size)
+                roots_improved_policy_probs = roots.get_policies(self._cfg.discount_factor,
+                                                                 self._cfg.model.action_space_size)  # new policy constructed with completed Q in gumbel muzero
+                roots_improved_policy_probs = np.array(roots_improved_policy_probs)
 
             data_id = [i for i in range(active_collect_env_num)]
             output = {i: None for i in data_id}
@@ -650,27 +661,38 @@ class GumbelMuZeroPolicy(MuZeroPolicy):
                 latent_state_roots = latent_state_roots.detach().cpu().numpy()
                 policy_logits = policy_logits.detach().cpu().numpy().tolist()  # list shape（B, A）
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
             if self._cfg.mcts_ctree:
-                # cpp mcts_tree
-                roots = MCTSCtree.roots(active_eval_env_num, legal_actions)
+                # cpp mcts_tree, the gumbel noise of each root is drawn with its own seed from ``np.random``
+                # the legal actions are built in C++ from the nonzero entries of the action mask
+                legal_action_mask = np.asarray(action_mask) != 0
+                roots = MCTSCtree.roots(active_eval_env_num, legal_action_mask)
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
                 roots = MCTSPtree.roots(active_eval_env_num, legal_actions)
             roots.prepare_no_noise(reward_roots, list(pred_values), policy_logits, to_play)
             self._mcts_eval.search(roots, self._eval_model, latent_state_roots, to_play)
 
-            # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
-            roots_visit_count_distributions = roots.get_distributions()
-            roots_values = roots.get_values()  # shape: {list: batch_size}
-
             # ==============================================================
             # The core difference between GumbelMuZero and MuZero
             # ==============================================================
             # Gumbel MuZero selects the action according to the improved policy
-            roots_improved_policy_probs = roots.get_policies(self._cfg.discount_factor,
-                                                             self._cfg.model.action_space_size)  # new policy constructed with completed Q in gumbel muzero
-            roots_improved_policy_probs = np.array(roots_improved_policy_probs)
+            if self._cfg.mcts_ctree:
+                # export the dense visit counts, values and improved policies in one call
+                roots_visit_counts, roots_values, roots_improved_policy_probs, _ = \
+                    MCTSCtree.get_root_outputs(roots, self._cfg.discount_factor, self._cfg.model.action_space_size)
+                # list of list, shape: ``{list: batch_size} -> {list: len(legal_actions)}``
+                roots_visit_count_distributions = [
+                    roots_visit_counts[j, legal_action_mask[j]].tolist() for j in range(active_eval_env_num)
+                ]
+                roots_values = roots_values.tolist()
+            else:
+                # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
+                roots_visit_count_distributions = roots.get_distributions()
+                roots_values = roots.get_values()  # shape: {list: batch_size}
+                roots_improved_policy_probs = roots.get_policies(self._cfg.discount_factor,
+                                                                 self._cfg.model.action_space_size)  # new policy constructed with completed Q in gumbel muzero
+                roots_improved_policy_probs = np.array(roots_improved_policy_probs)
 
             data_id = [i for i in range(active_eval_env_num)]
             output = {i: None for i in data_id}
@@ -186,6 +186,20 @@ class MuZeroPolicy(Policy):
         root_dirichlet_alpha=0.3,
         # (float) The noise weight at the root node of the search tree.
         root_noise_weight=0.25,
+        # (bool) Whether to decode the categorical value/reward logits inside the cpp ``batch_backpropagate`` during the
+        # search instead of in torch. Only used when ``mcts_ctree`` and ``model.categorical_distribution`` are True.
+        ctree_categorical_decoding=False,
+        # (int) The wall-clock budget of a search in microseconds, checked between simulations: the search stops at
+        # ``num_simulations`` or at this budget, whichever comes first. 0 disables it. Only used when ``mcts_ctree`` is True.
+        ctree_time_budget_us=0,
+        # (bool) Whether to retire a root once the remaining simulations cannot change its most visited child, or once its
+        # visit entropy is below ``ctree_retire_entropy_threshold``. Retired roots drop out of the following inference
+        # batches. Only used when ``mcts_ctree`` is True.
+        ctree_adaptive_budget=False,
+        # (float) The visit entropy (in nats) under which a root retires. 0 disables it.
+        ctree_retire_entropy_threshold=0.,
+        # (int) The number of simulations of a root before it can retire by ``ctree_retire_entropy_threshold``.
+        ctree_retire_min_simulations=0,
 
         # ****** Explore by random collect ******
         # (int) The number of episodes to collect data randomly before training.
@@ -505,6 +519,8 @@ class MuZeroPolicy(Policy):
             self._mcts_collect = MCTSCtree(self._cfg)
         else:
             self._mcts_collect = MCTSPtree(self._cfg)
+        # the cpp roots are kept between steps and reset in place to reuse their storage.
+        self._collect_roots = None
         self._collect_mcts_temperature = 1.
         self.collect_epsilon = 0.0
 
@@ -555,7 +571,6 @@ class MuZeroPolicy(Policy):
             latent_state_roots = latent_state_roots.detach().cpu().numpy()
             policy_logits = policy_logits.detach().cpu().numpy().tolist()
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
             # the only difference between collect and eval is the dirichlet noise
             noises = [
                 np.random.dirichlet([self._cfg.root_dirichlet_alpha] * int(sum(action_mask[j]))
@@ -563,9 +578,11 @@ class MuZeroPolicy(Policy):
             ]
             if self._cfg.mcts_ctree:
                 # cpp mcts_tree
-                roots = MCTSCtree.roots(active_collect_env_num, legal_actions)
+                self._collect_roots = MCTSCtree.reset_roots(self._collect_roots, active_collect_env_num, action_mask)
+                roots = self._collect_roots
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
                 roots = MCTSPtree.roots(active_collect_env_num, legal_actions)
 
             roots.prepare(self._cfg.root_noise_weight, noises, reward_roots, policy_logits, to_play)
@@ -590,7 +607,7 @@ class MuZeroPolicy(Policy):
                     )
                     action = np.where(action_mask[i] == 1.0)[0][action_index_in_legal_action_set]
                     if np.random.rand() < self.collect_epsilon:
-                        action = np.random.choice(legal_actions[i])
+                        action = np.random.choice(np.where(action_mask[i] == 1.0)[0])
                 else:
                     # normal collect
                     # NOTE: Only legal actions possess visit counts, so the ``action_index_in_legal_action_set`` represents
@@ -621,6 +638,8 @@ class MuZeroPolicy(Policy):
             self._mcts_eval = MCTSCtree(self._cfg)
         else:
             self._mcts_eval = MCTSPtree(self._cfg)
+        # the cpp roots are kept between steps and reset in place to reuse their storage.
+        self._eval_roots = None
 
     def _get_target_obs_index_in_step_k(self, step):
         """
@@ -682,12 +701,13 @@ class MuZeroPolicy(Policy):
                 latent_state_roots = latent_state_roots.detach().cpu().numpy()
                 policy_logits = policy_logits.detach().cpu().numpy().tolist()  # list shape（B, A）
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
             if self._cfg.mcts_ctree:
                 # cpp mcts_tree
-                roots = MCTSCtree.roots(active_eval_env_num, legal_actions)
+                self._eval_roots = MCTSCtree.reset_roots(self._eval_roots, active_eval_env_num, action_mask)
+                roots = self._eval_roots
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
                 roots = MCTSPtree.roots(active_eval_env_num, legal_actions)
             roots.prepare_no_noise(reward_roots, policy_logits, to_play)
             self._mcts_eval.search(roots, self._eval_model, latent_state_roots, to_play)
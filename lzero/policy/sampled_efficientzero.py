@@ -841,6 +841,9 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
                 legal_actions = [
                     [-1 for _ in range(self._cfg.model.num_of_sampled_actions)] for _ in range(active_collect_env_num)
                 ]
+            elif self._cfg.mcts_ctree:
+                # the legal actions of the cpp mcts_tree are built in C++ from the nonzero entries of the action mask
+                legal_actions = np.asarray(action_mask)
             else:
                 legal_actions = [
                     [i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)
@@ -870,10 +873,18 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
                 roots, self._collect_model, latent_state_roots, reward_hidden_state_roots, to_play
             )
 
-            # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
-            roots_visit_count_distributions = roots.get_distributions()
-            roots_values = roots.get_values()  # shape: {list: batch_size}
-            roots_sampled_actions = roots.get_sampled_actions()  # {list: 1}->{list:6}
+            if self._cfg.mcts_ctree:
+                # export the sampled actions, visit counts and values of all roots into numpy arrays in one call,
+                # shape: ``(B, K, D)``, ``(B, K)``, ``(B, )`` and ``(B, K)``.
+                roots_sampled_actions, roots_visit_count_distributions, roots_values, roots_valid_masks = MCTSCtree.get_root_outputs(
+                    roots, self._cfg.model.num_of_sampled_actions,
+                    self._cfg.model.action_space_size if self._cfg.model.continuous_action_space else 1
+                )
+            else:
+                # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
+                roots_visit_count_distributions = roots.get_distributions()
+                roots_values = roots.get_values()  # shape: {list: batch_size}
+                roots_sampled_actions = roots.get_sampled_actions()  # {list: 1}->{list:6}
 
             data_id = [i for i in range(active_collect_env_num)]
             output = {i: None for i in data_id}
@@ -883,8 +894,10 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
             for i, env_id in enumerate(ready_env_id):
                 distributions, value = roots_visit_count_distributions[i], roots_values[i]
                 if self._cfg.mcts_ctree:
-                    # In ctree, the method roots.get_sampled_actions() returns a list object.
-                    root_sampled_actions = np.array([action for action in roots_sampled_actions[i]])
+                    # In ctree, the sampled actions are exported as a padded array, only keep the valid ones.
+                    valid_mask = roots_valid_masks[i].astype(bool)
+                    distributions = distributions[valid_mask]
+                    root_sampled_actions = roots_sampled_actions[i][valid_mask]
                 else:
                     # In ptree, the same method roots.get_sampled_actions() returns an Action object.
                     root_sampled_actions = np.array([action.value for action in roots_sampled_actions[i]])
@@ -896,8 +909,8 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
                 )
 
                 if self._cfg.mcts_ctree:
-                    # In ctree, the method roots.get_sampled_actions() returns a list object.
-                    action = np.array(roots_sampled_actions[i][action])
+                    # In ctree, the sampled actions are a numpy array.
+                    action = root_sampled_actions[action]
                 else:
                     # In ptree, the same method roots.get_sampled_actions() returns an Action object.
                     action = roots_sampled_actions[i][action].value
@@ -978,6 +991,9 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
                 legal_actions = [
                     [-1 for _ in range(self._cfg.model.num_of_sampled_actions)] for _ in range(active_eval_env_num)
                 ]
+            elif self._cfg.mcts_ctree:
+                # the legal actions of the cpp mcts_tree are built in C++ from the nonzero entries of the action mask
+                legal_actions = np.asarray(action_mask)
             else:
                 legal_actions = [
                     [i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)
@@ -999,14 +1015,22 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
             roots.prepare_no_noise(value_prefix_roots, policy_logits, to_play)
             self._mcts_eval.search(roots, self._eval_model, latent_state_roots, reward_hidden_state_roots, to_play)
 
-            # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
-            roots_visit_count_distributions = roots.get_distributions()
-            roots_values = roots.get_values()  # shape: {list: batch_size}
-            # ==============================================================
-            # sampled related core code
-            # ==============================================================
-            roots_sampled_actions = roots.get_sampled_actions(
-            )  # shape: ``{list: batch_size} ->{list: action_space_size}``
+            if self._cfg.mcts_ctree:
+                # export the sampled actions, visit counts and values of all roots into numpy arrays in one call,
+                # shape: ``(B, K, D)``, ``(B, K)``, ``(B, )`` and ``(B, K)``.
+                roots_sampled_actions, roots_visit_count_distributions, roots_values, roots_valid_masks = MCTSCtree.get_root_outputs(
+                    roots, self._cfg.model.num_of_sampled_actions,
+                    self._cfg.model.action_space_size if self._cfg.model.continuous_action_space else 1
+                )
+            else:
+                # list of list, shape: ``{list: batch_size} -> {list: action_space_size}``
+                roots_visit_count_distributions = roots.get_distributions()
+                roots_values = roots.get_values()  # shape: {list: batch_size}
+                # ==============================================================
+                # sampled related core code
+                # ==============================================================
+                roots_sampled_actions = roots.get_sampled_actions(
+                )  # shape: ``{list: batch_size} ->{list: action_space_size}``
 
             data_id = [i for i in range(active_eval_env_num)]
             output = {i: None for i in data_id}
@@ -1016,11 +1040,13 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
 
             for i, env_id in enumerate(ready_env_id):
                 distributions, value = roots_visit_count_distributions[i], roots_values[i]
-                try:
+                if self._cfg.mcts_ctree:
+                    # In ctree, the sampled actions are exported as a padded array, only keep the valid ones.
+                    valid_mask = roots_valid_masks[i].astype(bool)
+                    distributions = distributions[valid_mask]
+                    root_sampled_actions = roots_sampled_actions[i][valid_mask]
+                else:
                     root_sampled_actions = np.array([action.value for action in roots_sampled_actions[i]])
-                except Exception:
-                    # logging.warning('ctree_sampled_efficientzero roots.get_sampled_actions() return list')
-                    root_sampled_actions = np.array([action for action in roots_sampled_actions[i]])
                 # NOTE: Only legal actions possess visit counts, so the ``action_index_in_legal_action_set`` represents
                 # the index within the legal action set, rather than the index in the entire action set.
                 # Setting deterministic=True implies choosing the action with the highest value (argmax) rather than sampling during the evaluation phase.
@@ -1031,12 +1057,10 @@ class SampledEfficientZeroPolicy(MuZeroPolicy):
                 # sampled related core code
                 # ==============================================================
 
-                try:
+                if self._cfg.mcts_ctree:
+                    action = root_sampled_actions[action]
+                else:
                     action = roots_sampled_actions[i][action].value
-                    # logging.warning('ptree_sampled_efficientzero roots.get_sampled_actions() return array')
-                except Exception:
-                    # logging.warning('ctree_sampled_efficientzero roots.get_sampled_actions() return list')
-                    action = np.array(roots_sampled_actions[i][action])
 
                 if not self._cfg.model.continuous_action_space:
                     if len(action.shape) == 0:
@@ -182,6 +182,12 @@ class StochasticMuZeroPolicy(MuZeroPolicy):
         root_dirichlet_alpha=0.3,
         # (float) The noise weight at the root node of the search tree.
         root_noise_weight=0.25,
+        # (int) If > 0, each chance node in the search only materializes its top-k most probable outcomes at first.
+        chance_top_k=0,
+        # (float) Each chance node in the search only materializes the smallest set of its most probable outcomes
+        # covering this probability mass at first. The other outcomes are added once they are expected to be sampled.
+        # 1.0 means no truncation.
+        chance_prob_mass=1.0,
 
         # ****** Explore by random collect ******
         # (int) The number of episodes to collect data randomly before training.
@@ -618,17 +624,17 @@ class StochasticMuZeroPolicy(MuZeroPolicy):
                 latent_state_roots = latent_state_roots.detach().cpu().numpy()
                 policy_logits = policy_logits.detach().cpu().numpy().tolist()
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
             # the only difference between collect and eval is the dirichlet noise
             noises = [
                 np.random.dirichlet([self._cfg.root_dirichlet_alpha] * int(sum(action_mask[j]))
                                     ).astype(np.float32).tolist() for j in range(active_collect_env_num)
             ]
             if self._cfg.mcts_ctree:
-                # cpp mcts_tree
-                roots = MCTSCtree.roots(active_collect_env_num, legal_actions)
+                # cpp mcts_tree, the legal actions are built in C++ from the nonzero entries of the action mask
+                roots = MCTSCtree.roots(active_collect_env_num, np.asarray(action_mask))
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_collect_env_num)]
                 roots = MCTSPtree.roots(active_collect_env_num, legal_actions)
 
             roots.prepare(self._cfg.root_noise_weight, noises, reward_roots, policy_logits, to_play)
@@ -711,12 +717,12 @@ class StochasticMuZeroPolicy(MuZeroPolicy):
                 latent_state_roots = latent_state_roots.detach().cpu().numpy()
                 policy_logits = policy_logits.detach().cpu().numpy().tolist()  # list shape（B, A）
 
-            legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
             if self._cfg.mcts_ctree:
-                # cpp mcts_tree
-                roots = MCTSCtree.roots(active_eval_env_num, legal_actions)
+                # cpp mcts_tree, the legal actions are built in C++ from the nonzero entries of the action mask
+                roots = MCTSCtree.roots(active_eval_env_num, np.asarray(action_mask))
             else:
                 # python mcts_tree
+                legal_actions = [[i for i, x in enumerate(action_mask[j]) if x == 1] for j in range(active_eval_env_num)]
                 roots = MCTSPtree.roots(active_eval_env_num, legal_actions)
             roots.prepare_no_noise(reward_roots, policy_logits, to_play)
             self._mcts_eval.search(roots, self._eval_model, latent_state_roots, to_play)
@@ -0,0 +1,44 @@
+import numpy as np
+import pytest
+import torch
+from ding.config import compile_config
+from ding.policy import create_policy
+
+from lzero.model.muzero_model import MuZeroModel as Model
+
+
+@pytest.mark.unittest
+@pytest.mark.parametrize('action_mask_dtype', [np.int64, np.float32, np.bool_])
+def test_gumbel_muzero_ctree_forward(action_mask_dtype):
+    """
+    Overview:
+        The collect and eval forwards of Gumbel MuZero with the C++ tree select a legal action of every env, and
+        only export the visit counts of the legal actions, whatever the dtype of the action mask.
+    """
+    from zoo.board_games.tictactoe.config.tictactoe_gumbel_muzero_bot_mode_config import main_config, create_config
+    cfg = main_config
+    cfg.policy.cuda = False
+    cfg.policy.device = 'cpu'
+    cfg.policy.mcts_ctree = True
+    cfg.policy.num_simulations = 8
+    cfg = compile_config(cfg, seed=0, env=None, auto=True, create_cfg=create_config, save_cfg=False)
+    model = Model(**cfg.policy.model)
+    model.eval()
+    policy = create_policy(cfg.policy, model=model, enable_field=['learn', 'collect', 'eval'])
+
+    env_num = 3
+    rng = np.random.RandomState(0)
+    action_mask = (rng.rand(env_num, cfg.policy.model.action_space_size) < 0.5)
+    action_mask[:, 0] = True
+    action_mask = action_mask.astype(action_mask_dtype)
+    data = torch.from_numpy(rng.rand(env_num, *cfg.policy.model.observation_shape).astype(np.float32))
+    to_play = [-1 for _ in range(env_num)]
+
+    collect_output = policy._forward_collect(data, action_mask, temperature=1, to_play=to_play)
+    eval_output = policy._forward_eval(data, action_mask, to_play=to_play)
+    for output in [collect_output, eval_output]:
+        assert sorted(output) == list(range(env_num))
+        for i in range(env_num):
+            assert action_mask[i][output[i]['action']]
+            assert len(output[i]['visit_count_distributions']) == int(np.count_nonzero(action_mask[i]))
+            assert sum(output[i]['visit_count_distributions']) == cfg.policy.num_simulations
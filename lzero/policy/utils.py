@@ -673,6 +673,27 @@ def to_detach_cpu_numpy(
         raise TypeError("The type of input must be torch.Tensor or List[torch.Tensor]")
 
 
+@torch.no_grad()
+def compute_policy_value_batch(
+    model: nn.Module, obs: np.ndarray, device: Union[str, torch.device]
+) -> Tuple[np.ndarray, np.ndarray]:
+    """
+    Overview:
+        The batched policy-value function of the AlphaZero policies, passed to the C++ MCTS to evaluate all the leaves \
+        gathered in one round of the search with a single forward pass of ``model``.
+    Arguments:
+        - model (:obj:`nn.Module`): The policy-value network, which provides ``compute_policy_value``.
+        - obs (:obj:`np.ndarray`): The stacked scaled states of the leaves, of shape (N, C, H, W).
+        - device (:obj:`Union[str, torch.device]`): The device of ``model``.
+    Returns:
+        - action_probs (:obj:`np.ndarray`): The action probabilities of shape (N, action_space_size).
+        - values (:obj:`np.ndarray`): The values of shape (N, ).
+    """
+    obs = torch.from_numpy(obs).to(device=device, dtype=torch.float)
+    action_probs, values = model.compute_policy_value(obs)
+    return action_probs.detach().cpu().numpy(), values.reshape(-1).detach().cpu().numpy()
+
+
 def ez_network_output_unpack(network_output: Dict) -> Tuple:
     """
     Overview:
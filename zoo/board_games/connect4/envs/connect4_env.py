@@ -330,6 +330,26 @@ class Connect4Env(BaseEnv):
         obs = self.observe()
         return obs
 
+    def clone_state(self) -> Tuple[List[int], int]:
+        """
+        Overview:
+            Copy the 42 cells of the 6 x 7 board, a flat list in row-major order, and the current player.
+        Returns:
+            - snapshot (:obj:`Tuple[List[int], int]`): The (cells, current_player) pair.
+        """
+        return list(self.board), self._current_player
+
+    def restore_state(self, snapshot: Tuple[List[int], int]) -> None:
+        """
+        Overview:
+            Resume the game from a ``clone_state`` snapshot. The cells are copied into a new list, so the snapshot \
+            can be restored again.
+        Arguments:
+            - snapshot (:obj:`Tuple[List[int], int]`): The (cells, current_player) pair.
+        """
+        board, self._current_player = snapshot
+        self.board = list(board)
+
     def current_state(self) -> Tuple[np.ndarray, np.ndarray]:
         """
         Overview:
@@ -134,3 +134,32 @@ class TestConnect4Env:
                 else:
                     print('draw')
                 break
+
+    def test_clone_restore_state(self) -> None:
+        cfg = EasyDict(
+            battle_mode='self_play_mode',
+            bot_action_type='rule',
+            channel_last=False,
+            scale=True,
+            screen_scaling=9,
+            prob_random_action_in_bot=0.,
+            render_mode=None,
+            replay_path=None,
+            agent_vs_human=False,
+            prob_random_agent=0,
+            prob_expert_agent=0,
+        )
+        env = Connect4Env(cfg)
+        env.reset()
+        env.step(3)
+        snapshot = env.clone_state()
+        board, current_player, legal_actions = list(env.board), env.current_player, env.legal_actions
+        # Play the game to the end from the snapshot twice, restoring it each time.
+        for _ in range(2):
+            done = False
+            while not done:
+                obs, reward, done, info = env.step(env.random_action())
+            env.restore_state(snapshot)
+            assert env.board == board
+            assert env.current_player == current_player
+            assert env.legal_actions == legal_actions
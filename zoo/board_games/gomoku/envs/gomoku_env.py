@@ -3,7 +3,7 @@ import os
 import sys
 from datetime import datetime
 from functools import lru_cache
-from typing import List, Any
+from typing import List, Any, Tuple
 
 import gymnasium as gym
 import imageio
@@ -238,6 +238,26 @@ class GomokuEnv(BaseEnv):
         else:
             self.board = np.zeros((self.board_size, self.board_size), dtype="int32")
 
+    def clone_state(self) -> Tuple[np.ndarray, int]:
+        """
+        Overview:
+            Copy the (board_size, board_size) int32 board and the current player. The bots and the render state \
+            are not part of the snapshot.
+        Returns:
+            - snapshot (:obj:`Tuple[np.ndarray, int]`): The (board, current_player) pair.
+        """
+        return self.board.copy(), self._current_player
+
+    def restore_state(self, snapshot: Tuple[np.ndarray, int]) -> None:
+        """
+        Overview:
+            Resume the game from a ``clone_state`` snapshot, copying its board array instead of sharing it.
+        Arguments:
+            - snapshot (:obj:`Tuple[np.ndarray, int]`): The (board, current_player) pair.
+        """
+        board, self._current_player = snapshot
+        self.board = board.copy()
+
     def step(self, action):
         if self.battle_mode == 'self_play_mode':
             if np.random.rand() < self.prob_random_agent:
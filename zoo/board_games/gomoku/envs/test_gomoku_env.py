@@ -89,6 +89,38 @@ class TestGomokuEnv:
                     print('draw')
                 break
 
+    def test_clone_restore_state(self):
+        cfg = EasyDict(
+            board_size=6,
+            battle_mode='self_play_mode',
+            prob_random_agent=0,
+            channel_last=False,
+            scale=True,
+            agent_vs_human=False,
+            bot_action_type='v0',
+            prob_random_action_in_bot=0.,
+            check_action_to_connect4_in_bot_v0=False,
+            render_mode=None,
+            replay_path=None,
+            screen_scaling=9,
+            alphazero_mcts_ctree=False,
+        )
+        env = GomokuEnv(cfg)
+        env.reset()
+        env.step(14)
+        env.step(15)
+        snapshot = env.clone_state()
+        board, current_player, legal_actions = env.board.copy(), env.current_player, list(env.legal_actions)
+        # Play the game to the end from the snapshot twice, restoring it each time.
+        for _ in range(2):
+            done = False
+            while not done:
+                obs, reward, done, info = env.step(env.random_action())
+            env.restore_state(snapshot)
+            assert (env.board == board).all()
+            assert env.current_player == current_player
+            assert list(env.legal_actions) == legal_actions
+
 
 # test = TestGomokuEnv()
 # test.test_play_with_bot_mode()
@@ -94,6 +94,32 @@ class TestTicTacToeEnv:
                     print('draw')
                 break
 
+    def test_clone_restore_state(self):
+        cfg = EasyDict(
+            battle_mode='self_play_mode',
+            channel_last=False,
+            scale=True,
+            agent_vs_human=False,
+            prob_random_agent=0,
+            prob_expert_agent=0,
+            bot_action_type='v0',
+            alphazero_mcts_ctree=False,
+        )
+        env = TicTacToeEnv(cfg)
+        env.reset()
+        env.step(4)
+        snapshot = env.clone_state()
+        board, current_player, legal_actions = env.board.copy(), env.current_player, env.legal_actions
+        # Play the game to the end from the snapshot twice, restoring it each time.
+        for _ in range(2):
+            done = False
+            while not done:
+                obs, reward, done, info = env.step(env.random_action())
+            env.restore_state(snapshot)
+            assert (env.board == board).all()
+            assert env.current_player == current_player
+            assert env.legal_actions == legal_actions
+
 
 test = TestTicTacToeEnv()
 test.test_self_play_mode()
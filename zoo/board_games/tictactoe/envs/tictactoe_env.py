@@ -3,7 +3,7 @@ import os
 import sys
 from datetime import datetime
 from functools import lru_cache
-from typing import List
+from typing import List, Tuple
 
 import gymnasium as gym
 import matplotlib.pyplot as plt
@@ -206,6 +206,26 @@ class TicTacToeEnv(BaseEnv):
         else:
             self.board = np.zeros((self.board_size, self.board_size), dtype="int32")
 
+    def clone_state(self) -> Tuple[np.ndarray, int]:
+        """
+        Overview:
+            Copy the 3 x 3 board and the current player, which is all ``restore_state`` needs to resume the game.
+        Returns:
+            - snapshot (:obj:`Tuple[np.ndarray, int]`): The (board, current_player) pair.
+        """
+        return self.board.copy(), self._current_player
+
+    def restore_state(self, snapshot: Tuple[np.ndarray, int]) -> None:
+        """
+        Overview:
+            Put back the board and the current player of a ``clone_state`` snapshot. The board is copied, so that \
+            the next simulation can restore the same snapshot.
+        Arguments:
+            - snapshot (:obj:`Tuple[np.ndarray, int]`): The (board, current_player) pair.
+        """
+        board, self._current_player = snapshot
+        self.board = board.copy()
+
     def step(self, action):
         if self.battle_mode == 'self_play_mode':
             if self.prob_random_agent > 0: